@@ -35,13 +35,18 @@ bool posix_intercepted = true;
 
 #include "posix_api.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <vector>
 
+#include "dtio/admission.h"
 #include "dtio/client_metadata_manager.h"
 #include "dtio/config_manager.h"
 #include "dtio/dtio_enumerations.h"
@@ -49,6 +54,452 @@ bool posix_intercepted = true;
 
 namespace stdfs = std::filesystem;
 
+// Per-call flags of the v2 variants that older headers may lack
+#ifndef RWF_APPEND
+#define RWF_APPEND 0x00000010
+#endif
+#ifndef RWF_NOAPPEND
+#define RWF_NOAPPEND 0x00000020
+#endif
+
+namespace dtio::posix {
+
+/** The per-call RWF_* flags the v2 variants honor */
+static constexpr int kRwfSupported =
+    RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_NOWAIT | RWF_APPEND | RWF_NOAPPEND;
+
+/**
+ * Move a packed file that outgrew the pack threshold onto the PFS. Its fd
+ * is pointed at the new file, so seeks and syncs reach it. Returns false
+ * if not all of it got there, and it stays packed.
+ * */
+static bool SpillPacked(int fd, dtio::FileInfo *file_info) {
+  int real_fd = HERMES_POSIX_API->open(file_info->absolute_path.c_str(),
+                                       O_RDWR | O_CREAT | O_TRUNC,
+                                       file_info->packed.Mode());
+  if (real_fd < 0) {
+    return false;
+  }
+  bool cloexec = fcntl(fd, F_GETFD) & FD_CLOEXEC;
+  dup3(real_fd, fd, cloexec ? O_CLOEXEC : 0);
+  HERMES_POSIX_API->close(real_fd);
+  ssize_t ret =
+      file_info->packed.Spill(file_info->absolute_path, file_info->policy);
+  if (ret < 0) {
+    return false;
+  }
+  file_info->Wrote(ret);
+  return true;
+}
+
+/**
+ * Gather @iov into one shm staging region and submit it as a single
+ * vectored write of the file range starting at @offset.
+ * */
+static ssize_t DtioWriteV(int fd, dtio::FileInfo *file_info,
+                          const struct iovec *iov, int iovcnt, off_t offset) {
+  std::vector<size_t> seg_sizes;
+  seg_sizes.reserve(iovcnt);
+  size_t total_size = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    seg_sizes.push_back(iov[i].iov_len);
+    total_size += iov[i].iov_len;
+  }
+  if (total_size == 0) {
+    return 0;
+  }
+
+  // A packed file is written in place, unless this makes it too large
+  auto &packed = file_info->packed;
+  if (packed.Active() && offset + total_size <= DTIO_CONF->pack_threshold_) {
+    for (int i = 0; i < iovcnt; ++i) {
+      packed.Write(offset, iov[i].iov_base, iov[i].iov_len);
+      offset += iov[i].iov_len;
+    }
+    return total_size;
+  }
+  if (packed.Active() && !SpillPacked(fd, file_info)) {
+    errno = EIO;
+    return -1;
+  }
+
+  // Buffered small writes must reach the file first
+  file_info->FlushWrites();
+  file_info->readahead.Invalidate();
+
+  // Gather the segments into shared memory
+  dtio::AdmissionScope admit(total_size);
+  hipc::FullPtr<char> shm_buf =
+      CHI_CLIENT->AllocateBuffer(HSHM_MCTX, total_size);
+  size_t buf_off = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    memcpy(shm_buf.ptr_ + buf_off, iov[i].iov_base, iov[i].iov_len);
+    buf_off += iov[i].iov_len;
+  }
+
+  ssize_t ret = DTIO_CONF->dtio_mod_.WriteV(
+      HSHM_MCTX, shm_buf.shm_, seg_sizes, offset,
+      chi::string(file_info->absolute_path), file_info->policy.backend,
+      file_info->policy.opts);
+
+  CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+  if (ret > 0) {
+    file_info->Wrote(offset + ret);
+  }
+  return ret;
+}
+
+/**
+ * Submit a single vectored read of the file range starting at @offset and
+ * scatter the bytes that were read back into @iov.
+ * */
+static ssize_t DtioReadV(dtio::FileInfo *file_info, const struct iovec *iov,
+                         int iovcnt, off_t offset) {
+  std::vector<size_t> seg_sizes;
+  seg_sizes.reserve(iovcnt);
+  size_t total_size = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    seg_sizes.push_back(iov[i].iov_len);
+    total_size += iov[i].iov_len;
+  }
+  if (total_size == 0) {
+    return 0;
+  }
+  if (file_info->packed.Active()) {
+    ssize_t ret = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+      ssize_t count =
+          file_info->packed.Read(offset + ret, iov[i].iov_base, iov[i].iov_len);
+      ret += count;
+      if (count < static_cast<ssize_t>(iov[i].iov_len)) {
+        break;
+      }
+    }
+    return ret;
+  }
+  if (file_info->write_buffer.Overlaps(offset, total_size)) {
+    file_info->FlushWrites();
+  }
+
+  dtio::AdmissionScope admit(total_size);
+  hipc::FullPtr<char> shm_buf =
+      CHI_CLIENT->AllocateBuffer(HSHM_MCTX, total_size);
+  ssize_t ret = DTIO_CONF->dtio_mod_.ReadV(
+      HSHM_MCTX, shm_buf.shm_, seg_sizes, offset,
+      chi::string(file_info->absolute_path), file_info->policy.backend,
+      file_info->policy.opts);
+
+  // Scatter only the bytes that were actually read
+  size_t remaining = ret > 0 ? ret : 0;
+  size_t buf_off = 0;
+  for (int i = 0; i < iovcnt && remaining; ++i) {
+    size_t seg_size = std::min(remaining, iov[i].iov_len);
+    memcpy(iov[i].iov_base, shm_buf.ptr_ + buf_off, seg_size);
+    buf_off += seg_size;
+    remaining -= seg_size;
+  }
+
+  CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+  return ret;
+}
+
+/**
+ * End of the file behind @fd, with this client's buffered writes in it.
+ * Returns -1 and errno on failure.
+ * */
+static off_t FileEnd(int fd, dtio::FileInfo *file_info) {
+  if (file_info->packed.Active()) {
+    return file_info->packed.Size();
+  }
+  file_info->FlushWrites();
+  if (file_info->in_memory) {
+    return DTIO_CONF->dtio_mod_
+        .MemOpen(HSHM_MCTX, chi::string(file_info->absolute_path))
+        .size_;
+  }
+  struct stat buf;
+  if (HERMES_POSIX_API->fstat(fd, &buf) < 0) {
+    return -1;
+  }
+  return std::max<off_t>(buf.st_size,
+                         DTIO_CONF->HeldEnd(file_info->absolute_path));
+}
+
+/**
+ * preadv2 and its 64-bit variant. A read always goes through the runtime,
+ * so RWF_NOWAIT can't be met; the other flags don't change a read.
+ * */
+static ssize_t DtioPreadV2(int fd, dtio::FileInfo *file_info,
+                           const struct iovec *iov, int iovcnt, off_t offset,
+                           int flags) {
+  if (flags & ~kRwfSupported) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  if (flags & RWF_NOWAIT) {
+    errno = EAGAIN;
+    return -1;
+  }
+  if (offset != -1) {
+    return DtioReadV(file_info, iov, iovcnt, offset);
+  }
+  ssize_t ret = DtioReadV(file_info, iov, iovcnt, file_info->current_offset);
+  if (ret > 0) {
+    DTIO_CLIENT_META->UpdatePosixOffset(fd, file_info->current_offset + ret);
+  }
+  return ret;
+}
+
+/**
+ * pwritev2 and its 64-bit variant. RWF_APPEND writes at the end of the
+ * file, and RWF_DSYNC and RWF_SYNC make the write durable as fsync does.
+ * */
+static ssize_t DtioPwriteV2(int fd, dtio::FileInfo *file_info,
+                            const struct iovec *iov, int iovcnt, off_t offset,
+                            int flags) {
+  if (flags & ~kRwfSupported) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  if (flags & RWF_NOWAIT) {
+    errno = EAGAIN;
+    return -1;
+  }
+  bool advance = offset == -1;
+  if (advance) {
+    offset = file_info->current_offset;
+  }
+  if (flags & RWF_APPEND) {
+    offset = FileEnd(fd, file_info);
+    if (offset < 0) {
+      return -1;
+    }
+  }
+  ssize_t ret = DtioWriteV(fd, file_info, iov, iovcnt, offset);
+  if (ret > 0 && advance) {
+    DTIO_CLIENT_META->UpdatePosixOffset(fd, offset + ret);
+  }
+  if (ret >= 0 && (flags & (RWF_DSYNC | RWF_SYNC)) && fsync(fd) < 0) {
+    return -1;
+  }
+  return ret;
+}
+
+/**
+ * Open @path as a packed file if it is one, or if small files are packed
+ * and it is being created. Returns whether it was opened here, with the fd
+ * (or -1 and errno) in @fd. The fd is a placeholder on /dev/null, so it is
+ * a real descriptor the app can pass around and close.
+ * */
+static bool OpenPacked(const char *path, int flags, mode_t mode, int &fd) {
+  auto *config = DTIO_CONF;
+  if (!config->PackingEnabled()) {
+    return false;
+  }
+  std::string abs_path = stdfs::absolute(path).string();
+  if (!config->ShouldIntercept(abs_path)) {
+    return false;
+  }
+  dtio::PackedFile packed;
+  int ret = packed.Open(abs_path, flags, mode);
+  if (ret == 0) {
+    return false;
+  }
+  fd = -1;
+  if (ret > 0) {
+    fd = HERMES_POSIX_API->open("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+  }
+  if (fd >= 0) {
+    auto *client_meta = DTIO_CLIENT_META;
+    client_meta->RegisterPosixFd(
+        fd, abs_path, flags,
+        config->Policy(abs_path, dtio::IoClientType::kPosix));
+    client_meta->GetPosixFileInfo(fd)->packed = std::move(packed);
+  }
+  return true;
+}
+
+/**
+ * Open @path in runtime memory if an include rule keeps its files there.
+ * Returns whether it was opened here, with the fd (or -1 and errno) in @fd.
+ * A file on the PFS, such as one persisted when memory ran short, is left
+ * to the real open. The fd is a placeholder, as for packed files.
+ * */
+static bool OpenInMemory(const char *path, int flags, mode_t mode, int &fd) {
+  auto *config = DTIO_CONF;
+  std::string abs_path = stdfs::absolute(path).string();
+  if (!config->InMemory(abs_path)) {
+    return false;
+  }
+  std::string name = chi::dtiomod::MemoryName(abs_path);
+  bool writable = flags & (O_WRONLY | O_RDWR);
+  chi::dtiomod::MemoryInfo info = config->dtio_mod_.MemOpen(
+      HSHM_MCTX, chi::string(name), flags & O_CREAT,
+      writable && (flags & O_TRUNC), mode);
+  if (!info.in_memory_) {
+    if (info.exists_ || (flags & O_CREAT)) {
+      return false;
+    }
+    errno = ENOENT;
+    fd = -1;
+    return true;
+  }
+  fd = -1;
+  if ((flags & O_CREAT) && (flags & O_EXCL) && !info.created_) {
+    errno = EEXIST;
+    return true;
+  }
+  fd = HERMES_POSIX_API->open("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+  if (fd >= 0) {
+    auto *client_meta = DTIO_CLIENT_META;
+    client_meta->RegisterPosixFd(
+        fd, name, flags, config->Policy(abs_path, dtio::IoClientType::kPosix));
+    client_meta->GetPosixFileInfo(fd)->in_memory = true;
+  }
+  return true;
+}
+
+/**
+ * Seek in a packed or in-memory file. Its placeholder fd has no offset of
+ * its own.
+ * */
+static off_t SeekPlaceholder(int fd, dtio::FileInfo *file_info, off_t offset,
+                             int whence) {
+  off_t base;
+  switch (whence) {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = file_info->current_offset;
+      break;
+    case SEEK_END:
+      base = FileEnd(fd, file_info);
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+  if (base + offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  // A seek away from the end of the buffered run breaks the sequence
+  if (base + offset != file_info->write_buffer.End()) {
+    file_info->FlushWrites();
+  }
+  DTIO_CLIENT_META->UpdatePosixOffset(fd, base + offset);
+  return base + offset;
+}
+
+/** Fill @buf for a regular file only the runtime knows of */
+template <typename StatT>
+static void FillStat(StatT *buf, u64 size, u32 mode, u64 mtime) {
+  memset(buf, 0, sizeof(*buf));
+  buf->st_mode = S_IFREG | mode;
+  buf->st_nlink = 1;
+  buf->st_uid = getuid();
+  buf->st_gid = getgid();
+  buf->st_size = size;
+  buf->st_blksize = 4096;
+  buf->st_blocks = (size + 511) / 512;
+  buf->st_atime = buf->st_mtime = buf->st_ctime = mtime;
+}
+
+/** Fill @buf for @path if it is packed. Returns whether it is. */
+template <typename StatT>
+static bool StatPacked(const char *path, StatT *buf) {
+  auto *config = DTIO_CONF;
+  if (!config->PackingEnabled()) {
+    return false;
+  }
+  std::string abs_path = stdfs::absolute(path).string();
+  chi::dtiomod::PackInfo info;
+  if (!config->ShouldIntercept(abs_path) ||
+      !dtio::PackedFile::Stat(abs_path, info)) {
+    return false;
+  }
+  FillStat(buf, info.size_, info.mode_, info.mtime_);
+  return true;
+}
+
+/** Fill @buf for @path if it is in memory. Returns whether it is. */
+template <typename StatT>
+static bool StatInMemory(const char *path, StatT *buf) {
+  auto *config = DTIO_CONF;
+  std::string abs_path = stdfs::absolute(path).string();
+  if (!config->InMemory(abs_path)) {
+    return false;
+  }
+  chi::dtiomod::MemoryInfo info = config->dtio_mod_.MemOpen(
+      HSHM_MCTX, chi::string(chi::dtiomod::MemoryName(abs_path)));
+  if (!info.in_memory_) {
+    return false;
+  }
+  FillStat(buf, info.size_, info.mode_, info.mtime_);
+  return true;
+}
+
+/** Drop @path from its pack if it is packed. Returns whether it was. */
+static bool UnlinkPacked(const char *path) {
+  auto *config = DTIO_CONF;
+  if (!config->PackingEnabled()) {
+    return false;
+  }
+  std::string abs_path = stdfs::absolute(path).string();
+  return config->ShouldIntercept(abs_path) &&
+         dtio::PackedFile::Remove(abs_path);
+}
+
+/**
+ * Drop @path from memory if it is held there, without persisting it.
+ * Returns whether it was.
+ * */
+static bool UnlinkInMemory(const char *path) {
+  auto *config = DTIO_CONF;
+  std::string abs_path = stdfs::absolute(path).string();
+  return config->InMemory(abs_path) &&
+         config->dtio_mod_.Discard(
+             HSHM_MCTX, chi::string(chi::dtiomod::MemoryName(abs_path)));
+}
+
+/**
+ * Drop what the runtime keeps of intercepted @abs_path once an open with
+ * @flags truncated it, so held or recorded data does not outlive it
+ * */
+static void TruncateInRuntime(const std::string &abs_path, int flags) {
+  if ((flags & O_TRUNC) && (flags & (O_WRONLY | O_RDWR))) {
+    DTIO_CONF->dtio_mod_.Truncate(HSHM_MCTX, chi::string(abs_path), 0);
+    DTIO_CLIENT_META->ClipWrittenEnd(abs_path, 0);
+  }
+}
+
+/**
+ * Count the data the runtime's tiers hold for intercepted @path in the
+ * size stat found in @buf
+ * */
+template <typename StatT>
+static void StatHeld(const char *path, StatT *buf) {
+  auto *config = DTIO_CONF;
+  std::string abs_path = stdfs::absolute(path).string();
+  if (S_ISREG(buf->st_mode) && config->ShouldIntercept(abs_path)) {
+    buf->st_size =
+        std::max<off_t>(buf->st_size, config->HeldEnd(abs_path));
+  }
+}
+
+/** Drop what the runtime keeps of @path before it is unlinked */
+static void UnlinkInRuntime(const char *path) {
+  auto *config = DTIO_CONF;
+  std::string abs_path = stdfs::absolute(path).string();
+  if (config->ShouldIntercept(abs_path)) {
+    config->dtio_mod_.Truncate(HSHM_MCTX, chi::string(abs_path), 0, true);
+    DTIO_CLIENT_META->ClipWrittenEnd(abs_path, 0);
+  }
+}
+
+}  // namespace dtio::posix
+
 extern "C" {
 
 static __attribute__((constructor(101))) void init_posix(void) {}
@@ -78,6 +529,18 @@ int HERMES_DECL(open)(const char *path, int flags, ...) {
     va_end(args);
   }
 
+  // Small files may be packed, and not on the PFS at all
+  int packed_fd;
+  if (dtio::posix::OpenPacked(path, flags, mode, packed_fd)) {
+    return packed_fd;
+  }
+
+  // Files under memory rules are kept in the runtime, and not on the PFS
+  int memory_fd;
+  if (dtio::posix::OpenInMemory(path, flags, mode, memory_fd)) {
+    return memory_fd;
+  }
+
   // Call real open first
   int real_fd;
   if (flags & O_CREAT) {
@@ -101,7 +564,10 @@ int HERMES_DECL(open)(const char *path, int flags, ...) {
 
   // Register with metadata manager
   auto *client_meta = DTIO_CLIENT_META;
-  client_meta->RegisterPosixFd(real_fd, abs_path, flags);
+  client_meta->RegisterPosixFd(
+      real_fd, abs_path, flags,
+      config->Policy(abs_path, dtio::IoClientType::kPosix));
+  dtio::posix::TruncateInRuntime(abs_path, flags);
 
   return real_fd;
 }
@@ -117,6 +583,18 @@ int HERMES_DECL(open64)(const char *path, int flags, ...) {
     va_end(args);
   }
 
+  // Small files may be packed, and not on the PFS at all
+  int packed_fd;
+  if (dtio::posix::OpenPacked(path, flags, mode, packed_fd)) {
+    return packed_fd;
+  }
+
+  // Files under memory rules are kept in the runtime, and not on the PFS
+  int memory_fd;
+  if (dtio::posix::OpenInMemory(path, flags, mode, memory_fd)) {
+    return memory_fd;
+  }
+
   // Call real open64 first
   int real_fd;
   if (flags & O_CREAT) {
@@ -140,7 +618,10 @@ int HERMES_DECL(open64)(const char *path, int flags, ...) {
 
   // Register with metadata manager
   auto *client_meta = DTIO_CLIENT_META;
-  client_meta->RegisterPosixFd(real_fd, abs_path, flags);
+  client_meta->RegisterPosixFd(
+      real_fd, abs_path, flags,
+      config->Policy(abs_path, dtio::IoClientType::kPosix));
+  dtio::posix::TruncateInRuntime(abs_path, flags);
 
   return real_fd;
 }
@@ -155,6 +636,18 @@ int HERMES_DECL(creat)(const char *path, mode_t mode) {
   // creat is equivalent to open(path, O_CREAT | O_WRONLY | O_TRUNC, mode)
   int flags = O_CREAT | O_WRONLY | O_TRUNC;
 
+  // Small files may be packed, and not on the PFS at all
+  int packed_fd;
+  if (dtio::posix::OpenPacked(path, flags, mode, packed_fd)) {
+    return packed_fd;
+  }
+
+  // Files under memory rules are kept in the runtime, and not on the PFS
+  int memory_fd;
+  if (dtio::posix::OpenInMemory(path, flags, mode, memory_fd)) {
+    return memory_fd;
+  }
+
   // Call real creat first
   int real_fd = HERMES_POSIX_API->creat(path, mode);
 
@@ -173,7 +666,10 @@ int HERMES_DECL(creat)(const char *path, mode_t mode) {
 
   // Register with metadata manager
   auto *client_meta = DTIO_CLIENT_META;
-  client_meta->RegisterPosixFd(real_fd, abs_path, flags);
+  client_meta->RegisterPosixFd(
+      real_fd, abs_path, flags,
+      config->Policy(abs_path, dtio::IoClientType::kPosix));
+  dtio::posix::TruncateInRuntime(abs_path, flags);
 
   return real_fd;
 }
@@ -184,6 +680,18 @@ int HERMES_DECL(creat64)(const char *path, mode_t mode) {
   // creat64 is equivalent to open64(path, O_CREAT | O_WRONLY | O_TRUNC, mode)
   int flags = O_CREAT | O_WRONLY | O_TRUNC;
 
+  // Small files may be packed, and not on the PFS at all
+  int packed_fd;
+  if (dtio::posix::OpenPacked(path, flags, mode, packed_fd)) {
+    return packed_fd;
+  }
+
+  // Files under memory rules are kept in the runtime, and not on the PFS
+  int memory_fd;
+  if (dtio::posix::OpenInMemory(path, flags, mode, memory_fd)) {
+    return memory_fd;
+  }
+
   // Call real creat64 first
   int real_fd = HERMES_POSIX_API->creat64(path, mode);
 
@@ -202,7 +710,10 @@ int HERMES_DECL(creat64)(const char *path, mode_t mode) {
 
   // Register with metadata manager
   auto *client_meta = DTIO_CLIENT_META;
-  client_meta->RegisterPosixFd(real_fd, abs_path, flags);
+  client_meta->RegisterPosixFd(
+      real_fd, abs_path, flags,
+      config->Policy(abs_path, dtio::IoClientType::kPosix));
+  dtio::posix::TruncateInRuntime(abs_path, flags);
 
   return real_fd;
 }
@@ -221,24 +732,56 @@ ssize_t HERMES_DECL(read)(int fd, void *buf, size_t count) {
   if (file_info) {
     auto *config = DTIO_CONF;
 
-    // Allocate buffer in shared memory
+    // A packed file is held whole by the client
+    if (file_info->packed.Active()) {
+      ssize_t ret =
+          file_info->packed.Read(file_info->current_offset, buf, count);
+      client_meta->UpdatePosixOffset(fd, file_info->current_offset + ret);
+      return ret;
+    }
+
+    // Buffered writes to this range must reach the file first
+    if (file_info->write_buffer.Overlaps(file_info->current_offset, count)) {
+      file_info->FlushWrites();
+    }
+
+    // Sequential reads are served from the readahead window. It may be
+    // filled from past this read, where writes may still be buffered.
+    if (count < file_info->policy.readahead_max) {
+      ssize_t ret = file_info->readahead.Read(
+          file_info->absolute_path, file_info->policy,
+          file_info->current_offset, buf, count,
+          [file_info](off_t off, size_t size) {
+            if (file_info->write_buffer.Overlaps(off, size)) {
+              file_info->FlushWrites();
+            }
+          });
+      if (ret >= 0) {
+        client_meta->UpdatePosixOffset(fd, file_info->current_offset + ret);
+        return ret;
+      }
+    }
+
+    // Allocate buffer in shared memory once this client may use it
+    dtio::AdmissionScope admit(count);
     hipc::FullPtr<char> shm_buf = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, count);
 
     // Submit read task with filename as chi::string
-    config->dtio_mod_.Read(
+    ssize_t ret = config->dtio_mod_.Read(
         HSHM_MCTX, shm_buf.shm_, count, file_info->current_offset,
-        chi::string(file_info->absolute_path), dtio::IoClientType::kPosix);
+        chi::string(file_info->absolute_path), file_info->policy.backend,
+        file_info->policy.opts);
 
     // Copy data back to user buffer
-    memcpy(buf, shm_buf.ptr_, count);
-
-    // Update offset
-    client_meta->UpdatePosixOffset(fd, file_info->current_offset + count);
+    if (ret > 0) {
+      memcpy(buf, shm_buf.ptr_, ret);
+      client_meta->UpdatePosixOffset(fd, file_info->current_offset + ret);
+    }
 
     // Free shared memory buffer
     CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
 
-    return count;
+    return ret;
   }
 
   // Fallback to real API
@@ -257,23 +800,62 @@ ssize_t HERMES_DECL(write)(int fd, const void *buf, size_t count) {
   auto *file_info = client_meta->GetPosixFileInfo(fd);
   if (file_info) {
     auto *config = DTIO_CONF;
-
-    // Allocate buffer in shared memory
+    auto &write_buffer = file_info->write_buffer;
+    file_info->readahead.Invalidate();
+
+    // A packed file is written in place, unless this makes it too large
+    if (file_info->packed.Active()) {
+      if (file_info->packed.Write(file_info->current_offset, buf, count)) {
+        client_meta->UpdatePosixOffset(fd, file_info->current_offset + count);
+        return count;
+      }
+      if (!dtio::posix::SpillPacked(fd, file_info)) {
+        errno = EIO;
+        return -1;
+      }
+    }
+
+    // Absorb small writes into the write-combining buffer
+    if (count < file_info->policy.aggregation) {
+      if (!write_buffer.CanAppend(file_info->current_offset, count)) {
+        file_info->FlushWrites();
+      }
+      write_buffer.Append(file_info->current_offset, buf, count,
+                          file_info->policy.aggregation);
+      if (write_buffer.Full()) {
+        file_info->FlushWrites();
+      }
+      client_meta->UpdatePosixOffset(fd, file_info->current_offset + count);
+      return count;
+    }
+
+    // Large writes bypass the buffer, but must not overtake it
+    file_info->FlushWrites();
+
+    // Allocate buffer in shared memory once this client may use it
+    dtio::AdmissionScope admit(count);
     hipc::FullPtr<char> shm_buf = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, count);
     memcpy(shm_buf.ptr_, buf, count);
 
     // Submit write task with filename as chi::string
-    config->dtio_mod_.Write(
+    ssize_t ret = config->dtio_mod_.Write(
         HSHM_MCTX, shm_buf.shm_, count, file_info->current_offset,
-        chi::string(file_info->absolute_path), dtio::IoClientType::kPosix);
+        chi::string(file_info->absolute_path), file_info->policy.backend,
+        file_info->policy.opts);
 
     // Update offset
-    client_meta->UpdatePosixOffset(fd, file_info->current_offset + count);
+    if (ret > 0) {
+      file_info->Wrote(file_info->current_offset + ret);
+      client_meta->UpdatePosixOffset(fd, file_info->current_offset + ret);
+    }
 
     // Free shared memory buffer
     CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
 
-    return count;
+    if (ret < 0) {
+      errno = EIO;
+    }
+    return ret;
   }
 
   // Fallback to real API
@@ -289,6 +871,26 @@ off_t HERMES_DECL(lseek)(int fd, off_t offset, int whence) {
     return HERMES_POSIX_API->lseek(fd, offset, whence);
   }
 
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (file_info && (file_info->packed.Active() || file_info->in_memory)) {
+    return dtio::posix::SeekPlaceholder(fd, file_info, offset, whence);
+  }
+  if (file_info) {
+    // The kernel offset is not advanced by DTIO I/O, so resolve SEEK_CUR
+    // against our own offset. SEEK_END counts what is not on the PFS yet.
+    if (whence == SEEK_CUR) {
+      offset += file_info->current_offset;
+      whence = SEEK_SET;
+    } else if (whence == SEEK_END) {
+      off_t end = dtio::posix::FileEnd(fd, file_info);
+      if (end < 0) {
+        return -1;
+      }
+      offset += end;
+      whence = SEEK_SET;
+    }
+  }
+
   // Call real lseek first to get the actual position
   off_t real_offset = HERMES_POSIX_API->lseek(fd, offset, whence);
   if (real_offset < 0) {
@@ -296,8 +898,11 @@ off_t HERMES_DECL(lseek)(int fd, off_t offset, int whence) {
   }
 
   // Update DTIO metadata with new offset
-  auto *file_info = client_meta->GetPosixFileInfo(fd);
   if (file_info) {
+    // A seek away from the end of the buffered run breaks the sequence
+    if (real_offset != file_info->write_buffer.End()) {
+      file_info->FlushWrites();
+    }
     client_meta->UpdatePosixOffset(fd, real_offset);
   }
 
@@ -314,6 +919,26 @@ off64_t HERMES_DECL(lseek64)(int fd, off64_t offset, int whence) {
     return HERMES_POSIX_API->lseek64(fd, offset, whence);
   }
 
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (file_info && (file_info->packed.Active() || file_info->in_memory)) {
+    return dtio::posix::SeekPlaceholder(fd, file_info, offset, whence);
+  }
+  if (file_info) {
+    // The kernel offset is not advanced by DTIO I/O, so resolve SEEK_CUR
+    // against our own offset. SEEK_END counts what is not on the PFS yet.
+    if (whence == SEEK_CUR) {
+      offset += file_info->current_offset;
+      whence = SEEK_SET;
+    } else if (whence == SEEK_END) {
+      off_t end = dtio::posix::FileEnd(fd, file_info);
+      if (end < 0) {
+        return -1;
+      }
+      offset += end;
+      whence = SEEK_SET;
+    }
+  }
+
   // Call real lseek64 first to get the actual position
   off64_t real_offset = HERMES_POSIX_API->lseek64(fd, offset, whence);
   if (real_offset < 0) {
@@ -321,8 +946,11 @@ off64_t HERMES_DECL(lseek64)(int fd, off64_t offset, int whence) {
   }
 
   // Update DTIO metadata with new offset
-  auto *file_info = client_meta->GetPosixFileInfo(fd);
   if (file_info) {
+    // A seek away from the end of the buffered run breaks the sequence
+    if (real_offset != file_info->write_buffer.End()) {
+      file_info->FlushWrites();
+    }
     client_meta->UpdatePosixOffset(fd, real_offset);
   }
 
@@ -330,6 +958,153 @@ off64_t HERMES_DECL(lseek64)(int fd, off64_t offset, int whence) {
 }
 #endif
 
+ssize_t HERMES_DECL(readv)(int fd, const struct iovec *iov, int iovcnt) {
+  // Check if file descriptor is registered with DTIO
+  auto *client_meta = DTIO_CLIENT_META;
+  if (!client_meta->IsPosixFdRegistered(fd)) {
+    // Not intercepted, call real API
+    return HERMES_POSIX_API->readv(fd, iov, iovcnt);
+  }
+
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (file_info) {
+    ssize_t ret = dtio::posix::DtioReadV(file_info, iov, iovcnt,
+                                         file_info->current_offset);
+    if (ret > 0) {
+      client_meta->UpdatePosixOffset(fd, file_info->current_offset + ret);
+    }
+    return ret;
+  }
+
+  // Fallback to real API
+  return HERMES_POSIX_API->readv(fd, iov, iovcnt);
+}
+
+ssize_t HERMES_DECL(writev)(int fd, const struct iovec *iov, int iovcnt) {
+  // Check if file descriptor is registered with DTIO
+  auto *client_meta = DTIO_CLIENT_META;
+  if (!client_meta->IsPosixFdRegistered(fd)) {
+    // Not intercepted, call real API
+    return HERMES_POSIX_API->writev(fd, iov, iovcnt);
+  }
+
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (file_info) {
+    ssize_t ret = dtio::posix::DtioWriteV(fd, file_info, iov, iovcnt,
+                                          file_info->current_offset);
+    if (ret > 0) {
+      client_meta->UpdatePosixOffset(fd, file_info->current_offset + ret);
+    }
+    return ret;
+  }
+
+  // Fallback to real API
+  return HERMES_POSIX_API->writev(fd, iov, iovcnt);
+}
+
+// NOTE: positioned vectored I/O leaves the file offset untouched, unless the
+// v2 variants are given an offset of -1, in which case they behave like
+// readv/writev. The v2 variants honor their per-call flags.
+#if !defined(_FILE_OFFSET_BITS) || _FILE_OFFSET_BITS != 64
+ssize_t HERMES_DECL(preadv)(int fd, const struct iovec *iov, int iovcnt,
+                            off_t offset) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->preadv(fd, iov, iovcnt, offset);
+  }
+  return dtio::posix::DtioReadV(file_info, iov, iovcnt, offset);
+}
+
+ssize_t HERMES_DECL(pwritev)(int fd, const struct iovec *iov, int iovcnt,
+                             off_t offset) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->pwritev(fd, iov, iovcnt, offset);
+  }
+  return dtio::posix::DtioWriteV(fd, file_info, iov, iovcnt, offset);
+}
+
+ssize_t HERMES_DECL(preadv2)(int fd, const struct iovec *iov, int iovcnt,
+                             off_t offset, int flags) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->preadv2(fd, iov, iovcnt, offset, flags);
+  }
+  return dtio::posix::DtioPreadV2(fd, file_info, iov, iovcnt, offset, flags);
+}
+
+ssize_t HERMES_DECL(pwritev2)(int fd, const struct iovec *iov, int iovcnt,
+                              off_t offset, int flags) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->pwritev2(fd, iov, iovcnt, offset, flags);
+  }
+  return dtio::posix::DtioPwriteV2(fd, file_info, iov, iovcnt, offset, flags);
+}
+#endif
+
+#if defined(_FILE_OFFSET_BITS) && _FILE_OFFSET_BITS == 64
+ssize_t HERMES_DECL(preadv64)(int fd, const struct iovec *iov, int iovcnt,
+                              off64_t offset) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->preadv64(fd, iov, iovcnt, offset);
+  }
+  return dtio::posix::DtioReadV(file_info, iov, iovcnt, offset);
+}
+
+ssize_t HERMES_DECL(pwritev64)(int fd, const struct iovec *iov, int iovcnt,
+                               off64_t offset) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->pwritev64(fd, iov, iovcnt, offset);
+  }
+  return dtio::posix::DtioWriteV(fd, file_info, iov, iovcnt, offset);
+}
+
+ssize_t HERMES_DECL(preadv64v2)(int fd, const struct iovec *iov, int iovcnt,
+                                off64_t offset, int flags) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->preadv64v2(fd, iov, iovcnt, offset, flags);
+  }
+  return dtio::posix::DtioPreadV2(fd, file_info, iov, iovcnt, offset, flags);
+}
+
+ssize_t HERMES_DECL(pwritev64v2)(int fd, const struct iovec *iov, int iovcnt,
+                                 off64_t offset, int flags) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->IsPosixFdRegistered(fd)
+                        ? client_meta->GetPosixFileInfo(fd)
+                        : nullptr;
+  if (!file_info) {
+    return HERMES_POSIX_API->pwritev64v2(fd, iov, iovcnt, offset, flags);
+  }
+  return dtio::posix::DtioPwriteV2(fd, file_info, iov, iovcnt, offset, flags);
+}
+#endif
+
 int HERMES_DECL(__fxstat)(int __ver, int fd, struct stat *buf) {
   return -1;  // Not implemented
 }
@@ -351,9 +1126,18 @@ int HERMES_DECL(__lxstat)(int __ver, const char *__filename,
 
 #if !defined(_FILE_OFFSET_BITS) || _FILE_OFFSET_BITS != 64
 int HERMES_DECL(stat)(const char *pathname, struct stat *buf) {
-  // For stat, we don't need special DTIO handling - just call real API
-  // The file doesn't need to be open for stat operations
-  return HERMES_POSIX_API->stat(pathname, buf);
+  // Packed and in-memory files are only known to the runtime. Otherwise, the
+  // file doesn't need to be open for stat operations, so just call the real
+  // API.
+  if (dtio::posix::StatPacked(pathname, buf) ||
+      dtio::posix::StatInMemory(pathname, buf)) {
+    return 0;
+  }
+  int ret = HERMES_POSIX_API->stat(pathname, buf);
+  if (ret == 0) {
+    dtio::posix::StatHeld(pathname, buf);
+  }
+  return ret;
 }
 #endif
 
@@ -378,9 +1162,18 @@ int HERMES_DECL(__lxstat64)(int __ver, const char *__filename,
 
 #if defined(_FILE_OFFSET_BITS) && _FILE_OFFSET_BITS == 64
 int HERMES_DECL(stat64)(const char *pathname, struct stat64 *buf) {
-  // For stat64, we don't need special DTIO handling - just call real API
-  // The file doesn't need to be open for stat operations
-  return HERMES_POSIX_API->stat64(pathname, buf);
+  // Packed and in-memory files are only known to the runtime. Otherwise, the
+  // file doesn't need to be open for stat operations, so just call the real
+  // API.
+  if (dtio::posix::StatPacked(pathname, buf) ||
+      dtio::posix::StatInMemory(pathname, buf)) {
+    return 0;
+  }
+  int ret = HERMES_POSIX_API->stat64(pathname, buf);
+  if (ret == 0) {
+    dtio::posix::StatHeld(pathname, buf);
+  }
+  return ret;
 }
 #endif
 
@@ -392,9 +1185,32 @@ int HERMES_DECL(fsync)(int fd) {
     return HERMES_POSIX_API->fsync(fd);
   }
 
-  // For DTIO-managed files, call real fsync
-  // In the future, this could trigger DTIO-specific flush operations
-  return HERMES_POSIX_API->fsync(fd);
+  // Push any buffered writes to the runtime before syncing
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (file_info && file_info->packed.Active()) {
+    return file_info->packed.Store(file_info->absolute_path);
+  }
+  if (file_info && file_info->in_memory) {
+    // A file in memory is only persisted if it must be
+    file_info->FlushWrites();
+    return file_info->TakeError();
+  }
+  bool persisted = true;
+  if (file_info) {
+    file_info->FlushWrites();
+    // Data held in the runtime is only durable once it is on the PFS
+    persisted = DTIO_CONF->Persist(file_info->absolute_path);
+  }
+  int ret = HERMES_POSIX_API->fsync(fd);
+  // A buffered write that failed since the last sync fails this one
+  if (file_info && file_info->TakeError() < 0) {
+    return -1;
+  }
+  if (!persisted) {
+    errno = EIO;
+    return -1;
+  }
+  return ret;
 }
 
 int HERMES_DECL(close)(int fd) {
@@ -405,16 +1221,46 @@ int HERMES_DECL(close)(int fd) {
     return HERMES_POSIX_API->close(fd);
   }
 
+  // A packed file goes back into its pack
+  int stored = 0;
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (file_info && file_info->packed.Active()) {
+    stored = file_info->packed.Store(file_info->absolute_path);
+    file_info = nullptr;
+  }
+
+  // Drain the write-combining buffer. A buffered write that failed is
+  // reported here, as the last chance to.
+  if (file_info) {
+    file_info->FlushWrites();
+    stored = file_info->TakeError();
+    file_info->write_buffer.Release();
+    file_info->readahead.Release();
+    auto *config = DTIO_CONF;
+    if (config->log_structured_ && !file_info->in_memory &&
+        (file_info->flags & (O_WRONLY | O_RDWR))) {
+      config->dtio_mod_.CloseLog(HSHM_MCTX,
+                                 chi::string(file_info->absolute_path));
+    }
+  }
+
   // Unregister from DTIO metadata manager
   client_meta->UnregisterPosixFd(fd);
 
   // Call real close
-  return HERMES_POSIX_API->close(fd);
+  int ret = HERMES_POSIX_API->close(fd);
+  return stored < 0 ? stored : ret;
 }
 
 int HERMES_DECL(unlink)(const char *pathname) {
-  // For unlink, we don't need special DTIO handling - just call real API
-  // File removal doesn't require tracking in DTIO metadata
+  // A packed or in-memory file only has to be dropped from the runtime.
+  // Otherwise, whatever the runtime still keeps of the file is dropped
+  // first, so it cannot be drained back into the file once it is gone.
+  if (dtio::posix::UnlinkPacked(pathname) ||
+      dtio::posix::UnlinkInMemory(pathname)) {
+    return 0;
+  }
+  dtio::posix::UnlinkInRuntime(pathname);
   return HERMES_POSIX_API->unlink(pathname);
 }
 
@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <boost/stacktrace.hpp>
@@ -59,6 +60,24 @@ typedef ssize_t (*pwrite_t)(int fd, const void *buf, size_t count,
 typedef ssize_t (*pread64_t)(int fd, void *buf, size_t count, off64_t offset);
 typedef ssize_t (*pwrite64_t)(int fd, const void *buf, size_t count,
                               off64_t offset);
+typedef ssize_t (*readv_t)(int fd, const struct iovec *iov, int iovcnt);
+typedef ssize_t (*writev_t)(int fd, const struct iovec *iov, int iovcnt);
+typedef ssize_t (*preadv_t)(int fd, const struct iovec *iov, int iovcnt,
+                            off_t offset);
+typedef ssize_t (*pwritev_t)(int fd, const struct iovec *iov, int iovcnt,
+                             off_t offset);
+typedef ssize_t (*preadv64_t)(int fd, const struct iovec *iov, int iovcnt,
+                              off64_t offset);
+typedef ssize_t (*pwritev64_t)(int fd, const struct iovec *iov, int iovcnt,
+                               off64_t offset);
+typedef ssize_t (*preadv2_t)(int fd, const struct iovec *iov, int iovcnt,
+                             off_t offset, int flags);
+typedef ssize_t (*pwritev2_t)(int fd, const struct iovec *iov, int iovcnt,
+                              off_t offset, int flags);
+typedef ssize_t (*preadv64v2_t)(int fd, const struct iovec *iov, int iovcnt,
+                                off64_t offset, int flags);
+typedef ssize_t (*pwritev64v2_t)(int fd, const struct iovec *iov, int iovcnt,
+                                 off64_t offset, int flags);
 typedef off_t (*lseek_t)(int fd, off_t offset, int whence);
 typedef off64_t (*lseek64_t)(int fd, off64_t offset, int whence);
 
@@ -140,6 +159,26 @@ class PosixApi : public dtio::adapter::RealApi {
   pread64_t pread64 = nullptr;
   /** pwrite64 */
   pwrite64_t pwrite64 = nullptr;
+  /** readv */
+  readv_t readv = nullptr;
+  /** writev */
+  writev_t writev = nullptr;
+  /** preadv */
+  preadv_t preadv = nullptr;
+  /** pwritev */
+  pwritev_t pwritev = nullptr;
+  /** preadv64 */
+  preadv64_t preadv64 = nullptr;
+  /** pwritev64 */
+  pwritev64_t pwritev64 = nullptr;
+  /** preadv2 */
+  preadv2_t preadv2 = nullptr;
+  /** pwritev2 */
+  pwritev2_t pwritev2 = nullptr;
+  /** preadv64v2 */
+  preadv64v2_t preadv64v2 = nullptr;
+  /** pwritev64v2 */
+  pwritev64v2_t pwritev64v2 = nullptr;
   /** lseek */
   lseek_t lseek = nullptr;
   /** lseek64 */
@@ -208,6 +247,26 @@ class PosixApi : public dtio::adapter::RealApi {
     REQUIRE_API(pread64)
     pwrite64 = (pwrite64_t)dlsym(real_lib_, "pwrite64");
     REQUIRE_API(pwrite64)
+    readv = (readv_t)dlsym(real_lib_, "readv");
+    REQUIRE_API(readv)
+    writev = (writev_t)dlsym(real_lib_, "writev");
+    REQUIRE_API(writev)
+    preadv = (preadv_t)dlsym(real_lib_, "preadv");
+    REQUIRE_API(preadv)
+    pwritev = (pwritev_t)dlsym(real_lib_, "pwritev");
+    REQUIRE_API(pwritev)
+    preadv64 = (preadv64_t)dlsym(real_lib_, "preadv64");
+    REQUIRE_API(preadv64)
+    pwritev64 = (pwritev64_t)dlsym(real_lib_, "pwritev64");
+    REQUIRE_API(pwritev64)
+    preadv2 = (preadv2_t)dlsym(real_lib_, "preadv2");
+    REQUIRE_API(preadv2)
+    pwritev2 = (pwritev2_t)dlsym(real_lib_, "pwritev2");
+    REQUIRE_API(pwritev2)
+    preadv64v2 = (preadv64v2_t)dlsym(real_lib_, "preadv64v2");
+    REQUIRE_API(preadv64v2)
+    pwritev64v2 = (pwritev64v2_t)dlsym(real_lib_, "pwritev64v2");
+    REQUIRE_API(pwritev64v2)
     lseek = (lseek_t)dlsym(real_lib_, "lseek");
     REQUIRE_API(lseek)
     lseek64 = (lseek64_t)dlsym(real_lib_, "lseek64");
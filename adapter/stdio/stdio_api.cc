@@ -25,10 +25,12 @@
 // Dynamically checked to see which are the real APIs and which are intercepted
 bool stdio_intercepted = true;
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <cstdio>
 // #include "hermes_shm/util/logging.h"
 // #include <filesystem>
@@ -36,6 +38,7 @@ bool stdio_intercepted = true;
 // #include "hermes_types.h"
 // #include <dtio/drivers/stdio.h>  // Not available, using stdio_api.h instead
 
+#include "dtio/admission.h"
 #include "dtio/client_metadata_manager.h"
 #include "dtio/config_manager.h"
 #include "dtio/dtio_enumerations.h"
@@ -52,6 +55,252 @@ bool stdio_intercepted = true;
 // namespace hapi = hermes::api;
 namespace stdfs = std::filesystem;
 
+namespace dtio::stdio {
+
+/**
+ * Read up to @size bytes at the stream offset. Reads smaller than the stream
+ * buffer are served from it, and the buffer is refilled with large
+ * asynchronous Read tasks. Does not advance the stream offset.
+ * */
+static ssize_t DtioRead(dtio::FileInfo *file_info, void *buf, size_t size) {
+  auto *config = DTIO_CONF;
+
+  // A packed file is held whole by the client
+  if (file_info->packed.Active()) {
+    return file_info->packed.Read(file_info->current_offset, buf, size);
+  }
+
+  // Buffered writes to a range must reach the file before it is read
+  auto flush_overlap = [file_info](off_t off, size_t size) {
+    if (file_info->write_buffer.Overlaps(off, size)) {
+      file_info->FlushWrites();
+    }
+  };
+
+  ssize_t ret = -1;
+  if (size < file_info->policy.readahead_max) {
+    ret = file_info->readahead.Read(file_info->absolute_path,
+                                    file_info->policy,
+                                    file_info->current_offset, buf, size,
+                                    flush_overlap);
+  }
+  if (ret >= 0) {
+    return ret;
+  }
+  flush_overlap(file_info->current_offset, size);
+
+  // Large or random reads go to the runtime directly
+  dtio::AdmissionScope admit(size);
+  hipc::FullPtr<char> shm_buf = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+  ret = config->dtio_mod_.Read(HSHM_MCTX, shm_buf.shm_, size,
+                               file_info->current_offset,
+                               chi::string(file_info->absolute_path),
+                               file_info->policy.backend,
+                               file_info->policy.opts);
+  if (ret > 0) {
+    memcpy(buf, shm_buf.ptr_, ret);
+  }
+  CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+  return ret;
+}
+
+/**
+ * Whether a flush or close of the stream must wait until the runtime has
+ * put its file on the PFS. Only files whose policy is sync do; the others
+ * are drained in the background and made durable by fsync.
+ * */
+static bool MustPersist(const dtio::FileInfo *file_info) {
+  return file_info->policy.sync && !file_info->in_memory;
+}
+
+/**
+ * Move a packed file that outgrew the pack threshold onto the PFS. Returns
+ * false if not all of it got there, and it stays packed.
+ * */
+static bool SpillPacked(dtio::FileInfo *file_info) {
+  FILE *fp = HERMES_STDIO_API->fopen(file_info->absolute_path.c_str(), "w");
+  if (!fp) {
+    return false;
+  }
+  HERMES_STDIO_API->fclose(fp);
+  ssize_t ret =
+      file_info->packed.Spill(file_info->absolute_path, file_info->policy);
+  if (ret < 0) {
+    return false;
+  }
+  file_info->Wrote(ret);
+  return true;
+}
+
+/**
+ * Write @size bytes at the stream offset through the stream buffer. Returns
+ * the bytes written, or -1 with errno. Does not advance the stream offset.
+ * */
+static ssize_t DtioWrite(dtio::FileInfo *file_info, const void *buf,
+                         size_t size) {
+  auto *config = DTIO_CONF;
+  auto &write_buffer = file_info->write_buffer;
+  file_info->readahead.Invalidate();
+
+  // A packed file is written in place, unless this makes it too large
+  auto &packed = file_info->packed;
+  if (packed.Active()) {
+    if (packed.Write(file_info->current_offset, buf, size)) {
+      return size;
+    }
+    if (!SpillPacked(file_info)) {
+      errno = EIO;
+      return -1;
+    }
+  }
+
+  if (size < file_info->policy.aggregation) {
+    if (!write_buffer.CanAppend(file_info->current_offset, size)) {
+      file_info->FlushWrites();
+    }
+    write_buffer.Append(file_info->current_offset, buf, size,
+                        file_info->policy.aggregation);
+    if (write_buffer.Full()) {
+      file_info->FlushWrites();
+    }
+    return size;
+  }
+
+  // Large writes bypass the buffer, but must not overtake it
+  file_info->FlushWrites();
+  dtio::AdmissionScope admit(size);
+  hipc::FullPtr<char> shm_buf = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+  memcpy(shm_buf.ptr_, buf, size);
+  ssize_t ret = config->dtio_mod_.Write(
+      HSHM_MCTX, shm_buf.shm_, size, file_info->current_offset,
+      chi::string(file_info->absolute_path), file_info->policy.backend,
+      file_info->policy.opts);
+  CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+  if (ret < 0) {
+    errno = EIO;
+  } else {
+    file_info->Wrote(file_info->current_offset + ret);
+  }
+  return ret;
+}
+
+/**
+ * End of the stream's file, with its buffered writes in it. Returns -1
+ * and errno on failure.
+ * */
+static off_t FileEnd(dtio::FileInfo *file_info) {
+  if (file_info->packed.Active()) {
+    return file_info->packed.Size();
+  }
+  file_info->FlushWrites();
+  if (file_info->in_memory) {
+    return DTIO_CONF->dtio_mod_
+        .MemOpen(HSHM_MCTX, chi::string(file_info->absolute_path))
+        .size_;
+  }
+  struct stat st;
+  if (stat(file_info->absolute_path.c_str(), &st) != 0) {
+    return -1;
+  }
+  return std::max<off_t>(st.st_size,
+                         DTIO_CONF->HeldEnd(file_info->absolute_path));
+}
+
+/** The open(2) flags equivalent to fopen @mode */
+static int ModeFlags(const char *mode) {
+  int flags;
+  switch (mode[0]) {
+    case 'w':
+      flags = O_WRONLY | O_CREAT | O_TRUNC;
+      break;
+    case 'a':
+      flags = O_WRONLY | O_CREAT | O_APPEND;
+      break;
+    default:
+      flags = O_RDONLY;
+      break;
+  }
+  if (strchr(mode, '+')) {
+    flags = (flags & ~O_WRONLY) | O_RDWR;
+  }
+  return flags;
+}
+
+/**
+ * Open @filename as a packed file if it is one, or if small files are
+ * packed and it is being created. Returns whether it was opened here, with
+ * the stream (or null and errno) in @fp. The stream is a placeholder on
+ * /dev/null, so it is a real FILE* the app can pass around and close.
+ * */
+static bool OpenPacked(const char *filename, const char *mode, FILE *&fp) {
+  auto *config = DTIO_CONF;
+  if (!config->PackingEnabled()) {
+    return false;
+  }
+  std::string abs_path = std::filesystem::absolute(filename).string();
+  if (!config->ShouldIntercept(abs_path)) {
+    return false;
+  }
+  int flags = ModeFlags(mode);
+  dtio::PackedFile packed;
+  int ret = packed.Open(abs_path, flags, 0666);
+  if (ret == 0) {
+    return false;
+  }
+  fp = ret > 0 ? HERMES_STDIO_API->fopen("/dev/null", "r+") : nullptr;
+  if (fp) {
+    auto *client_meta = DTIO_CLIENT_META;
+    client_meta->RegisterStdioFp(
+        fp, abs_path, flags,
+        config->Policy(abs_path, dtio::IoClientType::kStdio));
+    auto *file_info = client_meta->GetStdioFileInfo(fp);
+    file_info->packed = std::move(packed);
+    if (flags & O_APPEND) {
+      file_info->current_offset = file_info->packed.Size();
+    }
+  }
+  return true;
+}
+
+/**
+ * Open @filename in runtime memory if an include rule keeps its files
+ * there. Returns whether it was opened here, with the stream (or null and
+ * errno) in @fp. A file on the PFS is left to the real fopen.
+ * */
+static bool OpenInMemory(const char *filename, const char *mode, FILE *&fp) {
+  auto *config = DTIO_CONF;
+  std::string abs_path = std::filesystem::absolute(filename).string();
+  if (!config->InMemory(abs_path)) {
+    return false;
+  }
+  int flags = ModeFlags(mode);
+  std::string name = chi::dtiomod::MemoryName(abs_path);
+  chi::dtiomod::MemoryInfo info = config->dtio_mod_.MemOpen(
+      HSHM_MCTX, chi::string(name), flags & O_CREAT, flags & O_TRUNC, 0666);
+  if (!info.in_memory_) {
+    if (info.exists_ || (flags & O_CREAT)) {
+      return false;
+    }
+    errno = ENOENT;
+    fp = nullptr;
+    return true;
+  }
+  fp = HERMES_STDIO_API->fopen("/dev/null", "r+");
+  if (fp) {
+    auto *client_meta = DTIO_CLIENT_META;
+    client_meta->RegisterStdioFp(
+        fp, name, flags, config->Policy(abs_path, dtio::IoClientType::kStdio));
+    auto *file_info = client_meta->GetStdioFileInfo(fp);
+    file_info->in_memory = true;
+    if (flags & O_APPEND) {
+      file_info->current_offset = info.size_;
+    }
+  }
+  return true;
+}
+
+}  // namespace dtio::stdio
+
 extern "C" {
 
 static __attribute__((constructor(101))) void init_posix(void) {}
@@ -67,6 +316,18 @@ int HERMES_DECL(MPI_Init)(int *argc, char ***argv) {
  * STDIO
  */
 FILE *HERMES_DECL(fopen)(const char *filename, const char *mode) {
+  // Small files may be packed, and not on the PFS at all
+  FILE *packed_fp;
+  if (dtio::stdio::OpenPacked(filename, mode, packed_fp)) {
+    return packed_fp;
+  }
+
+  // Files under memory rules are kept in the runtime, and not on the PFS
+  FILE *memory_fp;
+  if (dtio::stdio::OpenInMemory(filename, mode, memory_fp)) {
+    return memory_fp;
+  }
+
   // Call real fopen first
   FILE *real_fp = HERMES_STDIO_API->fopen(filename, mode);
   if (!real_fp) {
@@ -82,25 +343,99 @@ FILE *HERMES_DECL(fopen)(const char *filename, const char *mode) {
     return real_fp;
   }
 
-  // Register with metadata manager
+  // Register with metadata manager. An append stream starts at the end.
   auto *client_meta = DTIO_CLIENT_META;
-  int flags = 0;  // Convert mode to flags if needed
-  if (strchr(mode, 'w')) flags |= O_WRONLY;
-  if (strchr(mode, 'r')) flags |= O_RDONLY;
-  if (strchr(mode, '+')) flags |= O_RDWR;
-  if (strchr(mode, 'a')) flags |= O_APPEND;
-
-  client_meta->RegisterStdioFp(real_fp, abs_path, flags);
+  int flags = dtio::stdio::ModeFlags(mode);
+  client_meta->RegisterStdioFp(
+      real_fp, abs_path, flags,
+      config->Policy(abs_path, dtio::IoClientType::kStdio));
+  if (flags & O_APPEND) {
+    auto *file_info = client_meta->GetStdioFileInfo(real_fp);
+    off_t end = dtio::stdio::FileEnd(file_info);
+    client_meta->UpdateStdioOffset(real_fp, end > 0 ? end : 0);
+  }
+  if (flags & O_TRUNC) {
+    config->dtio_mod_.Truncate(HSHM_MCTX, chi::string(abs_path), 0);
+    client_meta->ClipWrittenEnd(abs_path, 0);
+  }
 
   return real_fp;
 }
 
 char *HERMES_DECL(fgets)(char *ptr, int count, FILE *stream) {
-  return nullptr;  // Not implemented
+  // Check if file pointer is registered with DTIO
+  auto *client_meta = DTIO_CLIENT_META;
+  if (!client_meta->IsStdioFpRegistered(stream)) {
+    // Not intercepted, call real API
+    return HERMES_STDIO_API->fgets(ptr, count, stream);
+  }
+
+  auto *file_info = client_meta->GetStdioFileInfo(stream);
+  if (file_info) {
+    if (count <= 0) {
+      return nullptr;
+    }
+    size_t max_size = count - 1;
+    ssize_t ret = 0;
+    if (max_size > 0) {
+      ret = dtio::stdio::DtioRead(file_info, ptr, max_size);
+    }
+    if (ret <= 0 && max_size > 0) {
+      file_info->eof = true;
+      return nullptr;
+    }
+
+    // Consume up to and including the first newline
+    size_t size = ret;
+    char *newline = static_cast<char *>(memchr(ptr, '\n', size));
+    if (newline) {
+      size = newline - ptr + 1;
+    } else if (size < max_size) {
+      file_info->eof = true;
+    }
+    ptr[size] = '\0';
+    off_t new_offset = file_info->current_offset + size;
+    file_info->readahead.Rewind(new_offset);
+    client_meta->UpdateStdioOffset(stream, new_offset);
+    return ptr;
+  }
+
+  // Fallback to real API
+  return HERMES_STDIO_API->fgets(ptr, count, stream);
 }
 
 size_t HERMES_DECL(fread)(void *ptr, size_t size, size_t count, FILE *stream) {
-  return 0;  // Not implemented
+  // Check if file pointer is registered with DTIO
+  auto *client_meta = DTIO_CLIENT_META;
+  if (!client_meta->IsStdioFpRegistered(stream)) {
+    // Not intercepted, call real API
+    return HERMES_STDIO_API->fread(ptr, size, count, stream);
+  }
+
+  auto *file_info = client_meta->GetStdioFileInfo(stream);
+  if (file_info) {
+    size_t total_size = size * count;
+    if (total_size == 0) {
+      return 0;
+    }
+    ssize_t ret = dtio::stdio::DtioRead(file_info, ptr, total_size);
+    if (ret < static_cast<ssize_t>(total_size)) {
+      file_info->eof = true;
+    }
+    if (ret <= 0) {
+      return 0;
+    }
+
+    // Only whole elements count as read
+    size_t nitems = ret / size;
+    off_t new_offset = file_info->current_offset + nitems * size;
+    file_info->readahead.Rewind(new_offset);
+    client_meta->UpdateStdioOffset(stream, new_offset);
+    return nitems;
+  }
+
+  // Fallback to real API
+  return HERMES_STDIO_API->fread(ptr, size, count, stream);
 }
 
 size_t HERMES_DECL(fwrite)(const void *ptr, size_t size, size_t count,
@@ -115,47 +450,180 @@ size_t HERMES_DECL(fwrite)(const void *ptr, size_t size, size_t count,
   // Get file info and submit to DTIO runtime
   auto *file_info = client_meta->GetStdioFileInfo(stream);
   if (file_info) {
-    auto *config = DTIO_CONF;
-
     size_t total_size = size * count;
+    if (total_size == 0) {
+      return 0;
+    }
+    ssize_t ret = dtio::stdio::DtioWrite(file_info, ptr, total_size);
+    if (ret <= 0) {
+      return 0;
+    }
+
+    // Update offset. Only whole elements count as written.
+    client_meta->UpdateStdioOffset(stream, file_info->current_offset + ret);
+    return ret / size;
+  }
+
+  // Fallback to real API
+  return HERMES_STDIO_API->fwrite(ptr, size, count, stream);
+}
+
+int HERMES_DECL(fseek)(FILE *stream, long int offset, int origin) {
+  // Check if file pointer is registered with DTIO
+  auto *client_meta = DTIO_CLIENT_META;
+  if (!client_meta->IsStdioFpRegistered(stream)) {
+    // Not intercepted, call real API
+    return HERMES_STDIO_API->fseek(stream, offset, origin);
+  }
 
-    // Allocate buffer in shared memory
-    hipc::FullPtr<char> shm_buf =
-        CHI_CLIENT->AllocateBuffer(HSHM_MCTX, total_size);
-    memcpy(shm_buf.ptr_, ptr, total_size);
+  auto *file_info = client_meta->GetStdioFileInfo(stream);
+  if (file_info) {
+    long int base = 0;
+    switch (origin) {
+      case SEEK_SET:
+        break;
+      case SEEK_CUR:
+        base = file_info->current_offset;
+        break;
+      case SEEK_END:
+        base = dtio::stdio::FileEnd(file_info);
+        if (base < 0) {
+          return -1;
+        }
+        break;
+      default:
+        errno = EINVAL;
+        return -1;
+    }
+    if (base + offset < 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    file_info->eof = false;
+    client_meta->UpdateStdioOffset(stream, base + offset);
+    return 0;
+  }
 
-    // Submit write task with filename as chi::string
-    config->dtio_mod_.Write(
-        HSHM_MCTX, shm_buf.shm_, total_size, file_info->current_offset,
-        chi::string(file_info->absolute_path), dtio::IoClientType::kStdio);
+  // Fallback to real API
+  return HERMES_STDIO_API->fseek(stream, offset, origin);
+}
+
+long int HERMES_DECL(ftell)(FILE *stream) {
+  // Check if file pointer is registered with DTIO
+  auto *client_meta = DTIO_CLIENT_META;
+  if (!client_meta->IsStdioFpRegistered(stream)) {
+    // Not intercepted, call real API
+    return HERMES_STDIO_API->ftell(stream);
+  }
 
-    // Update offset
-    client_meta->UpdateStdioOffset(stream,
-                                   file_info->current_offset + total_size);
+  auto *file_info = client_meta->GetStdioFileInfo(stream);
+  if (file_info) {
+    return file_info->current_offset;
+  }
 
-    // Free shared memory buffer
-    CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+  // Fallback to real API
+  return HERMES_STDIO_API->ftell(stream);
+}
 
-    return count;
+int HERMES_DECL(feof)(FILE *stream) {
+  // Check if file pointer is registered with DTIO
+  auto *client_meta = DTIO_CLIENT_META;
+  if (!client_meta->IsStdioFpRegistered(stream)) {
+    // Not intercepted, call real API
+    return HERMES_STDIO_API->feof(stream);
+  }
+
+  auto *file_info = client_meta->GetStdioFileInfo(stream);
+  if (file_info) {
+    return file_info->eof;
   }
 
   // Fallback to real API
-  return HERMES_STDIO_API->fwrite(ptr, size, count, stream);
+  return HERMES_STDIO_API->feof(stream);
 }
 
-int HERMES_DECL(fseek)(FILE *stream, long int offset, int origin) {
-  return -1;  // Not implemented
+int HERMES_DECL(fflush)(FILE *stream) {
+  auto *client_meta = DTIO_CLIENT_META;
+
+  // A null stream flushes every open stream
+  if (stream == nullptr) {
+    int failed = 0;
+    for (FILE *fp : client_meta->GetStdioFps()) {
+      auto *file_info = client_meta->GetStdioFileInfo(fp);
+      if (file_info) {
+        file_info->FlushWrites();
+        failed |= file_info->TakeError();
+        failed |= file_info->packed.Store(file_info->absolute_path);
+        if (!file_info->packed.Active() &&
+            dtio::stdio::MustPersist(file_info) &&
+            !DTIO_CONF->Persist(file_info->absolute_path)) {
+          errno = EIO;
+          failed = -1;
+        }
+      }
+    }
+    int ret = HERMES_STDIO_API->fflush(stream);
+    return failed < 0 ? EOF : ret;
+  }
+
+  if (client_meta->IsStdioFpRegistered(stream)) {
+    auto *file_info = client_meta->GetStdioFileInfo(stream);
+    if (file_info) {
+      // A buffered write that failed since the last flush fails this one
+      file_info->FlushWrites();
+      if (file_info->TakeError() < 0) {
+        return EOF;
+      }
+      // A packed file is seen by others once it is back in its pack
+      if (file_info->packed.Active()) {
+        return file_info->packed.Store(file_info->absolute_path) < 0 ? EOF
+                                                                     : 0;
+      }
+      if (dtio::stdio::MustPersist(file_info) &&
+          !DTIO_CONF->Persist(file_info->absolute_path)) {
+        errno = EIO;
+        return EOF;
+      }
+      return 0;
+    }
+  }
+
+  // Fallback to real API
+  return HERMES_STDIO_API->fflush(stream);
 }
 
 int HERMES_DECL(fclose)(FILE *stream) {
   // Remove from metadata manager if registered
+  int stored = 0;
   auto *client_meta = DTIO_CLIENT_META;
   if (client_meta->IsStdioFpRegistered(stream)) {
+    auto *file_info = client_meta->GetStdioFileInfo(stream);
+    if (file_info && file_info->packed.Active()) {
+      // A packed file goes back into its pack
+      stored = file_info->packed.Store(file_info->absolute_path);
+    } else if (file_info) {
+      file_info->FlushWrites();
+      stored = file_info->TakeError();
+      file_info->write_buffer.Release();
+      file_info->readahead.Release();
+      auto *config = DTIO_CONF;
+      if (dtio::stdio::MustPersist(file_info) &&
+          !config->Persist(file_info->absolute_path) && stored == 0) {
+        errno = EIO;
+        stored = -1;
+      }
+      if (config->log_structured_ && !file_info->in_memory &&
+          (file_info->flags & (O_WRONLY | O_RDWR))) {
+        config->dtio_mod_.CloseLog(HSHM_MCTX,
+                                   chi::string(file_info->absolute_path));
+      }
+    }
     client_meta->UnregisterStdioFp(stream);
   }
 
   // Call real fclose
-  return HERMES_STDIO_API->fclose(stream);
+  int ret = HERMES_STDIO_API->fclose(stream);
+  return stored < 0 ? EOF : ret;
 }
 
 }  // extern C
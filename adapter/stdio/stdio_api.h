@@ -52,6 +52,9 @@ typedef size_t (*fwrite_t)(const void *ptr, size_t size, size_t count,
                            FILE *stream);
 typedef int (*fseek_t)(FILE *stream, long int offset, int origin);
 typedef int (*fclose_t)(FILE *stream);
+typedef long int (*ftell_t)(FILE *stream);
+typedef int (*fflush_t)(FILE *stream);
+typedef int (*feof_t)(FILE *stream);
 }
 
 namespace dtio::stdio {
@@ -78,6 +81,12 @@ class StdioApi : public dtio::adapter::RealApi {
   fseek_t fseek = nullptr;
   /** fclose */
   fclose_t fclose = nullptr;
+  /** ftell */
+  ftell_t ftell = nullptr;
+  /** fflush */
+  fflush_t fflush = nullptr;
+  /** feof */
+  feof_t feof = nullptr;
 
   StdioApi() : dtio::adapter::RealApi("open", "stdio_intercepted") {
     interception_whitelist = std::make_shared<std::set<std::string> >();
@@ -96,6 +105,12 @@ class StdioApi : public dtio::adapter::RealApi {
 
     fclose = (fclose_t)dlsym(real_lib_, "fclose");
     REQUIRE_API(fclose)
+    ftell = (ftell_t)dlsym(real_lib_, "ftell");
+    REQUIRE_API(ftell)
+    fflush = (fflush_t)dlsym(real_lib_, "fflush");
+    REQUIRE_API(fflush)
+    feof = (feof_t)dlsym(real_lib_, "feof");
+    REQUIRE_API(feof)
   }
   StdioApi(const StdioApi &) = default;
   StdioApi(StdioApi &&) = default;
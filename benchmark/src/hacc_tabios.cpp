@@ -25,7 +25,7 @@
 #include "util.h"
 
 int main(int argc, char **argv) {
-  dtio::MPI_Init(&argc, &argv);
+  MPI_Init(&argc, &argv);
   if (argc != 5) {
     printf(
         "USAGE: ./hacc_tabios [dtio_conf] [file_path] [iteration] "
@@ -62,14 +62,14 @@ int main(int argc, char **argv) {
   Timer wbb = Timer();
   wbb.resumeTime();
 #endif
-  FILE *fh = dtio::fopen(filename.c_str(), "w+");
+  FILE *fh = fopen(filename.c_str(), "w+");
 #ifdef TIMERBASE
   wbb.pauseTime();
 #endif
   global_timer.pauseTime();
 
-  std::vector<std::pair<size_t, std::vector<task *>>> operations =
-      std::vector<std::pair<size_t, std::vector<task *>>>();
+  std::vector<std::pair<size_t, dtio::IoHandle *>> operations =
+      std::vector<std::pair<size_t, dtio::IoHandle *>>();
 
   for (int i = 0; i < iteration; ++i) {
     for (auto item : workload) {
@@ -97,7 +97,7 @@ int main(int argc, char **argv) {
   wbb.resumeTime();
 #endif
   for (auto operation : operations) {
-    auto bytes = dtio::fwrite_wait(operation.second);
+    auto bytes = dtio::wait(operation.second);
     if (bytes != operation.first) std::cerr << "Write failed\n";
   }
 #ifdef TIMERBASE
@@ -118,14 +118,14 @@ int main(int argc, char **argv) {
   Timer rbb = Timer();
   rbb.resumeTime();
 #endif
-  dtio::fclose(fh);
+  fclose(fh);
 
 #ifndef COLLECT
-  FILE *fh1 = dtio::fopen(filename.c_str(), "r+");
-  auto op = dtio::fread_async(sizeof(char), io_per_teration, fh1);
-  //    auto bytes= dtio::fread_wait(read_buf,op,filename);
-  //    if(bytes!=io_per_teration) std::cerr << "Read failed:" <<bytes<<"\n";
-  dtio::fclose(fh1);
+  FILE *fh1 = fopen(filename.c_str(), "r+");
+  auto op = dtio::fread_async(read_buf, sizeof(char), io_per_teration, fh1);
+  auto bytes = dtio::wait(op);
+  if (bytes != io_per_teration) std::cerr << "Read failed:" << bytes << "\n";
+  fclose(fh1);
 
 #endif
 
@@ -143,9 +143,11 @@ int main(int argc, char **argv) {
   Timer pfs = Timer();
   pfs.resumeTime();
 #endif
-  FILE *fh2 = dtio::fopen(output.c_str(), "w+");
-  dtio::fwrite_async(read_buf, sizeof(char), io_per_teration, fh2);
-  dtio::fclose(fh2);
+  FILE *fh2 = fopen(output.c_str(), "w+");
+  auto out_op =
+      dtio::fwrite_async(read_buf, sizeof(char), io_per_teration, fh2);
+  if (dtio::wait(out_op) != io_per_teration) std::cerr << "Write failed\n";
+  fclose(fh2);
 #ifdef TIMERBASE
   pfs.pauseTime();
   free(read_buf);
@@ -170,5 +172,5 @@ int main(int argc, char **argv) {
     stream << "average," << mean << "\n";
     std::cerr << stream.str();
   }
-  dtio::MPI_Finalize();
+  MPI_Finalize();
 }
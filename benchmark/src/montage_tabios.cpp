@@ -25,7 +25,7 @@
 #include "util.h"
 
 int main(int argc, char **argv) {
-  dtio::MPI_Init(&argc, &argv);
+  MPI_Init(&argc, &argv);
   if (argc != 5) {
     printf(
         "USAGE: ./montage_base [dtio_conf] [file_path] [iter] "
@@ -97,15 +97,15 @@ int main(int argc, char **argv) {
 #ifdef TIMERBASE
     w.resumeTime();
 #endif
-    fd1 = dtio::fopen(filename1.c_str(), "w+");
-    fd2 = dtio::fopen(filename2.c_str(), "w+");
+    fd1 = fopen(filename1.c_str(), "w+");
+    fd2 = fopen(filename2.c_str(), "w+");
 #ifdef TIMERBASE
     w.pauseTime();
 #endif
   }
   global_timer.pauseTime();
-  std::vector<std::pair<size_t, std::vector<task *>>> operations =
-      std::vector<std::pair<size_t, std::vector<task *>>>();
+  std::vector<std::pair<size_t, dtio::IoHandle *>> operations =
+      std::vector<std::pair<size_t, dtio::IoHandle *>>();
 
   for (int i = 0; i < iteration; ++i) {
     for (auto item : workload) {
@@ -139,11 +139,11 @@ int main(int argc, char **argv) {
 #endif
   if (rank % 2 == 0 || comm_size == 1) {
     for (auto operation : operations) {
-      auto bytes = dtio::fwrite_wait(operation.second);
+      auto bytes = dtio::wait(operation.second);
       if (bytes != operation.first) std::cerr << "Write failed\n";
     }
-    dtio::fclose(fd1);
-    dtio::fclose(fd2);
+    fclose(fd1);
+    fclose(fd2);
   }
 #ifdef TIMERBASE
   w.pauseTime();
@@ -182,8 +182,8 @@ int main(int argc, char **argv) {
       filename2 = file_path + "file2_" + std::to_string(rank - 1) + ".dat";
     }
 
-    fd1 = dtio::fopen(filename1.c_str(), "r+");
-    fd2 = dtio::fopen(filename2.c_str(), "r+");
+    fd1 = fopen(filename1.c_str(), "r+");
+    fd2 = fopen(filename2.c_str(), "r+");
   }
 #ifdef TIMERBASE
   r.pauseTime();
@@ -201,8 +201,8 @@ int main(int argc, char **argv) {
         if (rank % 2 != 0 || comm_size == 1) {
           ssize_t bytes = 0;
 #ifndef COLLECT
-          bytes = dtio::fread(read_buf, sizeof(char), item[0] / 2, fd1);
-          bytes += dtio::fread(read_buf, sizeof(char), item[0] / 2, fd2);
+          bytes = fread(read_buf, sizeof(char), item[0] / 2, fd1);
+          bytes += fread(read_buf, sizeof(char), item[0] / 2, fd2);
           if (bytes != item[0])
             std::cerr << "Read() failed!" << "Bytes:" << bytes
                       << "\tError code:" << errno << "\n";
@@ -221,8 +221,8 @@ int main(int argc, char **argv) {
   r.resumeTime();
 #endif
   if (rank % 2 != 0 || comm_size == 1) {
-    dtio::fclose(fd1);
-    dtio::fclose(fd2);
+    fclose(fd1);
+    fclose(fd2);
   }
 #ifdef TIMERBASE
   r.pauseTime();
@@ -250,7 +250,7 @@ int main(int argc, char **argv) {
   std::string finalname = final_path + "final_" + std::to_string(rank) + ".dat";
   FILE *outfile;
   global_timer.resumeTime();
-  outfile = dtio::fopen(finalname.c_str(), "w+");
+  outfile = fopen(finalname.c_str(), "w+");
   global_timer.pauseTime();
   for (auto i = 0; i < 32; ++i) {
     for (int j = 0; j < comm_size * 1024 * 128; ++j) {
@@ -267,8 +267,8 @@ int main(int argc, char **argv) {
   char final_buff[1024 * 1024];
   gen_random(final_buff, 1024 * 1024);
   global_timer.resumeTime();
-  dtio::fwrite(final_buff, sizeof(char), 1024 * 1024, outfile);
-  dtio::fclose(outfile);
+  fwrite(final_buff, sizeof(char), 1024 * 1024, outfile);
+  fclose(outfile);
 #ifdef TIMERBASE
   a.pauseTime();
 #endif
@@ -294,5 +294,5 @@ int main(int argc, char **argv) {
     stream << "average," << mean << "\n";
     std::cerr << stream.str();
   }
-  dtio::MPI_Finalize();
+  MPI_Finalize();
 }
@@ -25,7 +25,7 @@
 #include "util.h"
 
 int main(int argc, char **argv) {
-  dtio::MPI_Init(&argc, &argv);
+  MPI_Init(&argc, &argv);
   if (argc != 2) {
     printf("USAGE: ./stress_test [dtio_conf]\n");
     exit(1);
@@ -39,10 +39,10 @@ int main(int argc, char **argv) {
   int num_iterations = 128;
   Timer global_timer = Timer();
   global_timer.resumeTime();
-  FILE *fh = dtio::fopen("file.test", "w+");
+  FILE *fh = fopen("file.test", "w+");
   global_timer.pauseTime();
-  std::vector<std::pair<size_t, std::vector<task *>>> operations =
-      std::vector<std::pair<size_t, std::vector<task *>>>();
+  std::vector<std::pair<size_t, dtio::IoHandle *>> operations =
+      std::vector<std::pair<size_t, dtio::IoHandle *>>();
   char write_buf[io_size];
   gen_random(write_buf, io_size);
   for (int i = 0; i < num_iterations; ++i) {
@@ -55,7 +55,7 @@ int main(int argc, char **argv) {
       for (int task = 0; task < 32; ++task) {
         auto operation = operations[task];
         global_timer.resumeTime();
-        auto bytes = dtio::fwrite_wait(operation.second);
+        auto bytes = dtio::wait(operation.second);
         if (bytes != operation.first) std::cerr << "Write failed\n";
         global_timer.pauseTime();
       }
@@ -65,12 +65,12 @@ int main(int argc, char **argv) {
   }
   global_timer.resumeTime();
   for (auto operation : operations) {
-    auto bytes = dtio::fwrite_wait(operation.second);
+    auto bytes = dtio::wait(operation.second);
     if (bytes != operation.first) std::cerr << "Write failed\n";
   }
   global_timer.pauseTime();
   global_timer.resumeTime();
-  dtio::fclose(fh);
+  fclose(fh);
   global_timer.pauseTime();
   if (rank == 0) std::cerr << "Done writing. Now reducing\n";
   auto time = global_timer.getElapsedTime();
@@ -85,5 +85,5 @@ int main(int argc, char **argv) {
     stream << "mean," << mean << "\tmax," << max << "\tmin," << min << "\n";
     std::cerr << stream.str();
   }
-  dtio::MPI_Finalize();
+  MPI_Finalize();
 }
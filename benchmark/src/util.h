@@ -27,29 +27,56 @@
 
 #include <fcntl.h>
 
+#include "dtio/dtio_async.h"
 #include "dtio/return_codes.h"
 #include "dtio/utilities.h"
 /* #include <fstream> */
 #include <malloc.h>
 #include <mpi.h>
 
+#include <array>
+#include <chrono>
+#include <cstring>
 #include <iomanip>
+#include <iostream>
 #include <random>
-/* #include <sstream> */
+#include <sstream>
+#include <vector>
 #include <zconf.h>
 
-/* static void gen_random(char *s, std::size_t len) { */
-/*   static const char alphanum[] = "0123456789" */
-/*                                  "ABCDEFGHIJKLMNOPQRSTUVWXYZ" */
-/*                                  "abcdefghijklmnopqrstuvwxyz"; */
-/*   std::default_random_engine generator; */
-/*   std::uniform_int_distribution<int> dist(1, 1000000); */
-/*   for (int i = 0; i < len; ++i) { */
-/*     s[i] = alphanum[dist(generator) % (sizeof(alphanum) - 1)]; */
-/*   } */
+/** Accumulates wall-clock time across resume/pause intervals */
+class Timer {
+ public:
+  Timer() : elapsed_time_(0) {}
 
-/*   s[len] = 0; */
-/* } */
+  void resumeTime() { start_ = std::chrono::high_resolution_clock::now(); }
+
+  double pauseTime() {
+    auto end = std::chrono::high_resolution_clock::now();
+    elapsed_time_ += std::chrono::duration<double>(end - start_).count();
+    return elapsed_time_;
+  }
+
+  /** Elapsed time in seconds */
+  double getElapsedTime() const { return elapsed_time_; }
+
+ private:
+  std::chrono::high_resolution_clock::time_point start_;
+  double elapsed_time_;
+};
+
+/** Fill @s with @len random alphanumeric characters (not NUL-terminated) */
+static void gen_random(char *s, std::size_t len) {
+  static const char alphanum[] =
+      "0123456789"
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+      "abcdefghijklmnopqrstuvwxyz";
+  static std::default_random_engine generator;
+  std::uniform_int_distribution<int> dist(0, sizeof(alphanum) - 2);
+  for (std::size_t i = 0; i < len; ++i) {
+    s[i] = alphanum[dist(generator)];
+  }
+}
 
 /* static float get_average_ts() { */
 /*   /\* run system command du -s to calculate size of director. *\/ */
@@ -0,0 +1,315 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef CHI_dtiomod_CHUNKS_H_
+#define CHI_dtiomod_CHUNKS_H_
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+
+namespace chi::dtiomod {
+
+/** A chunk of a file held on this container, as recorded in CHUNK_DB */
+struct ChunkEntry {
+  size_t end_; /**< Bytes of the chunk's object that have been written */
+};
+
+/**
+ * Stores files in fixed-size chunks, one object per chunk. A chunk is owned
+ * by the container ExtentMap::Home picks for it, which is the only one
+ * that reads or writes its object, so a large file is spread over every
+ * container and no two of them share a file on the PFS.
+ *
+ * The objects of a file live in "<path>.chunks/<index>". The file's own
+ * path is kept as a sparse stub: each write past its end sets the last
+ * byte written, so its size stays that of the chunked file for stat and
+ * lseek. Data that was in the file before it was chunked is copied into a
+ * chunk's object the first time the chunk is written. Chunks never written
+ * are read from the file in place.
+ *
+ * CHUNK_DB is the per-container map from a file to the chunks it owns.
+ * When a file is truncated or unlinked, every container forgets its chunks
+ * and one of them trims the objects.
+ * */
+class ChunkStore {
+ public:
+  void Configure(size_t chunk_size) { chunk_size_ = chunk_size; }
+
+  bool Enabled() const { return chunk_size_ > 0; }
+
+  /** Write @size bytes of @data at @offset of @path. Returns the bytes
+   * written, or -1. */
+  ssize_t Write(const std::string &path, size_t offset, const char *data,
+                size_t size) {
+    std::shared_ptr<FileChunks> file = GetFile(path);
+    size_t done = 0;
+    while (done < size) {
+      size_t pos = offset + done;
+      size_t chunk = pos / chunk_size_;
+      size_t chunk_off = pos % chunk_size_;
+      size_t len = std::min(size - done, chunk_size_ - chunk_off);
+      ChunkEntry *entry;
+      {
+        std::lock_guard<std::mutex> guard(file->lock_);
+        entry = Open(path, *file, chunk);
+      }
+      if (!entry) {
+        break;
+      }
+      ssize_t ret = PosixWrite(ChunkPath(path, chunk), data + done, len,
+                               chunk_off, false);
+      if (ret < 0 && errno == ENOENT) {
+        // The file was removed outside DTIO, so forget what it held
+        std::lock_guard<std::mutex> guard(file->lock_);
+        file->chunks_.erase(chunk);
+        file->size_ = 0;
+        entry = Open(path, *file, chunk);
+        if (entry) {
+          ret = PosixWrite(ChunkPath(path, chunk), data + done, len,
+                           chunk_off, false);
+        }
+      }
+      if (ret <= 0) {
+        break;
+      }
+      {
+        std::lock_guard<std::mutex> guard(file->lock_);
+        entry->end_ = std::max(entry->end_, chunk_off + ret);
+      }
+      done += ret;
+      if (static_cast<size_t>(ret) < len) {
+        break;
+      }
+    }
+    if (!done) {
+      return -1;
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    Extend(path, *file, offset + done);
+    return done;
+  }
+
+  /**
+   * Read @size bytes at @offset of @path into @data. Returns the bytes up
+   * to the end of the file, or -1. Objects are only ever replaced whole,
+   * so reads need no lock.
+   * */
+  ssize_t Read(const std::string &path, size_t offset, char *data,
+               size_t size) {
+    bool short_read = false;
+    for (size_t done = 0; done < size;) {
+      size_t pos = offset + done;
+      size_t chunk = pos / chunk_size_;
+      size_t chunk_off = pos % chunk_size_;
+      size_t len = std::min(size - done, chunk_size_ - chunk_off);
+      ssize_t ret = PosixRead(ChunkPath(path, chunk), data + done, len,
+                              chunk_off);
+      if (ret == kNoObject) {
+        ret = PosixRead(path, data + done, len, pos);
+      }
+      if (ret == kNoObject) {
+        ret = 0;
+      }
+      if (ret < 0) {
+        return -1;
+      }
+      if (static_cast<size_t>(ret) < len) {
+        memset(data + done + ret, 0, len - ret);
+        short_read = true;
+      }
+      done += len;
+    }
+    if (!short_read) {
+      return size;
+    }
+    // Tell holes from the end of the file by the stub's size
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+      return errno == ENOENT ? 0 : -1;
+    }
+    size_t file_size = st.st_size;
+    return file_size > offset ? std::min(size, file_size - offset) : 0;
+  }
+
+  /**
+   * Drop what @path holds past @size bytes, since the file was truncated
+   * there, or all of it if @unlinked. Every container forgets its chunks
+   * of the file. Only the @owner, one container picked for the file,
+   * removes the objects past @size and cuts the one @size falls in, or
+   * removes them all with their directory.
+   * */
+  void Truncate(const std::string &path, size_t size, bool unlinked,
+                bool owner) {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      chunk_db_.erase(path);
+    }
+    if (!owner) {
+      return;
+    }
+    std::string dir = path + ".chunks";
+    DIR *objects = opendir(dir.c_str());
+    if (objects) {
+      while (struct dirent *ent = readdir(objects)) {
+        std::string name = ent->d_name;
+        if (name == "." || name == "..") {
+          continue;
+        }
+        std::string object = dir + "/" + name;
+        char *end;
+        size_t begin = strtoull(name.c_str(), &end, 10) * chunk_size_;
+        if (unlinked || (*end == '\0' && begin >= size)) {
+          unlink(object.c_str());
+        } else if (*end == '\0' && begin + chunk_size_ > size) {
+          truncate64(object.c_str(), size - begin);
+        }
+      }
+      closedir(objects);
+    }
+    if (unlinked) {
+      rmdir(dir.c_str());
+    } else {
+      truncate64(path.c_str(), size);
+    }
+  }
+
+  /** The chunks of @path owned by this container */
+  std::map<size_t, ChunkEntry> Chunks(const std::string &path) {
+    std::shared_ptr<FileChunks> file = GetFile(path);
+    std::lock_guard<std::mutex> guard(file->lock_);
+    return file->chunks_;
+  }
+
+ private:
+  /** A read of a chunk that has no object */
+  CLS_CONST ssize_t kNoObject = -2;
+
+  struct FileChunks {
+    std::mutex lock_;
+    std::map<size_t, ChunkEntry> chunks_;
+    size_t size_ = 0; /**< The stub's size is known to be at least this */
+  };
+
+  std::shared_ptr<FileChunks> GetFile(const std::string &path) {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::shared_ptr<FileChunks> &file = chunk_db_[path];
+    if (!file) {
+      file = std::make_shared<FileChunks>();
+    }
+    return file;
+  }
+
+  /**
+   * @chunk's entry, creating its object from the file's data in place if
+   * it has none. Requires @file's lock.
+   * */
+  ChunkEntry *Open(const std::string &path, FileChunks &file, size_t chunk) {
+    auto it = file.chunks_.find(chunk);
+    if (it != file.chunks_.end()) {
+      return &it->second;
+    }
+    std::string object = ChunkPath(path, chunk);
+    ChunkEntry entry{0};
+    struct stat st;
+    if (stat(object.c_str(), &st) == 0) {
+      // Written before this container started
+      entry.end_ = st.st_size;
+    } else {
+      // Seed the object from the file in place, then publish it whole
+      mkdir((path + ".chunks").c_str(), 0775);
+      std::vector<char> seed(chunk_size_);
+      ssize_t ret =
+          PosixRead(path, seed.data(), seed.size(), chunk * chunk_size_);
+      ret = ret == kNoObject ? 0 : ret;
+      std::string tmp = object + ".tmp";
+      if (ret < 0 || PosixWrite(tmp, seed.data(), ret, 0, true) != ret ||
+          rename(tmp.c_str(), object.c_str()) < 0) {
+        unlink(tmp.c_str());
+        return nullptr;
+      }
+      entry.end_ = ret;
+    }
+    return &file.chunks_.emplace(chunk, entry).first->second;
+  }
+
+  /**
+   * Grow the stub of @path to at least @end bytes. Only the owner of the
+   * chunk holding byte @end - 1 writes it, and that chunk is read from its
+   * object, so the byte set here is never read back.
+   * */
+  void Extend(const std::string &path, FileChunks &file, size_t end) {
+    if (end <= file.size_) {
+      return;
+    }
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 &&
+        static_cast<size_t>(st.st_size) >= end) {
+      file.size_ = st.st_size;
+      return;
+    }
+    char zero = 0;
+    if (PosixWrite(path, &zero, 1, end - 1, true) == 1) {
+      file.size_ = end;
+    }
+  }
+
+  std::string ChunkPath(const std::string &path, size_t chunk) const {
+    return path + ".chunks/" + std::to_string(chunk);
+  }
+
+  static ssize_t PosixWrite(const std::string &path, const char *data,
+                            size_t size, size_t offset, bool create) {
+    int fd = open64(path.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0664);
+    if (fd < 0) {
+      return -1;
+    }
+    ssize_t ret = pwrite64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+
+  /** Returns kNoObject if @path does not exist */
+  static ssize_t PosixRead(const std::string &path, char *data, size_t size,
+                           size_t offset) {
+    int fd = open64(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return errno == ENOENT ? kNoObject : -1;
+    }
+    ssize_t ret = pread64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+
+  size_t chunk_size_ = 0;
+  std::mutex lock_;
+  /** CHUNK_DB: the chunks of each file owned by this container */
+  std::unordered_map<std::string, std::shared_ptr<FileChunks>> chunk_db_;
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_CHUNKS_H_
@@ -13,12 +13,35 @@
 #ifndef CHI_dtiomod_H_
 #define CHI_dtiomod_H_
 
+#include "dtiomod_locality.h"
+#include "dtiomod_memory.h"
 #include "dtiomod_tasks.h"
 
 namespace chi::dtiomod {
 
 /** Create dtiomod requests */
 class Client : public ModuleClient {
+ public:
+  /** The QoS identity attached to every I/O task issued by this client */
+  IoOpts io_opts_;
+  /**
+   * I/O is split at multiples of this, so each piece reaches the container
+   * that holds its stripe's data (0 is off). Set when the runtime keeps
+   * data in tiers above the PFS.
+   * */
+  size_t split_size_ = 0;
+  /**
+   * Files are stored in chunks of split_size_ owned by the containers they
+   * hash to, so pieces are sent there without a Schedule task
+   * */
+  bool chunked_ = false;
+  /**
+   * Files are log-structured, so I/O on them goes to the container on this
+   * node, which keeps this node's log
+   * */
+  bool logged_ = false;
+  u32 num_containers_ = 1;
+
  public:
   /** Default constructor */
   HSHM_INLINE_CROSS_FUN
@@ -29,15 +52,20 @@ class Client : public ModuleClient {
   ~Client() = default;
 
   CHI_BEGIN(Create)
-  /** Create a pool */
-  HSHM_INLINE_CROSS_FUN
-  void Create(const hipc::MemContext &mctx, const DomainQuery &dom_query,
-              const DomainQuery &affinity, const chi::string &pool_name,
-              const CreateContext &ctx = CreateContext(), int dtiomod_id = 0) {
+  /** Create a pool. @params are forwarded to CreateTaskParams. */
+  template <typename... Args>
+  HSHM_INLINE_CROSS_FUN void Create(const hipc::MemContext &mctx,
+                                    const DomainQuery &dom_query,
+                                    const DomainQuery &affinity,
+                                    const chi::string &pool_name,
+                                    const CreateContext &ctx = CreateContext(),
+                                    Args &&...params) {
     FullPtr<CreateTask> task =
-        AsyncCreate(mctx, dom_query, affinity, pool_name, ctx, dtiomod_id);
+        AsyncCreate(mctx, dom_query, affinity, pool_name, ctx,
+                    std::forward<Args>(params)...);
     task->Wait();
     Init(task->ctx_.id_);
+    num_containers_ = std::max<u32>(task->ctx_.global_containers_, 1);
     CHI_CLIENT->DelTask(mctx, task);
   }
   CHI_TASK_METHODS(Create);
@@ -54,38 +82,139 @@ class Client : public ModuleClient {
   CHI_TASK_METHODS(Destroy)
   CHI_END(Destroy)
 
+  /** A piece of an I/O that lies within one split */
+  struct IoPiece {
+    size_t offset_;
+    size_t size_;
+    size_t buf_off_; /**< Where the piece starts in the I/O's buffer */
+  };
+
+  /** Split @size bytes at @offset at multiples of split_size_ */
+  std::vector<IoPiece> SplitIo(size_t offset, size_t size) const {
+    std::vector<IoPiece> pieces;
+    for (size_t done = 0; done < size || pieces.empty();) {
+      size_t len = size - done;
+      if (split_size_) {
+        size_t pos = offset + done;
+        len = std::min(len, split_size_ - pos % split_size_);
+      }
+      pieces.push_back(IoPiece{offset + done, len, done});
+      done += len;
+    }
+    return pieces;
+  }
+
+  /**
+   * Issue @pieces of an I/O on @data as @op, each to the container that
+   * should service it, and wait for them. Returns the bytes transferred up
+   * to the first short piece.
+   * */
+  ssize_t SplitIoWait(const hipc::MemContext &mctx, const hipc::Pointer &data,
+                      const std::vector<IoPiece> &pieces,
+                      const chi::string &filename, dtio::IoClientType iface,
+                      dtio::Operation op, const IoOpts &opts) {
+    std::vector<size_t> sizes, offsets;
+    for (const IoPiece &piece : pieces) {
+      sizes.push_back(piece.size_);
+      offsets.push_back(piece.offset_);
+    }
+    std::vector<DomainQuery> doms =
+        ScheduleIo(mctx, sizes, filename, offsets, op);
+    std::vector<FullPtr<WriteTask>> writes;
+    std::vector<FullPtr<ReadTask>> reads;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+      const IoPiece &piece = pieces[i];
+      if (op == dtio::Operation::kWrite) {
+        writes.emplace_back(AsyncWrite(mctx, doms[i], data + piece.buf_off_,
+                                       piece.size_, piece.offset_, filename,
+                                       iface, opts));
+      } else {
+        reads.emplace_back(AsyncRead(mctx, doms[i], data + piece.buf_off_,
+                                     piece.size_, piece.offset_, filename,
+                                     iface, opts));
+      }
+    }
+    ssize_t ret = 0;
+    bool short_piece = false;
+    auto finish = [&](auto &task, size_t size) {
+      task->Wait();
+      if (!short_piece) {
+        if (task->ret_ < 0) {
+          ret = ret ? ret : task->ret_;
+        } else {
+          ret += task->ret_;
+        }
+        short_piece = task->ret_ != static_cast<ssize_t>(size);
+      }
+      CHI_CLIENT->DelTask(mctx, task);
+    };
+    for (size_t i = 0; i < writes.size(); ++i) {
+      finish(writes[i], pieces[i].size_);
+    }
+    for (size_t i = 0; i < reads.size(); ++i) {
+      finish(reads[i], pieces[i].size_);
+    }
+    return ret;
+  }
+
   CHI_BEGIN(Write)
-  /** Write task */
-  void Write(const hipc::MemContext &mctx, const hipc::Pointer &data,
-             size_t data_size, size_t data_offset, const chi::string &filename,
-             dtio::IoClientType iface) {
-    int snum = Schedule(HSHM_MCTX, chi::DomainQuery::GetDirectHash(
-                                       chi::SubDomain::kGlobalContainers, 0));
+  /** Write task. Returns the number of bytes written. */
+  ssize_t Write(const hipc::MemContext &mctx, const hipc::Pointer &data,
+                size_t data_size, size_t data_offset,
+                const chi::string &filename, dtio::IoClientType iface) {
+    return Write(mctx, data, data_size, data_offset, filename, iface,
+                 io_opts_);
+  }
+  /** Write task with the options of one file */
+  ssize_t Write(const hipc::MemContext &mctx, const hipc::Pointer &data,
+                size_t data_size, size_t data_offset,
+                const chi::string &filename, dtio::IoClientType iface,
+                const IoOpts &opts) {
+    std::vector<IoPiece> pieces = SplitIo(data_offset, data_size);
+    if (pieces.size() > 1) {
+      return SplitIoWait(mctx, data, pieces, filename, iface,
+                         dtio::Operation::kWrite, opts);
+    }
     FullPtr<WriteTask> task =
         AsyncWrite(mctx,
-                   chi::DomainQuery::GetDirectHash(
-                       chi::SubDomain::kGlobalContainers, snum),
-                   data, data_size, data_offset, filename, iface);
+                   ScheduleIo(mctx, filename, data_offset, data_size,
+                              dtio::Operation::kWrite),
+                   data, data_size, data_offset, filename, iface, opts);
     task->Wait();
+    ssize_t ret = task->ret_;
     CHI_CLIENT->DelTask(mctx, task);
+    return ret;
   }
   CHI_TASK_METHODS(Write);
   CHI_END(Write)
 
   CHI_BEGIN(Read)
-  /** Read task */
-  void Read(const hipc::MemContext &mctx, const hipc::Pointer &data,
-            size_t data_size, size_t data_offset, const chi::string &filename,
-            dtio::IoClientType iface) {
-    int snum = Schedule(HSHM_MCTX, chi::DomainQuery::GetDirectHash(
-                                       chi::SubDomain::kGlobalContainers, 0));
+  /** Read task. Returns the number of bytes read. */
+  ssize_t Read(const hipc::MemContext &mctx, const hipc::Pointer &data,
+               size_t data_size, size_t data_offset,
+               const chi::string &filename, dtio::IoClientType iface) {
+    return Read(mctx, data, data_size, data_offset, filename, iface,
+                io_opts_);
+  }
+  /** Read task with the options of one file */
+  ssize_t Read(const hipc::MemContext &mctx, const hipc::Pointer &data,
+               size_t data_size, size_t data_offset,
+               const chi::string &filename, dtio::IoClientType iface,
+               const IoOpts &opts) {
+    std::vector<IoPiece> pieces = SplitIo(data_offset, data_size);
+    if (pieces.size() > 1) {
+      return SplitIoWait(mctx, data, pieces, filename, iface,
+                         dtio::Operation::kRead, opts);
+    }
     FullPtr<ReadTask> task =
         AsyncRead(mctx,
-                  chi::DomainQuery::GetDirectHash(
-                      chi::SubDomain::kGlobalContainers, snum),
-                  data, data_size, data_offset, filename, iface);
+                  ScheduleIo(mctx, filename, data_offset, data_size,
+                             dtio::Operation::kRead),
+                  data, data_size, data_offset, filename, iface, opts);
     task->Wait();
+    ssize_t ret = task->ret_;
     CHI_CLIENT->DelTask(mctx, task);
+    return ret;
   }
   CHI_TASK_METHODS(Read);
   CHI_END(Read)
@@ -128,17 +257,633 @@ class Client : public ModuleClient {
   CHI_END(MetaGet)
 
   CHI_BEGIN(Schedule)
-  /** Schedule task */
-  int Schedule(const hipc::MemContext &mctx, const DomainQuery &dom_query) {
-    FullPtr<ScheduleTask> task = AsyncSchedule(mctx, dom_query);
+  /**
+   * Schedule task. Returns the container chosen for each size. Tasks on a
+   * named file are placed by where its data lives.
+   * */
+  std::vector<u32> Schedule(const hipc::MemContext &mctx,
+                            const DomainQuery &dom_query,
+                            const std::vector<size_t> &sizes,
+                            const chi::string &filename = chi::string(),
+                            const std::vector<size_t> &offsets = {},
+                            dtio::Operation op = dtio::Operation::kWrite) {
+    FullPtr<ScheduleTask> task =
+        AsyncSchedule(mctx, dom_query, sizes, filename, offsets, op);
     task->Wait();
-    int schedule_num = task->schedule_num_;
+    std::vector<u32> placement(task->placement_.begin(),
+                               task->placement_.end());
     CHI_CLIENT->DelTask(mctx, task);
-    return schedule_num;
+    return placement;
   }
   CHI_TASK_METHODS(Schedule);
+
+  /** The containers that should service a batch of I/O tasks */
+  std::vector<DomainQuery> ScheduleIo(
+      const hipc::MemContext &mctx, const std::vector<size_t> &sizes,
+      const chi::string &filename = chi::string(),
+      const std::vector<size_t> &offsets = {},
+      dtio::Operation op = dtio::Operation::kWrite) {
+    std::vector<DomainQuery> doms;
+    doms.reserve(sizes.size());
+    if (IsMemoryName(filename.str())) {
+      doms.assign(sizes.size(), FileHome(filename));
+      return doms;
+    }
+    if (logged_ && filename.size()) {
+      doms.assign(sizes.size(), chi::DomainQuery::GetLocalHash(0));
+      return doms;
+    }
+    if (chunked_ && filename.size() && offsets.size() == sizes.size()) {
+      std::string path = filename.str();
+      for (size_t offset : offsets) {
+        doms.emplace_back(chi::DomainQuery::GetDirectHash(
+            chi::SubDomain::kGlobalContainers,
+            ExtentMap::Home(path, offset / split_size_, num_containers_)));
+      }
+      return doms;
+    }
+    std::vector<u32> placement =
+        Schedule(mctx,
+                 chi::DomainQuery::GetDirectHash(
+                     chi::SubDomain::kGlobalContainers, 0),
+                 sizes, filename, offsets, op);
+    for (u32 container : placement) {
+      doms.emplace_back(chi::DomainQuery::GetDirectHash(
+          chi::SubDomain::kGlobalContainers, container));
+    }
+    return doms;
+  }
+
+  /** The container that should service an I/O task of @size bytes */
+  DomainQuery ScheduleIo(const hipc::MemContext &mctx, size_t size) {
+    return ScheduleIo(mctx, std::vector<size_t>{size})[0];
+  }
+
+  /** The container that should service @op on @size bytes at @offset */
+  DomainQuery ScheduleIo(const hipc::MemContext &mctx,
+                         const chi::string &filename, size_t offset,
+                         size_t size, dtio::Operation op) {
+    return ScheduleIo(mctx, std::vector<size_t>{size}, filename,
+                      std::vector<size_t>{offset}, op)[0];
+  }
   CHI_END(Schedule)
 
+  CHI_BEGIN(WriteV)
+  /** Vectored write task */
+  ssize_t WriteV(const hipc::MemContext &mctx, const hipc::Pointer &data,
+                 const std::vector<size_t> &seg_sizes, size_t data_offset,
+                 const chi::string &filename, dtio::IoClientType iface) {
+    return WriteV(mctx, data, seg_sizes, data_offset, filename, iface,
+                  io_opts_);
+  }
+  /** Vectored write task with the options of one file */
+  ssize_t WriteV(const hipc::MemContext &mctx, const hipc::Pointer &data,
+                 const std::vector<size_t> &seg_sizes, size_t data_offset,
+                 const chi::string &filename, dtio::IoClientType iface,
+                 const IoOpts &opts) {
+    size_t data_size = 0;
+    for (size_t seg_size : seg_sizes) {
+      data_size += seg_size;
+    }
+    // The segments are contiguous in @data, so pieces need no iovecs
+    std::vector<IoPiece> pieces = SplitIo(data_offset, data_size);
+    if (pieces.size() > 1) {
+      return SplitIoWait(mctx, data, pieces, filename, iface,
+                         dtio::Operation::kWrite, opts);
+    }
+    FullPtr<WriteVTask> task =
+        AsyncWriteV(mctx,
+                    ScheduleIo(mctx, filename, data_offset, data_size,
+                               dtio::Operation::kWrite),
+                    data, seg_sizes, data_size, data_offset, filename, iface,
+                    opts);
+    task->Wait();
+    ssize_t ret = task->ret_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return ret;
+  }
+  CHI_TASK_METHODS(WriteV);
+  CHI_END(WriteV)
+
+  CHI_BEGIN(ReadV)
+  /** Vectored read task */
+  ssize_t ReadV(const hipc::MemContext &mctx, const hipc::Pointer &data,
+                const std::vector<size_t> &seg_sizes, size_t data_offset,
+                const chi::string &filename, dtio::IoClientType iface) {
+    return ReadV(mctx, data, seg_sizes, data_offset, filename, iface,
+                 io_opts_);
+  }
+  /** Vectored read task with the options of one file */
+  ssize_t ReadV(const hipc::MemContext &mctx, const hipc::Pointer &data,
+                const std::vector<size_t> &seg_sizes, size_t data_offset,
+                const chi::string &filename, dtio::IoClientType iface,
+                const IoOpts &opts) {
+    size_t data_size = 0;
+    for (size_t seg_size : seg_sizes) {
+      data_size += seg_size;
+    }
+    std::vector<IoPiece> pieces = SplitIo(data_offset, data_size);
+    if (pieces.size() > 1) {
+      return SplitIoWait(mctx, data, pieces, filename, iface,
+                         dtio::Operation::kRead, opts);
+    }
+    FullPtr<ReadVTask> task =
+        AsyncReadV(mctx,
+                   ScheduleIo(mctx, filename, data_offset, data_size,
+                              dtio::Operation::kRead),
+                   data, seg_sizes, data_size, data_offset, filename, iface,
+                   opts);
+    task->Wait();
+    ssize_t ret = task->ret_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return ret;
+  }
+  CHI_TASK_METHODS(ReadV);
+  CHI_END(ReadV)
+
+  CHI_BEGIN(CollectStats)
+  /** CollectStats is long-running and only issued by the runtime */
+  CHI_TASK_METHODS(CollectStats);
+  CHI_END(CollectStats)
+
+  CHI_BEGIN(PublishStats)
+  /** Report the load on a container. Does not wait for completion. */
+  void PublishStats(const hipc::MemContext &mctx, const DomainQuery &dom_query,
+                    const WorkerStats &stats) {
+    AsyncPublishStats(mctx, dom_query, stats);
+  }
+  CHI_TASK_METHODS(PublishStats);
+  CHI_END(PublishStats)
+
+  CHI_BEGIN(QosStats)
+  /** What each QoS class has been served on a container */
+  std::vector<QosClassStats> QosStats(const hipc::MemContext &mctx,
+                                      const DomainQuery &dom_query) {
+    FullPtr<QosStatsTask> task = AsyncQosStats(mctx, dom_query);
+    task->Wait();
+    std::vector<QosClassStats> stats(task->stats_.begin(),
+                                     task->stats_.end());
+    CHI_CLIENT->DelTask(mctx, task);
+    return stats;
+  }
+  CHI_TASK_METHODS(QosStats);
+  CHI_END(QosStats)
+
+  CHI_BEGIN(LaneStats)
+  /** How I/O tasks have been spread over the lanes of a container */
+  LaneStats GetLaneStats(const hipc::MemContext &mctx,
+                         const DomainQuery &dom_query) {
+    FullPtr<LaneStatsTask> task = AsyncLaneStats(mctx, dom_query);
+    task->Wait();
+    LaneStats stats = task->stats_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return stats;
+  }
+  CHI_TASK_METHODS(LaneStats);
+  CHI_END(LaneStats)
+
+  CHI_BEGIN(Inflight)
+  /** The bytes of I/O in flight on a container, overall and for @client */
+  InflightStats Inflight(const hipc::MemContext &mctx,
+                         const DomainQuery &dom_query, u64 client) {
+    FullPtr<InflightTask> task = AsyncInflight(mctx, dom_query, client);
+    task->Wait();
+    InflightStats stats = task->stats_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return stats;
+  }
+  CHI_TASK_METHODS(Inflight);
+  CHI_END(Inflight)
+
+  CHI_BEGIN(Staging)
+  /** Staging is long-running and only issued by the runtime */
+  CHI_TASK_METHODS(Staging);
+  CHI_END(Staging)
+
+  CHI_BEGIN(Flush)
+  /**
+   * Drain the data of @filename held above the PFS on every container down
+   * to it. Returns how far it was drained, which is all of it when @wait.
+   * */
+  StageProgress Flush(const hipc::MemContext &mctx, const chi::string &filename,
+                      bool wait = true) {
+    return Flush(mctx, chi::DomainQuery::GetGlobalBcast(), filename, wait);
+  }
+
+  /** Flush @filename on the containers of @dom_query only */
+  StageProgress Flush(const hipc::MemContext &mctx,
+                      const DomainQuery &dom_query,
+                      const chi::string &filename, bool wait) {
+    FullPtr<FlushTask> task = AsyncFlush(mctx, dom_query, filename, wait);
+    task->Wait();
+    StageProgress progress = task->progress_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return progress;
+  }
+  CHI_TASK_METHODS(Flush);
+  CHI_END(Flush)
+
+  CHI_BEGIN(Compact)
+  /**
+   * Copy the logs of a log-structured file into it, on the file's home
+   * container. With @wait, every container's log is synced first and the
+   * bytes copied are returned. Otherwise the compaction is only requested.
+   * */
+  u64 Compact(const hipc::MemContext &mctx, const chi::string &filename,
+              bool wait = true) {
+    if (wait) {
+      Flush(mctx, filename, true);
+    }
+    FullPtr<CompactTask> task = AsyncCompact(
+        mctx,
+        chi::DomainQuery::GetDirectHash(
+            chi::SubDomain::kGlobalContainers,
+            ExtentMap::Home(filename.str(), 0, num_containers_)),
+        filename, wait);
+    task->Wait();
+    u64 compacted = task->compacted_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return compacted;
+  }
+  CHI_TASK_METHODS(Compact);
+
+  /**
+   * A writer is done with a log-structured file: sync this node's log so
+   * every node sees its writes, and request a background compaction
+   * */
+  void CloseLog(const hipc::MemContext &mctx, const chi::string &filename) {
+    Flush(mctx, chi::DomainQuery::GetLocalHash(0), filename, true);
+    Compact(mctx, filename, false);
+  }
+  CHI_END(Compact)
+
+  /**
+   * The container that keeps @filename whole: in its packs if it is packed,
+   * or in its memory if it is kept in memory
+   * */
+  DomainQuery FileHome(const chi::string &filename) const {
+    return chi::DomainQuery::GetDirectHash(
+        chi::SubDomain::kGlobalContainers,
+        ExtentMap::Home(filename.str(), 0, num_containers_));
+  }
+
+  CHI_BEGIN(PackGet)
+  /**
+   * Look up packed @filename, copying up to @data_size bytes of it into
+   * @data. @info says whether it is packed. Returns the bytes copied, or -1.
+   * */
+  ssize_t PackGet(const hipc::MemContext &mctx, const chi::string &filename,
+                  const hipc::Pointer &data, size_t data_size,
+                  PackInfo &info) {
+    FullPtr<PackGetTask> task =
+        AsyncPackGet(mctx, FileHome(filename), filename, data, data_size);
+    task->Wait();
+    info = task->info_;
+    ssize_t ret = task->ret_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return ret;
+  }
+  CHI_TASK_METHODS(PackGet);
+  CHI_END(PackGet)
+
+  CHI_BEGIN(PackPut)
+  /** Pack @data_size bytes of @data as the whole of @filename */
+  ssize_t PackPut(const hipc::MemContext &mctx, const chi::string &filename,
+                  const hipc::Pointer &data, size_t data_size, u32 mode) {
+    FullPtr<PackPutTask> task = AsyncPackPut(mctx, FileHome(filename),
+                                             filename, data, data_size, mode);
+    task->Wait();
+    ssize_t ret = task->ret_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return ret;
+  }
+  CHI_TASK_METHODS(PackPut);
+  CHI_END(PackPut)
+
+  CHI_BEGIN(PackRemove)
+  /** Drop @filename from its pack. Returns false if it was not packed. */
+  bool PackRemove(const hipc::MemContext &mctx, const chi::string &filename) {
+    FullPtr<PackRemoveTask> task =
+        AsyncPackRemove(mctx, FileHome(filename), filename);
+    task->Wait();
+    bool removed = task->removed_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return removed;
+  }
+  CHI_TASK_METHODS(PackRemove);
+  CHI_END(PackRemove)
+
+  CHI_BEGIN(MemOpen)
+  /**
+   * Open @filename, a name from MemoryName, on its home container: create
+   * it in memory if @create and it exists nowhere, and empty it if
+   * @truncate. The info says whether it is in memory, or on the PFS.
+   * */
+  MemoryInfo MemOpen(const hipc::MemContext &mctx,
+                     const chi::string &filename, bool create = false,
+                     bool truncate = false, u32 mode = 0664) {
+    FullPtr<MemOpenTask> task = AsyncMemOpen(mctx, FileHome(filename),
+                                             filename, create, truncate, mode);
+    task->Wait();
+    MemoryInfo info = task->info_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return info;
+  }
+  CHI_TASK_METHODS(MemOpen);
+  CHI_END(MemOpen)
+
+  CHI_BEGIN(Discard)
+  /** Drop deleted @filename from memory. Returns false if it was not held. */
+  bool Discard(const hipc::MemContext &mctx, const chi::string &filename) {
+    FullPtr<DiscardTask> task =
+        AsyncDiscard(mctx, FileHome(filename), filename);
+    task->Wait();
+    bool discarded = task->discarded_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return discarded;
+  }
+  CHI_TASK_METHODS(Discard);
+  CHI_END(Discard)
+
+  CHI_BEGIN(Copy)
+  /** A copy of the rest of the source */
+  CLS_CONST size_t kCopyAll = SIZE_MAX;
+  /** Copies of files without splits are spread over containers in these */
+  CLS_CONST size_t kCopySplit = MEGABYTES(256);
+
+  /** A range of a source file copied into the destination */
+  struct CopySpan {
+    chi::string src_;
+    size_t src_offset_;
+    size_t dst_offset_;
+    size_t size_;
+  };
+
+  /**
+   * Copy @size bytes at @src_offset of @src to @dst at @dst_offset inside
+   * the runtime, so no byte passes through the client. kCopyAll copies
+   * through the end of @src. Returns the bytes copied, or -1 with errno
+   * ENOTSUP if @src or @dst is packed.
+   * */
+  ssize_t Copy(const hipc::MemContext &mctx, const chi::string &src,
+               size_t src_offset, const chi::string &dst, size_t dst_offset,
+               size_t size = kCopyAll) {
+    if (!SettleSources(mctx, {src}) || !CheckDest(mctx, dst)) {
+      return -1;
+    }
+    if (size == kCopyAll) {
+      size_t src_size = SourceSize(mctx, src);
+      size = src_size > src_offset ? src_size - src_offset : 0;
+    }
+    return CopySpans(mctx, {CopySpan{src, src_offset, dst_offset, size}},
+                     dst);
+  }
+
+  /**
+   * Write @srcs back to back into @dst from its start, inside the runtime.
+   * @dst is emptied first, so it ends with the sources. Returns the bytes
+   * copied, or -1: with errno EINVAL if @dst is one of @srcs, or ENOTSUP if
+   * a source is packed.
+   * */
+  ssize_t Concat(const hipc::MemContext &mctx,
+                 const std::vector<chi::string> &srcs,
+                 const chi::string &dst) {
+    std::string dst_path = PlainPath(dst.str());
+    for (const chi::string &src : srcs) {
+      if (PlainPath(src.str()) == dst_path) {
+        errno = EINVAL;
+        return -1;
+      }
+    }
+    if (!SettleSources(mctx, srcs)) {
+      return -1;
+    }
+    std::vector<size_t> sizes = SourceSizes(mctx, srcs);
+    if (!EmptyDest(mctx, dst)) {
+      return -1;
+    }
+    std::vector<CopySpan> spans;
+    size_t offset = 0;
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      spans.push_back(CopySpan{srcs[i], 0, offset, sizes[i]});
+      offset += sizes[i];
+    }
+    return CopySpans(mctx, spans, dst);
+  }
+
+  /**
+   * Merge per-process files into one shared file: the whole of each of
+   * @srcs is written into @dst at the matching entry of @offsets, inside
+   * the runtime. Returns the bytes copied, or -1: with errno EINVAL if
+   * @offsets does not match @srcs, or ENOTSUP if a file is packed.
+   * */
+  ssize_t Merge(const hipc::MemContext &mctx,
+                const std::vector<chi::string> &srcs,
+                const std::vector<size_t> &offsets, const chi::string &dst) {
+    if (offsets.size() != srcs.size()) {
+      errno = EINVAL;
+      return -1;
+    }
+    if (!SettleSources(mctx, srcs) || !CheckDest(mctx, dst)) {
+      return -1;
+    }
+    std::vector<size_t> sizes = SourceSizes(mctx, srcs);
+    std::vector<CopySpan> spans;
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      spans.push_back(CopySpan{srcs[i], 0, offsets[i], sizes[i]});
+    }
+    return CopySpans(mctx, spans, dst);
+  }
+  CHI_TASK_METHODS(Copy);
+
+  /** @path without its dtio:// prefix */
+  static std::string PlainPath(const std::string &path) {
+    return path.compare(0, 7, "dtio://") == 0 ? path.substr(7) : path;
+  }
+
+  /**
+   * Whether @filename is held whole in a pack, where copies do not see it.
+   * Packs are keyed by the plain path.
+   * */
+  bool IsPacked(const hipc::MemContext &mctx, const chi::string &filename) {
+    PackInfo info;
+    PackGet(mctx, chi::string(PlainPath(filename.str())),
+            hipc::Pointer::GetNull(), 0, info);
+    return info.found_;
+  }
+
+  /**
+   * Put data of @srcs held where only some containers see it onto the PFS,
+   * so any container can copy it. Returns false with errno ENOTSUP if a
+   * source is packed, as copies read the PFS.
+   * */
+  bool SettleSources(const hipc::MemContext &mctx,
+                     const std::vector<chi::string> &srcs) {
+    for (const chi::string &src : srcs) {
+      if (IsMemoryName(src.str())) {
+        continue;
+      }
+      if (IsPacked(mctx, src)) {
+        errno = ENOTSUP;
+        return false;
+      }
+      if (logged_) {
+        Compact(mctx, src, true);
+      } else if (split_size_ && !chunked_) {
+        Flush(mctx, src, true);
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Whether copies into @dst are seen. A packed file is read from its pack,
+   * so it is refused with errno ENOTSUP.
+   * */
+  bool CheckDest(const hipc::MemContext &mctx, const chi::string &dst) {
+    if (!IsMemoryName(dst.str()) && IsPacked(mctx, dst)) {
+      errno = ENOTSUP;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Empty @dst wherever it is held: in memory, in its pack, or on the PFS
+   * along with what the containers keep of it. Returns false if it could
+   * not be cut.
+   * */
+  bool EmptyDest(const hipc::MemContext &mctx, const chi::string &dst) {
+    std::string path = dst.str();
+    if (IsMemoryName(path) && MemOpen(mctx, dst, false, true).in_memory_) {
+      return true;
+    }
+    path = PlainPath(path);
+    PackRemove(mctx, chi::string(path));
+    if (truncate64(path.c_str(), 0) != 0 && errno != ENOENT) {
+      return false;
+    }
+    Truncate(mctx, dst, 0);
+    return true;
+  }
+
+  /** The size of @src, from its home container */
+  size_t SourceSize(const hipc::MemContext &mctx, const chi::string &src) {
+    return SourceSizes(mctx, {src})[0];
+  }
+
+  /** The sizes of settled @srcs, asked for all at once */
+  std::vector<size_t> SourceSizes(const hipc::MemContext &mctx,
+                                  const std::vector<chi::string> &srcs) {
+    std::vector<FullPtr<CopyTask>> tasks;
+    for (const chi::string &src : srcs) {
+      tasks.emplace_back(
+          AsyncCopy(mctx, FileHome(src), src, 0, chi::string(), 0, 0));
+    }
+    std::vector<size_t> sizes;
+    for (FullPtr<CopyTask> &task : tasks) {
+      task->Wait();
+      sizes.push_back(task->src_size_);
+      CHI_CLIENT->DelTask(mctx, task);
+    }
+    return sizes;
+  }
+
+  /**
+   * Copy @spans into @dst in pieces, each on the container that would
+   * service a write of it, all at once. A source kept in memory can only be
+   * read on its home, so its pieces are copied there. Returns the bytes
+   * copied, or -1 if any piece failed.
+   * */
+  ssize_t CopySpans(const hipc::MemContext &mctx,
+                    const std::vector<CopySpan> &spans,
+                    const chi::string &dst) {
+    size_t split = split_size_ ? split_size_ : kCopySplit;
+    std::vector<CopySpan> pieces;
+    std::vector<size_t> sizes, offsets;
+    for (const CopySpan &span : spans) {
+      for (size_t done = 0; done < span.size_;) {
+        size_t pos = span.dst_offset_ + done;
+        size_t len = std::min(span.size_ - done, split - pos % split);
+        pieces.push_back(
+            CopySpan{span.src_, span.src_offset_ + done, pos, len});
+        sizes.push_back(len);
+        offsets.push_back(pos);
+        done += len;
+      }
+    }
+    if (pieces.empty()) {
+      return 0;
+    }
+    std::vector<DomainQuery> doms =
+        ScheduleIo(mctx, sizes, dst, offsets, dtio::Operation::kWrite);
+    std::vector<FullPtr<CopyTask>> tasks;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+      const CopySpan &piece = pieces[i];
+      DomainQuery dom =
+          IsMemoryName(piece.src_.str()) ? FileHome(piece.src_) : doms[i];
+      tasks.emplace_back(AsyncCopy(mctx, dom, piece.src_, piece.src_offset_,
+                                   dst, piece.dst_offset_, piece.size_));
+    }
+    ssize_t ret = 0;
+    for (FullPtr<CopyTask> &task : tasks) {
+      task->Wait();
+      ret = (ret < 0 || task->ret_ < 0) ? -1 : ret + task->ret_;
+      CHI_CLIENT->DelTask(mctx, task);
+    }
+    return ret;
+  }
+  CHI_END(Copy)
+
+  CHI_BEGIN(TierStats)
+  /**
+   * How full the tiers above the PFS are and how memory is being freed, on
+   * one container or summed over several
+   * */
+  TierStats GetTierStats(const hipc::MemContext &mctx,
+                         const DomainQuery &dom_query) {
+    FullPtr<TierStatsTask> task = AsyncTierStats(mctx, dom_query);
+    task->Wait();
+    TierStats stats = task->stats_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return stats;
+  }
+  CHI_TASK_METHODS(TierStats);
+  CHI_END(TierStats)
+
+  CHI_BEGIN(RecordExtents)
+  /**
+   * Tell container 0 that @owner wrote @sizes bytes of @filename at
+   * @offsets. Does not wait for completion.
+   * */
+  void RecordExtents(const hipc::MemContext &mctx, const chi::string &filename,
+                     const std::vector<size_t> &offsets,
+                     const std::vector<size_t> &sizes, u32 owner) {
+    AsyncRecordExtents(mctx,
+                       chi::DomainQuery::GetDirectHash(
+                           chi::SubDomain::kGlobalContainers, 0),
+                       filename, offsets, sizes, owner);
+  }
+  CHI_TASK_METHODS(RecordExtents);
+  CHI_END(RecordExtents)
+
+  CHI_BEGIN(Truncate)
+  /**
+   * Drop what every container keeps of @filename past @size bytes, once the
+   * file was truncated to it. With @unlink, drop all of it before the file
+   * is removed.
+   * */
+  void Truncate(const hipc::MemContext &mctx, const chi::string &filename,
+                size_t size, bool unlink = false) {
+    FullPtr<TruncateTask> task =
+        AsyncTruncate(mctx, chi::DomainQuery::GetGlobalBcast(), filename, size,
+                      unlink);
+    task->Wait();
+    CHI_CLIENT->DelTask(mctx, task);
+  }
+  CHI_TASK_METHODS(Truncate);
+  CHI_END(Truncate)
+
   CHI_AUTOGEN_METHODS  // keep at class bottom
 };
 
@@ -0,0 +1,227 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_COST_H_
+#define CHI_dtiomod_COST_H_
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtio/dtio_enumerations.h"
+
+namespace chi::dtiomod {
+
+/** What the cost model knows of an I/O task when it starts */
+struct IoFeatures {
+  size_t size_ = 0;
+  bool is_read_ = false;
+  dtio::IoClientType iface_ = dtio::IoClientType::kPosix;
+  u64 depth_ = 0;          /**< I/O tasks queued or running on the container */
+  bool sequential_ = true; /**< Starts where the last I/O on its file ended */
+};
+
+/** The cost of I/O on a container, as fit by its CostModel */
+struct CostSummary {
+  double fixed_ns_ = 0;    /**< Latency of an empty sequential I/O */
+  double ns_per_byte_ = 0; /**< Added per byte; 0 until the model is warm */
+  double seek_ns_ = 0;     /**< Added when an I/O is not sequential */
+};
+
+/**
+ * Learns how long I/O takes on the storage under a container. Each I/O
+ * handler starts a sample when it begins servicing a task. Its kSampleLoad
+ * monitor hook finishes it. Latency is fit online, by recursive least
+ * squares with exponential forgetting, as
+ *
+ *   latency = w0 + w1 * megabytes + w2 * depth + w3 * (not sequential)
+ *
+ * with one fit per op and backend, so reads and writes through different
+ * interfaces do not blur together. Forgetting lets the fit follow changes
+ * in the device, such as a cache filling up.
+ * */
+class CostModel {
+ public:
+  /** Weight of past samples relative to the newest */
+  CLS_CONST double kForget = 0.999;
+  /** A fit predicts nothing until it has seen this many samples */
+  CLS_CONST u64 kWarmup = 16;
+  /** Files whose last offset is remembered for sequential detection */
+  CLS_CONST size_t kMaxFiles = 4096;
+  CLS_CONST size_t kDims = 4;
+  CLS_CONST size_t kBackends =
+      static_cast<size_t>(dtio::IoClientType::kMulti) + 1;
+
+ public:
+  /**
+   * Whether an I/O of @size at @offset continues the last one on @file,
+   * which it then becomes.
+   * */
+  bool Sequential(u64 file, size_t offset, size_t size) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (file_end_.size() >= kMaxFiles) {
+      file_end_.clear();
+    }
+    auto it = file_end_.find(file);
+    bool sequential = it == file_end_.end() || it->second == offset;
+    file_end_[file] = offset + size;
+    return sequential;
+  }
+
+  /** @task began servicing at @now_ns */
+  void Start(const Task *task, const IoFeatures &features, u64 now_ns) {
+    std::lock_guard<std::mutex> guard(lock_);
+    samples_[task] = Sample{features, now_ns};
+  }
+
+  /**
+   * @task finished at @now_ns. Samples are only taken once, so a task
+   * finished twice is ignored.
+   * */
+  void Finish(const Task *task, u64 now_ns) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = samples_.find(task);
+    if (it == samples_.end()) {
+      return;
+    }
+    const Sample &sample = it->second;
+    double latency_us = (now_ns - sample.start_ns_) / 1e3;
+    Observe(sample.features_, latency_us);
+    samples_.erase(it);
+  }
+
+  /**
+   * The cost of I/O at queue depth @depth, averaged over the warm fits by
+   * how many samples each has seen.
+   * */
+  CostSummary Summarize(u64 depth) {
+    std::lock_guard<std::mutex> guard(lock_);
+    CostSummary summary;
+    double total = 0;
+    for (const Fit &fit : fits_) {
+      if (fit.samples_ < kWarmup) {
+        continue;
+      }
+      double weight = fit.samples_;
+      summary.fixed_ns_ += weight * (fit.w_[0] + fit.w_[2] * depth);
+      summary.ns_per_byte_ += weight * fit.w_[1];
+      summary.seek_ns_ += weight * fit.w_[3];
+      total += weight;
+    }
+    if (total == 0) {
+      return CostSummary();
+    }
+    // Fit in microseconds and megabytes, reported in ns and bytes
+    summary.fixed_ns_ = std::max(summary.fixed_ns_ / total, 0.0) * 1e3;
+    summary.ns_per_byte_ =
+        std::max(summary.ns_per_byte_ / total, 0.0) * 1e3 / MEGABYTES(1);
+    summary.seek_ns_ = std::max(summary.seek_ns_ / total, 0.0) * 1e3;
+    return summary;
+  }
+
+  /**
+   * How many tasks per file the elevator should hold, up to @max_window.
+   * Sorting by offset only pays off in proportion to how much of a random
+   * I/O's latency is the seek, so on storage where order does not matter
+   * the window shrinks to 1 and tasks are not held back.
+   * */
+  u32 ElevatorWindow(u32 max_window, u64 depth) {
+    if (max_window <= 1) {
+      return max_window;
+    }
+    CostSummary cost = Summarize(depth);
+    if (cost.ns_per_byte_ == 0) {
+      return max_window;
+    }
+    double random_ns =
+        cost.fixed_ns_ + cost.seek_ns_ + cost.ns_per_byte_ * mean_size_;
+    double share = random_ns > 0 ? cost.seek_ns_ / random_ns : 0;
+    return std::clamp<u32>(std::ceil(share * max_window), 1, max_window);
+  }
+
+ private:
+  /** One least squares fit: weights and inverse correlation matrix */
+  struct Fit {
+    double w_[kDims] = {0};
+    double p_[kDims][kDims] = {{0}};
+    u64 samples_ = 0;
+
+    Fit() {
+      for (size_t i = 0; i < kDims; ++i) {
+        p_[i][i] = 1e4;
+      }
+    }
+  };
+
+  /** An I/O task being timed */
+  struct Sample {
+    IoFeatures features_;
+    u64 start_ns_;
+  };
+
+  Fit &GetFit(const IoFeatures &features) {
+    size_t backend = std::min<size_t>(static_cast<size_t>(features.iface_),
+                                      kBackends - 1);
+    return fits_[backend * 2 + features.is_read_];
+  }
+
+  static void Vectorize(const IoFeatures &features, double *x) {
+    x[0] = 1;
+    x[1] = static_cast<double>(features.size_) / MEGABYTES(1);
+    x[2] = static_cast<double>(features.depth_);
+    x[3] = features.sequential_ ? 0 : 1;
+  }
+
+  static double Dot(const double *a, const double *b) {
+    double sum = 0;
+    for (size_t i = 0; i < kDims; ++i) {
+      sum += a[i] * b[i];
+    }
+    return sum;
+  }
+
+  /** One step of recursive least squares. Requires lock_ */
+  void Observe(const IoFeatures &features, double latency_us) {
+    Fit &fit = GetFit(features);
+    double x[kDims], px[kDims];
+    Vectorize(features, x);
+    for (size_t i = 0; i < kDims; ++i) {
+      px[i] = Dot(fit.p_[i], x);
+    }
+    double gain_den = kForget + Dot(x, px);
+    double err = latency_us - Dot(fit.w_, x);
+    for (size_t i = 0; i < kDims; ++i) {
+      fit.w_[i] += px[i] / gain_den * err;
+    }
+    for (size_t i = 0; i < kDims; ++i) {
+      for (size_t j = 0; j < kDims; ++j) {
+        fit.p_[i][j] = (fit.p_[i][j] - px[i] * px[j] / gain_den) / kForget;
+      }
+    }
+    fit.samples_ += 1;
+    mean_size_ = mean_size_ ? 0.99 * mean_size_ + 0.01 * features.size_
+                            : features.size_;
+  }
+
+  std::mutex lock_;
+  Fit fits_[kBackends * 2];
+  std::unordered_map<const Task *, Sample> samples_;
+  std::unordered_map<u64, size_t> file_end_;
+  double mean_size_ = 0; /**< Moving average of I/O size */
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_COST_H_
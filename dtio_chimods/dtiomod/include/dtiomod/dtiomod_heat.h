@@ -0,0 +1,534 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef CHI_dtiomod_HEAT_H_
+#define CHI_dtiomod_HEAT_H_
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtio/dtio_enumerations.h"
+#include "dtiomod_tiers.h"
+
+namespace chi::dtiomod {
+
+/**
+ * Decayed access counts of file blocks, in a fixed-size open-addressed
+ * table. Each access adds 1 to a block's heat, which halves every
+ * half-life. A key probes at most kProbe slots. When they are all taken,
+ * the coldest of them is replaced, so the table forgets cold blocks first.
+ * */
+class HeatTable {
+ public:
+  CLS_CONST size_t kProbe = 16;
+
+ public:
+  /** Size the table to at least @slots entries */
+  void Configure(size_t slots, double half_life_ms) {
+    size_t cap = 1;
+    while (cap < slots) {
+      cap <<= 1;
+    }
+    slots_.assign(cap, Slot());
+    half_life_ns_ = std::max(half_life_ms, 1.0) * 1e6;
+  }
+
+  /** Record an access to @key at @now_ns. Returns its heat after it. */
+  double Touch(u64 key, u64 now_ns) {
+    Slot *slot = Probe(key, now_ns);
+    if (slot->key_ != key) {
+      *slot = Slot{key, 0, now_ns};
+    }
+    slot->heat_ = Decay(*slot, now_ns) + 1;
+    slot->stamp_ns_ = now_ns;
+    return slot->heat_;
+  }
+
+  /** The heat of @key at @now_ns, or 0 if it is not tracked */
+  double Heat(u64 key, u64 now_ns) const {
+    size_t mask = slots_.size() - 1;
+    size_t idx = Mix(key) & mask;
+    for (size_t i = 0; i < std::min(kProbe, slots_.size()); ++i) {
+      const Slot &slot = slots_[(idx + i) & mask];
+      if (slot.key_ == key) {
+        return Decay(slot, now_ns);
+      }
+      if (!slot.key_) {
+        break;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  struct Slot {
+    u64 key_ = 0; /**< 0 is an empty slot */
+    float heat_ = 0;
+    u64 stamp_ns_ = 0; /**< When heat_ was last updated */
+  };
+
+  /** @key's slot, a free one, or the coldest one to replace */
+  Slot *Probe(u64 key, u64 now_ns) {
+    size_t mask = slots_.size() - 1;
+    size_t idx = Mix(key) & mask;
+    Slot *victim = nullptr;
+    double coldest = 0;
+    for (size_t i = 0; i < std::min(kProbe, slots_.size()); ++i) {
+      Slot &slot = slots_[(idx + i) & mask];
+      if (slot.key_ == key || !slot.key_) {
+        return &slot;
+      }
+      double heat = Decay(slot, now_ns);
+      if (!victim || heat < coldest) {
+        victim = &slot;
+        coldest = heat;
+      }
+    }
+    return victim;
+  }
+
+  double Decay(const Slot &slot, u64 now_ns) const {
+    if (now_ns <= slot.stamp_ns_) {
+      return slot.heat_;
+    }
+    double age_ns = now_ns - slot.stamp_ns_;
+    return slot.heat_ * std::exp2(-age_ns / half_life_ns_);
+  }
+
+  static u64 Mix(u64 key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+  std::vector<Slot> slots_ = std::vector<Slot>(1);
+  double half_life_ns_ = 1e9;
+};
+
+/** Keys in recency order, most recent first */
+class RecencyList {
+ public:
+  bool Contains(u64 key) const { return pos_.count(key) > 0; }
+
+  void PushFront(u64 key) {
+    list_.push_front(key);
+    pos_[key] = list_.begin();
+  }
+
+  void Erase(u64 key) {
+    auto it = pos_.find(key);
+    if (it != pos_.end()) {
+      list_.erase(it->second);
+      pos_.erase(it);
+    }
+  }
+
+  /** Remove and return the least recent key. Requires a key. */
+  u64 PopBack() {
+    u64 key = list_.back();
+    list_.pop_back();
+    pos_.erase(key);
+    return key;
+  }
+
+  size_t Size() const { return list_.size(); }
+
+ private:
+  std::list<u64> list_;
+  std::unordered_map<u64, std::list<u64>::iterator> pos_;
+};
+
+/**
+ * Decides which blocks are kept on the fast tiers. A policy holds up to a
+ * capacity of resident blocks. The mover copies resident blocks up from
+ * the PFS and drops the copies of the blocks a policy evicts.
+ * */
+class TierPolicy {
+ public:
+  /** Heat a block needs before LRU or LFU makes it resident */
+  CLS_CONST double kMinHeat = 2;
+
+ public:
+  virtual ~TierPolicy() = default;
+
+  /**
+   * Record an access to @key, whose heat is now @heat. Returns whether
+   * @key is resident after it. Blocks it displaces are added to @evicted.
+   * */
+  virtual bool Access(u64 key, double heat, u64 now_ns,
+                      std::vector<u64> &evicted) = 0;
+
+  /** Allow @capacity resident blocks, adding the excess to @evicted */
+  virtual void Resize(size_t capacity, u64 now_ns,
+                      std::vector<u64> &evicted) = 0;
+
+  /** Number of resident blocks */
+  virtual size_t Size() const = 0;
+
+  /** The policy of @type, or null for kNone */
+  static std::unique_ptr<TierPolicy> Create(dtio::TierPolicyType type,
+                                            const HeatTable &heat);
+};
+
+/** Keeps the most recently read of the blocks read more than once */
+class LruPolicy : public TierPolicy {
+ public:
+  bool Access(u64 key, double heat, u64 now_ns,
+              std::vector<u64> &evicted) override {
+    if (lru_.Contains(key)) {
+      lru_.Erase(key);
+      lru_.PushFront(key);
+      return true;
+    }
+    if (heat < kMinHeat || !capacity_) {
+      return false;
+    }
+    lru_.PushFront(key);
+    Trim(evicted);
+    return true;
+  }
+
+  void Resize(size_t capacity, u64 now_ns,
+              std::vector<u64> &evicted) override {
+    capacity_ = capacity;
+    Trim(evicted);
+  }
+
+  size_t Size() const override { return lru_.Size(); }
+
+ private:
+  void Trim(std::vector<u64> &evicted) {
+    while (lru_.Size() > capacity_) {
+      evicted.emplace_back(lru_.PopBack());
+    }
+  }
+
+  RecencyList lru_;
+  size_t capacity_ = 0;
+};
+
+/**
+ * Keeps the hottest blocks by decayed access count. A block replaces the
+ * coldest resident one only if it is hotter.
+ * */
+class LfuPolicy : public TierPolicy {
+ public:
+  explicit LfuPolicy(const HeatTable &heat) : heat_(heat) {}
+
+  bool Access(u64 key, double heat, u64 now_ns,
+              std::vector<u64> &evicted) override {
+    if (keys_.count(key)) {
+      return true;
+    }
+    if (heat < kMinHeat || !capacity_) {
+      return false;
+    }
+    if (keys_.size() >= capacity_) {
+      u64 victim = 0;
+      double coldest = 0;
+      for (u64 resident : keys_) {
+        double resident_heat = heat_.Heat(resident, now_ns);
+        if (!victim || resident_heat < coldest) {
+          victim = resident;
+          coldest = resident_heat;
+        }
+      }
+      if (coldest >= heat) {
+        return false;
+      }
+      keys_.erase(victim);
+      evicted.emplace_back(victim);
+    }
+    keys_.emplace(key);
+    return true;
+  }
+
+  void Resize(size_t capacity, u64 now_ns,
+              std::vector<u64> &evicted) override {
+    capacity_ = capacity;
+    if (keys_.size() <= capacity_) {
+      return;
+    }
+    std::vector<std::pair<double, u64>> by_heat;
+    for (u64 key : keys_) {
+      by_heat.emplace_back(heat_.Heat(key, now_ns), key);
+    }
+    size_t excess = keys_.size() - capacity_;
+    std::nth_element(by_heat.begin(), by_heat.begin() + excess,
+                     by_heat.end());
+    for (size_t i = 0; i < excess; ++i) {
+      keys_.erase(by_heat[i].second);
+      evicted.emplace_back(by_heat[i].second);
+    }
+  }
+
+  size_t Size() const override { return keys_.size(); }
+
+ private:
+  const HeatTable &heat_;
+  std::unordered_set<u64> keys_;
+  size_t capacity_ = 0;
+};
+
+/**
+ * Adaptive Replacement Cache (Megiddo and Modha). T1 holds blocks read once
+ * recently and T2 blocks read again. B1 and B2 remember what each evicted,
+ * and a hit in either shifts the target size p_ of T1 toward the list that
+ * would have kept it. A single scan passes through T1 without flushing T2,
+ * so ARC admits on the first read and needs no heat threshold.
+ * */
+class ArcPolicy : public TierPolicy {
+ public:
+  bool Access(u64 key, double heat, u64 now_ns,
+              std::vector<u64> &evicted) override {
+    if (!capacity_) {
+      return false;
+    }
+    if (t1_.Contains(key) || t2_.Contains(key)) {
+      t1_.Erase(key);
+      t2_.Erase(key);
+      t2_.PushFront(key);
+      return true;
+    }
+    if (b1_.Contains(key)) {
+      double delta = std::max<double>(1.0 * b2_.Size() / b1_.Size(), 1);
+      p_ = std::min<double>(capacity_, p_ + delta);
+      b1_.Erase(key);
+      Replace(false, evicted);
+      t2_.PushFront(key);
+      return true;
+    }
+    if (b2_.Contains(key)) {
+      double delta = std::max<double>(1.0 * b1_.Size() / b2_.Size(), 1);
+      p_ = std::max<double>(0, p_ - delta);
+      b2_.Erase(key);
+      Replace(true, evicted);
+      t2_.PushFront(key);
+      return true;
+    }
+    // A miss
+    size_t total = t1_.Size() + t2_.Size() + b1_.Size() + b2_.Size();
+    if (t1_.Size() + b1_.Size() >= capacity_) {
+      if (t1_.Size() < capacity_) {
+        b1_.PopBack();
+        Replace(false, evicted);
+      } else {
+        evicted.emplace_back(t1_.PopBack());
+      }
+    } else if (total >= capacity_) {
+      if (total >= 2 * capacity_) {
+        b2_.PopBack();
+      }
+      Replace(false, evicted);
+    }
+    t1_.PushFront(key);
+    return true;
+  }
+
+  void Resize(size_t capacity, u64 now_ns,
+              std::vector<u64> &evicted) override {
+    capacity_ = capacity;
+    p_ = std::min<double>(p_, capacity_);
+    while (t1_.Size() + t2_.Size() > capacity_) {
+      Evict(false, evicted);
+    }
+    while (t1_.Size() + b1_.Size() > capacity_ && b1_.Size()) {
+      b1_.PopBack();
+    }
+    while (t1_.Size() + t2_.Size() + b1_.Size() + b2_.Size() >
+               2 * capacity_ &&
+           b2_.Size()) {
+      b2_.PopBack();
+    }
+  }
+
+  size_t Size() const override { return t1_.Size() + t2_.Size(); }
+
+ private:
+  /** Make room for one block if the resident lists are full */
+  void Replace(bool in_b2, std::vector<u64> &evicted) {
+    if (t1_.Size() + t2_.Size() >= capacity_) {
+      Evict(in_b2, evicted);
+    }
+  }
+
+  /** Move the least recent block of T1 or T2 to its ghost list */
+  void Evict(bool in_b2, std::vector<u64> &evicted) {
+    size_t t1 = t1_.Size();
+    if (t1 && (t1 > p_ || (in_b2 && t1 == static_cast<size_t>(p_)) ||
+               !t2_.Size())) {
+      u64 key = t1_.PopBack();
+      b1_.PushFront(key);
+      evicted.emplace_back(key);
+    } else if (t2_.Size()) {
+      u64 key = t2_.PopBack();
+      b2_.PushFront(key);
+      evicted.emplace_back(key);
+    }
+  }
+
+  RecencyList t1_, t2_, b1_, b2_;
+  size_t capacity_ = 0;
+  double p_ = 0; /**< Target size of T1 */
+};
+
+inline std::unique_ptr<TierPolicy> TierPolicy::Create(
+    dtio::TierPolicyType type, const HeatTable &heat) {
+  switch (type) {
+    case dtio::TierPolicyType::kLru:
+      return std::make_unique<LruPolicy>();
+    case dtio::TierPolicyType::kArc:
+      return std::make_unique<ArcPolicy>();
+    case dtio::TierPolicyType::kLfu:
+      return std::make_unique<LfuPolicy>(heat);
+    case dtio::TierPolicyType::kNone:
+    default:
+      return nullptr;
+  }
+}
+
+/**
+ * Moves file blocks between the PFS and the fast tiers by heat. Reads are
+ * recorded per block of block_size_ bytes, and the policy picks the
+ * resident blocks. Run copies resident blocks up from the PFS as clean
+ * extents and drops the clean copies of evicted ones, whose data is still
+ * on the PFS. Clean copies get only the room below the tiers' high water
+ * mark that held writes don't use, so the policy shrinks as writes fill
+ * the tiers.
+ * */
+class TierMover {
+ public:
+  /** Half-life of a block's heat */
+  CLS_CONST double kHalfLifeMs = 30000;
+  /** Blocks whose heat is tracked */
+  CLS_CONST size_t kHeatSlots = 1 << 16;
+  /** Most resident blocks waiting to be copied up */
+  CLS_CONST size_t kMaxPending = 1024;
+
+ public:
+  void Configure(dtio::TierPolicyType type, size_t block_size) {
+    block_size_ = std::max<size_t>(block_size, 1);
+    heat_.Configure(kHeatSlots, kHalfLifeMs);
+    policy_ = TierPolicy::Create(type, heat_);
+  }
+
+  bool Enabled() const { return policy_ != nullptr; }
+
+  /** Record a read of [@offset, @offset + @size) of @path */
+  void Record(const std::string &path, size_t offset, size_t size,
+              u64 now_ns) {
+    if (!policy_ || !size) {
+      return;
+    }
+    u64 file = std::hash<std::string>{}(path);
+    std::vector<u64> evicted;
+    std::lock_guard<std::mutex> guard(lock_);
+    size_t last = (offset + size - 1) / block_size_;
+    for (size_t block = offset / block_size_; block <= last; ++block) {
+      u64 key = BlockKey(file, block);
+      double heat = heat_.Touch(key, now_ns);
+      if (policy_->Access(key, heat, now_ns, evicted)) {
+        blocks_.emplace(key, Block{path, block});
+        if (pending_.size() < kMaxPending) {
+          pending_.emplace(key);
+        }
+      }
+    }
+    Evict(evicted);
+  }
+
+  /**
+   * Size the policy to the room on @tiers, drop the copies of evicted
+   * blocks, and copy up to about @budget bytes of resident blocks up from
+   * the PFS. Returns the bytes copied.
+   * */
+  size_t Run(TierManager &tiers, size_t budget, u64 now_ns) {
+    if (!policy_) {
+      return 0;
+    }
+    std::vector<Block> demote, promote;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      size_t room = TierManager::kHighWater * tiers.Capacity();
+      size_t held = tiers.Held();
+      std::vector<u64> evicted;
+      policy_->Resize(room > held ? (room - held) / block_size_ : 0, now_ns,
+                      evicted);
+      Evict(evicted);
+      demote.swap(demote_);
+      for (auto it = pending_.begin();
+           it != pending_.end() && promote.size() * block_size_ < budget;) {
+        auto block = blocks_.find(*it);
+        if (block != blocks_.end()) {
+          promote.emplace_back(block->second);
+        }
+        it = pending_.erase(it);
+      }
+    }
+    for (Block &block : demote) {
+      tiers.Demote(block.path_, block.index_ * block_size_, block_size_);
+    }
+    size_t moved = 0;
+    for (Block &block : promote) {
+      moved +=
+          tiers.Promote(block.path_, block.index_ * block_size_, block_size_);
+    }
+    return moved;
+  }
+
+ private:
+  struct Block {
+    std::string path_;
+    size_t index_;
+  };
+
+  static u64 BlockKey(u64 file, size_t block) {
+    u64 key = file ^ (block * 0x9e3779b97f4a7c15ULL);
+    return key ? key : 1;
+  }
+
+  /** Queue the copies of @evicted blocks to be dropped. Requires lock_. */
+  void Evict(const std::vector<u64> &evicted) {
+    for (u64 key : evicted) {
+      auto it = blocks_.find(key);
+      if (it != blocks_.end()) {
+        demote_.emplace_back(std::move(it->second));
+        blocks_.erase(it);
+      }
+      pending_.erase(key);
+    }
+  }
+
+  std::mutex lock_;
+  size_t block_size_ = MEGABYTES(1);
+  HeatTable heat_;
+  std::unique_ptr<TierPolicy> policy_;
+  /** The resident blocks */
+  std::unordered_map<u64, Block> blocks_;
+  /** Resident blocks to copy up, if not already held */
+  std::unordered_set<u64> pending_;
+  /** Evicted blocks whose copies are to be dropped */
+  std::vector<Block> demote_;
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_HEAT_H_
@@ -0,0 +1,228 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_LANES_H_
+#define CHI_dtiomod_LANES_H_
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+
+namespace chi::dtiomod {
+
+/** How I/O tasks have been spread over the lanes of one container */
+struct LaneStats {
+  u32 lanes_ = 0;
+  u32 active_lanes_ = 0; /**< Lanes new files are placed on */
+  u64 grows_ = 0;        /**< Times the active lanes grew */
+  u64 shrinks_ = 0;      /**< Times the active lanes shrank */
+  u64 tasks_ = 0;        /**< I/O tasks mapped to a lane */
+  u64 group_steals_ = 0; /**< Files moved off their home lane */
+  u64 read_steals_ = 0;  /**< Reads run away from their file's lane */
+  u64 max_depth_ = 0;    /**< Deepest any lane has been */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(lanes_, active_lanes_, grows_, shrinks_, tasks_, group_steals_,
+       read_steals_, max_depth_);
+  }
+};
+
+/**
+ * Maps I/O tasks to lanes. The tasks of a file form a group that sticks to
+ * one lane while any of them is queued, so they run in order. A file starts
+ * on its home lane, the hash of its name. An idle lane steals work from a
+ * busy one in two ways. A file whose group has drained moves to the idle
+ * lane as a whole. A read of a file with no writes queued depends on
+ * nothing else queued, so it runs on the idle lane right away.
+ *
+ * Only the first few lanes are active. Files are homed on and stolen to
+ * active lanes only, so the lanes past them drain and go idle. Files still
+ * queued on a lane when it is deactivated stay there until they drain.
+ * */
+class LaneBalancer {
+ public:
+  /** A lane with this many tasks queued is busy */
+  CLS_CONST u32 kBusyDepth = 2;
+
+ public:
+  void Resize(u32 num_lanes) {
+    std::lock_guard<std::mutex> guard(lock_);
+    depth_.assign(std::max<u32>(num_lanes, 1), 0);
+    stats_.lanes_ = depth_.size();
+    stats_.active_lanes_ = depth_.size();
+  }
+
+  /** Place new work on the first @active lanes only */
+  void SetActive(u32 active) {
+    std::lock_guard<std::mutex> guard(lock_);
+    active = std::clamp<u32>(active, 1, depth_.size());
+    stats_.grows_ += active > stats_.active_lanes_;
+    stats_.shrinks_ += active < stats_.active_lanes_;
+    stats_.active_lanes_ = active;
+  }
+
+  /** The lane for @task, which touches @file */
+  u32 Map(const Task *task, u64 file, bool is_read) {
+    std::lock_guard<std::mutex> guard(lock_);
+    u32 active = stats_.active_lanes_;
+    u32 idle = std::min_element(depth_.begin(), depth_.begin() + active) -
+               depth_.begin();
+    stats_.tasks_ += 1;
+    auto it = groups_.find(file);
+    if (it == groups_.end()) {
+      u32 lane = file % active;
+      if (Busy(lane) && !depth_[idle]) {
+        lane = idle;
+        stats_.group_steals_ += 1;
+      }
+      it = groups_.emplace(file, Group{lane, 0, 0}).first;
+    } else if (is_read && !it->second.writes_ && Busy(it->second.lane_) &&
+               !depth_[idle]) {
+      stats_.read_steals_ += 1;
+      return Place(task, Mapped{file, idle, true, false});
+    }
+    Group &group = it->second;
+    group.queued_ += 1;
+    group.writes_ += !is_read;
+    return Place(task, Mapped{file, group.lane_, is_read, true});
+  }
+
+  /** @task has completed */
+  void Done(const Task *task) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = mapped_.find(task);
+    if (it == mapped_.end()) {
+      return;
+    }
+    const Mapped &mapped = it->second;
+    depth_[mapped.lane_] -= 1;
+    if (mapped.grouped_) {
+      auto group = groups_.find(mapped.file_);
+      group->second.queued_ -= 1;
+      group->second.writes_ -= !mapped.read_;
+      if (!group->second.queued_) {
+        groups_.erase(group);
+      }
+    }
+    mapped_.erase(it);
+  }
+
+  LaneStats Stats() {
+    std::lock_guard<std::mutex> guard(lock_);
+    return stats_;
+  }
+
+ private:
+  /** The lane a file's queued tasks run on */
+  struct Group {
+    u32 lane_;
+    u32 queued_;
+    u32 writes_;
+  };
+
+  /** Where a queued task went */
+  struct Mapped {
+    u64 file_;
+    u32 lane_;
+    bool read_;
+    bool grouped_; /**< False for stolen reads */
+  };
+
+  bool Busy(u32 lane) const { return depth_[lane] >= kBusyDepth; }
+
+  u32 Place(const Task *task, const Mapped &mapped) {
+    u64 depth = ++depth_[mapped.lane_];
+    stats_.max_depth_ = std::max(stats_.max_depth_, depth);
+    mapped_.emplace(task, mapped);
+    return mapped.lane_;
+  }
+
+  std::mutex lock_;
+  std::vector<u32> depth_ = std::vector<u32>(1);
+  std::unordered_map<u64, Group> groups_;
+  std::unordered_map<const Task *, Mapped> mapped_;
+  LaneStats stats_;
+};
+
+/**
+ * Decides how many lanes a container keeps active from how busy they were
+ * over the last stats period. Lanes double after kGrowPeriods periods in a
+ * row that were busy or had a deep queue, so a burst gets parallelism
+ * quickly. One lane is dropped after kShrinkPeriods quiet periods in a
+ * row, so cores return to the app once the load is gone. Load between the
+ * two thresholds resets both counts, which keeps the lane count from
+ * flapping.
+ * */
+class LaneScaler {
+ public:
+  /** Busy share of the active lanes' time that counts as loaded */
+  CLS_CONST double kGrowUtil = 0.8;
+  /** Busy share below which the active lanes count as quiet */
+  CLS_CONST double kShrinkUtil = 0.3;
+  /** Queued I/O tasks per active lane that counts as loaded */
+  CLS_CONST double kGrowDepth = 2;
+  /** Queued I/O tasks per active lane below which lanes count as quiet */
+  CLS_CONST double kShrinkDepth = 0.5;
+  CLS_CONST u32 kGrowPeriods = 2;
+  CLS_CONST u32 kShrinkPeriods = 10;
+
+ public:
+  /** Scale between @min_lanes and @max_lanes, starting at @min_lanes */
+  void Configure(u32 min_lanes, u32 max_lanes) {
+    max_ = std::max<u32>(max_lanes, 1);
+    min_ = std::clamp<u32>(min_lanes, 1, max_);
+    active_ = min_;
+  }
+
+  /**
+   * The lanes to keep active after a period in which they were busy
+   * @util of the time with @depth I/O tasks queued.
+   * */
+  u32 Update(double util, double depth) {
+    double per_lane = depth / active_;
+    if (util >= kGrowUtil || per_lane >= kGrowDepth) {
+      quiet_ = 0;
+      if (++loaded_ >= kGrowPeriods && active_ < max_) {
+        active_ = std::min(active_ * 2, max_);
+        loaded_ = 0;
+      }
+    } else if (util < kShrinkUtil && per_lane < kShrinkDepth) {
+      loaded_ = 0;
+      if (++quiet_ >= kShrinkPeriods && active_ > min_) {
+        active_ -= 1;
+        quiet_ = 0;
+      }
+    } else {
+      loaded_ = 0;
+      quiet_ = 0;
+    }
+    return active_;
+  }
+
+  u32 Active() const { return active_; }
+
+ private:
+  u32 min_ = 1;
+  u32 max_ = 1;
+  u32 active_ = 1;
+  u32 loaded_ = 0; /**< Loaded periods in a row */
+  u32 quiet_ = 0;  /**< Quiet periods in a row */
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_LANES_H_
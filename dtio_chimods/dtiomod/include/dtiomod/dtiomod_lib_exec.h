@@ -36,6 +36,82 @@ void Run(u32 method, Task *task, RunContext &rctx) override {
       Schedule(reinterpret_cast<ScheduleTask *>(task), rctx);
       break;
     }
+    case Method::kWriteV: {
+      WriteV(reinterpret_cast<WriteVTask *>(task), rctx);
+      break;
+    }
+    case Method::kReadV: {
+      ReadV(reinterpret_cast<ReadVTask *>(task), rctx);
+      break;
+    }
+    case Method::kCollectStats: {
+      CollectStats(reinterpret_cast<CollectStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kPublishStats: {
+      PublishStats(reinterpret_cast<PublishStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kQosStats: {
+      QosStats(reinterpret_cast<QosStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kLaneStats: {
+      LaneStats(reinterpret_cast<LaneStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kInflight: {
+      Inflight(reinterpret_cast<InflightTask *>(task), rctx);
+      break;
+    }
+    case Method::kStaging: {
+      Staging(reinterpret_cast<StagingTask *>(task), rctx);
+      break;
+    }
+    case Method::kFlush: {
+      Flush(reinterpret_cast<FlushTask *>(task), rctx);
+      break;
+    }
+    case Method::kCompact: {
+      Compact(reinterpret_cast<CompactTask *>(task), rctx);
+      break;
+    }
+    case Method::kPackGet: {
+      PackGet(reinterpret_cast<PackGetTask *>(task), rctx);
+      break;
+    }
+    case Method::kPackPut: {
+      PackPut(reinterpret_cast<PackPutTask *>(task), rctx);
+      break;
+    }
+    case Method::kPackRemove: {
+      PackRemove(reinterpret_cast<PackRemoveTask *>(task), rctx);
+      break;
+    }
+    case Method::kMemOpen: {
+      MemOpen(reinterpret_cast<MemOpenTask *>(task), rctx);
+      break;
+    }
+    case Method::kDiscard: {
+      Discard(reinterpret_cast<DiscardTask *>(task), rctx);
+      break;
+    }
+    case Method::kCopy: {
+      Copy(reinterpret_cast<CopyTask *>(task), rctx);
+      break;
+    }
+    case Method::kTierStats: {
+      TierStats(reinterpret_cast<TierStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kRecordExtents: {
+      RecordExtents(reinterpret_cast<RecordExtentsTask *>(task), rctx);
+      break;
+    }
+    case Method::kTruncate: {
+      Truncate(reinterpret_cast<TruncateTask *>(task), rctx);
+      break;
+    }
   }
 }
 /** Execute a task */
@@ -73,6 +149,82 @@ void Monitor(MonitorModeId mode, MethodId method, Task *task, RunContext &rctx)
       MonitorSchedule(mode, reinterpret_cast<ScheduleTask *>(task), rctx);
       break;
     }
+    case Method::kWriteV: {
+      MonitorWriteV(mode, reinterpret_cast<WriteVTask *>(task), rctx);
+      break;
+    }
+    case Method::kReadV: {
+      MonitorReadV(mode, reinterpret_cast<ReadVTask *>(task), rctx);
+      break;
+    }
+    case Method::kCollectStats: {
+      MonitorCollectStats(mode, reinterpret_cast<CollectStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kPublishStats: {
+      MonitorPublishStats(mode, reinterpret_cast<PublishStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kQosStats: {
+      MonitorQosStats(mode, reinterpret_cast<QosStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kLaneStats: {
+      MonitorLaneStats(mode, reinterpret_cast<LaneStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kInflight: {
+      MonitorInflight(mode, reinterpret_cast<InflightTask *>(task), rctx);
+      break;
+    }
+    case Method::kStaging: {
+      MonitorStaging(mode, reinterpret_cast<StagingTask *>(task), rctx);
+      break;
+    }
+    case Method::kFlush: {
+      MonitorFlush(mode, reinterpret_cast<FlushTask *>(task), rctx);
+      break;
+    }
+    case Method::kCompact: {
+      MonitorCompact(mode, reinterpret_cast<CompactTask *>(task), rctx);
+      break;
+    }
+    case Method::kPackGet: {
+      MonitorPackGet(mode, reinterpret_cast<PackGetTask *>(task), rctx);
+      break;
+    }
+    case Method::kPackPut: {
+      MonitorPackPut(mode, reinterpret_cast<PackPutTask *>(task), rctx);
+      break;
+    }
+    case Method::kPackRemove: {
+      MonitorPackRemove(mode, reinterpret_cast<PackRemoveTask *>(task), rctx);
+      break;
+    }
+    case Method::kMemOpen: {
+      MonitorMemOpen(mode, reinterpret_cast<MemOpenTask *>(task), rctx);
+      break;
+    }
+    case Method::kDiscard: {
+      MonitorDiscard(mode, reinterpret_cast<DiscardTask *>(task), rctx);
+      break;
+    }
+    case Method::kCopy: {
+      MonitorCopy(mode, reinterpret_cast<CopyTask *>(task), rctx);
+      break;
+    }
+    case Method::kTierStats: {
+      MonitorTierStats(mode, reinterpret_cast<TierStatsTask *>(task), rctx);
+      break;
+    }
+    case Method::kRecordExtents: {
+      MonitorRecordExtents(mode, reinterpret_cast<RecordExtentsTask *>(task), rctx);
+      break;
+    }
+    case Method::kTruncate: {
+      MonitorTruncate(mode, reinterpret_cast<TruncateTask *>(task), rctx);
+      break;
+    }
   }
 }
 /** Delete a task */
@@ -110,6 +262,82 @@ void Del(const hipc::MemContext &mctx, u32 method, Task *task) override {
       CHI_CLIENT->DelTask<ScheduleTask>(mctx, reinterpret_cast<ScheduleTask *>(task));
       break;
     }
+    case Method::kWriteV: {
+      CHI_CLIENT->DelTask<WriteVTask>(mctx, reinterpret_cast<WriteVTask *>(task));
+      break;
+    }
+    case Method::kReadV: {
+      CHI_CLIENT->DelTask<ReadVTask>(mctx, reinterpret_cast<ReadVTask *>(task));
+      break;
+    }
+    case Method::kCollectStats: {
+      CHI_CLIENT->DelTask<CollectStatsTask>(mctx, reinterpret_cast<CollectStatsTask *>(task));
+      break;
+    }
+    case Method::kPublishStats: {
+      CHI_CLIENT->DelTask<PublishStatsTask>(mctx, reinterpret_cast<PublishStatsTask *>(task));
+      break;
+    }
+    case Method::kQosStats: {
+      CHI_CLIENT->DelTask<QosStatsTask>(mctx, reinterpret_cast<QosStatsTask *>(task));
+      break;
+    }
+    case Method::kLaneStats: {
+      CHI_CLIENT->DelTask<LaneStatsTask>(mctx, reinterpret_cast<LaneStatsTask *>(task));
+      break;
+    }
+    case Method::kInflight: {
+      CHI_CLIENT->DelTask<InflightTask>(mctx, reinterpret_cast<InflightTask *>(task));
+      break;
+    }
+    case Method::kStaging: {
+      CHI_CLIENT->DelTask<StagingTask>(mctx, reinterpret_cast<StagingTask *>(task));
+      break;
+    }
+    case Method::kFlush: {
+      CHI_CLIENT->DelTask<FlushTask>(mctx, reinterpret_cast<FlushTask *>(task));
+      break;
+    }
+    case Method::kCompact: {
+      CHI_CLIENT->DelTask<CompactTask>(mctx, reinterpret_cast<CompactTask *>(task));
+      break;
+    }
+    case Method::kPackGet: {
+      CHI_CLIENT->DelTask<PackGetTask>(mctx, reinterpret_cast<PackGetTask *>(task));
+      break;
+    }
+    case Method::kPackPut: {
+      CHI_CLIENT->DelTask<PackPutTask>(mctx, reinterpret_cast<PackPutTask *>(task));
+      break;
+    }
+    case Method::kPackRemove: {
+      CHI_CLIENT->DelTask<PackRemoveTask>(mctx, reinterpret_cast<PackRemoveTask *>(task));
+      break;
+    }
+    case Method::kMemOpen: {
+      CHI_CLIENT->DelTask<MemOpenTask>(mctx, reinterpret_cast<MemOpenTask *>(task));
+      break;
+    }
+    case Method::kDiscard: {
+      CHI_CLIENT->DelTask<DiscardTask>(mctx, reinterpret_cast<DiscardTask *>(task));
+      break;
+    }
+    case Method::kCopy: {
+      CHI_CLIENT->DelTask<CopyTask>(mctx, reinterpret_cast<CopyTask *>(task));
+      break;
+    }
+    case Method::kTierStats: {
+      CHI_CLIENT->DelTask<TierStatsTask>(mctx, reinterpret_cast<TierStatsTask *>(task));
+      break;
+    }
+    case Method::kRecordExtents: {
+      CHI_CLIENT->DelTask<RecordExtentsTask>(mctx, reinterpret_cast<RecordExtentsTask *>(task));
+      break;
+    }
+    case Method::kTruncate: {
+      CHI_CLIENT->DelTask<TruncateTask>(mctx, reinterpret_cast<TruncateTask *>(task));
+      break;
+    }
   }
 }
 /** Duplicate a task */
@@ -163,6 +391,120 @@ void CopyStart(u32 method, const Task *orig_task, Task *dup_task, bool deep) ove
         reinterpret_cast<ScheduleTask*>(dup_task), deep);
       break;
     }
+    case Method::kWriteV: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const WriteVTask*>(orig_task), 
+        reinterpret_cast<WriteVTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kReadV: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const ReadVTask*>(orig_task), 
+        reinterpret_cast<ReadVTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kCollectStats: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const CollectStatsTask*>(orig_task), 
+        reinterpret_cast<CollectStatsTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kPublishStats: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const PublishStatsTask*>(orig_task), 
+        reinterpret_cast<PublishStatsTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kQosStats: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const QosStatsTask*>(orig_task), 
+        reinterpret_cast<QosStatsTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kLaneStats: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const LaneStatsTask*>(orig_task), 
+        reinterpret_cast<LaneStatsTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kInflight: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const InflightTask*>(orig_task), 
+        reinterpret_cast<InflightTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kStaging: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const StagingTask*>(orig_task), 
+        reinterpret_cast<StagingTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kFlush: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const FlushTask*>(orig_task), 
+        reinterpret_cast<FlushTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kCompact: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const CompactTask*>(orig_task), 
+        reinterpret_cast<CompactTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kPackGet: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const PackGetTask*>(orig_task), 
+        reinterpret_cast<PackGetTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kPackPut: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const PackPutTask*>(orig_task), 
+        reinterpret_cast<PackPutTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kPackRemove: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const PackRemoveTask*>(orig_task), 
+        reinterpret_cast<PackRemoveTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kMemOpen: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const MemOpenTask*>(orig_task), 
+        reinterpret_cast<MemOpenTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kDiscard: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const DiscardTask*>(orig_task), 
+        reinterpret_cast<DiscardTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kCopy: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const CopyTask*>(orig_task), 
+        reinterpret_cast<CopyTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kTierStats: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const TierStatsTask*>(orig_task), 
+        reinterpret_cast<TierStatsTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kRecordExtents: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const RecordExtentsTask*>(orig_task), 
+        reinterpret_cast<RecordExtentsTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kTruncate: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const TruncateTask*>(orig_task), 
+        reinterpret_cast<TruncateTask*>(dup_task), deep);
+      break;
+    }
   }
 }
 /** Duplicate a task */
@@ -200,6 +542,82 @@ void NewCopyStart(u32 method, const Task *orig_task, FullPtr<Task> &dup_task, bo
       chi::CALL_NEW_COPY_START(reinterpret_cast<const ScheduleTask*>(orig_task), dup_task, deep);
       break;
     }
+    case Method::kWriteV: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const WriteVTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kReadV: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const ReadVTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kCollectStats: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const CollectStatsTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kPublishStats: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const PublishStatsTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kQosStats: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const QosStatsTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kLaneStats: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const LaneStatsTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kInflight: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const InflightTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kStaging: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const StagingTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kFlush: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const FlushTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kCompact: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const CompactTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kPackGet: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const PackGetTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kPackPut: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const PackPutTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kPackRemove: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const PackRemoveTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kMemOpen: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const MemOpenTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kDiscard: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const DiscardTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kCopy: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const CopyTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kTierStats: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const TierStatsTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kRecordExtents: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const RecordExtentsTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kTruncate: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const TruncateTask*>(orig_task), dup_task, deep);
+      break;
+    }
   }
 }
 /** Serialize a task when initially pushing into remote */
@@ -239,6 +657,82 @@ void SaveStart(
       ar << *reinterpret_cast<ScheduleTask*>(task);
       break;
     }
+    case Method::kWriteV: {
+      ar << *reinterpret_cast<WriteVTask*>(task);
+      break;
+    }
+    case Method::kReadV: {
+      ar << *reinterpret_cast<ReadVTask*>(task);
+      break;
+    }
+    case Method::kCollectStats: {
+      ar << *reinterpret_cast<CollectStatsTask*>(task);
+      break;
+    }
+    case Method::kPublishStats: {
+      ar << *reinterpret_cast<PublishStatsTask*>(task);
+      break;
+    }
+    case Method::kQosStats: {
+      ar << *reinterpret_cast<QosStatsTask*>(task);
+      break;
+    }
+    case Method::kLaneStats: {
+      ar << *reinterpret_cast<LaneStatsTask*>(task);
+      break;
+    }
+    case Method::kInflight: {
+      ar << *reinterpret_cast<InflightTask*>(task);
+      break;
+    }
+    case Method::kStaging: {
+      ar << *reinterpret_cast<StagingTask*>(task);
+      break;
+    }
+    case Method::kFlush: {
+      ar << *reinterpret_cast<FlushTask*>(task);
+      break;
+    }
+    case Method::kCompact: {
+      ar << *reinterpret_cast<CompactTask*>(task);
+      break;
+    }
+    case Method::kPackGet: {
+      ar << *reinterpret_cast<PackGetTask*>(task);
+      break;
+    }
+    case Method::kPackPut: {
+      ar << *reinterpret_cast<PackPutTask*>(task);
+      break;
+    }
+    case Method::kPackRemove: {
+      ar << *reinterpret_cast<PackRemoveTask*>(task);
+      break;
+    }
+    case Method::kMemOpen: {
+      ar << *reinterpret_cast<MemOpenTask*>(task);
+      break;
+    }
+    case Method::kDiscard: {
+      ar << *reinterpret_cast<DiscardTask*>(task);
+      break;
+    }
+    case Method::kCopy: {
+      ar << *reinterpret_cast<CopyTask*>(task);
+      break;
+    }
+    case Method::kTierStats: {
+      ar << *reinterpret_cast<TierStatsTask*>(task);
+      break;
+    }
+    case Method::kRecordExtents: {
+      ar << *reinterpret_cast<RecordExtentsTask*>(task);
+      break;
+    }
+    case Method::kTruncate: {
+      ar << *reinterpret_cast<TruncateTask*>(task);
+      break;
+    }
   }
 }
 /** Deserialize a task when popping from remote queue */
@@ -293,6 +787,120 @@ TaskPointer LoadStart(    u32 method, BinaryInputArchive<true> &ar) override {
       ar >> *reinterpret_cast<ScheduleTask*>(task_ptr.ptr_);
       break;
     }
+    case Method::kWriteV: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<WriteVTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<WriteVTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kReadV: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<ReadVTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<ReadVTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kCollectStats: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<CollectStatsTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<CollectStatsTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kPublishStats: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<PublishStatsTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<PublishStatsTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kQosStats: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<QosStatsTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<QosStatsTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kLaneStats: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<LaneStatsTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<LaneStatsTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kInflight: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<InflightTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<InflightTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kStaging: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<StagingTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<StagingTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kFlush: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<FlushTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<FlushTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kCompact: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<CompactTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<CompactTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kPackGet: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<PackGetTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<PackGetTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kPackPut: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<PackPutTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<PackPutTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kPackRemove: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<PackRemoveTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<PackRemoveTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kMemOpen: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<MemOpenTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<MemOpenTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kDiscard: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<DiscardTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<DiscardTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kCopy: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<CopyTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<CopyTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kTierStats: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<TierStatsTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<TierStatsTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kRecordExtents: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<RecordExtentsTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<RecordExtentsTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kTruncate: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<TruncateTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<TruncateTask*>(task_ptr.ptr_);
+      break;
+    }
   }
   return task_ptr;
 }
@@ -331,6 +939,82 @@ void SaveEnd(u32 method, BinaryOutputArchive<false> &ar, Task *task) override {
       ar << *reinterpret_cast<ScheduleTask*>(task);
       break;
     }
+    case Method::kWriteV: {
+      ar << *reinterpret_cast<WriteVTask*>(task);
+      break;
+    }
+    case Method::kReadV: {
+      ar << *reinterpret_cast<ReadVTask*>(task);
+      break;
+    }
+    case Method::kCollectStats: {
+      ar << *reinterpret_cast<CollectStatsTask*>(task);
+      break;
+    }
+    case Method::kPublishStats: {
+      ar << *reinterpret_cast<PublishStatsTask*>(task);
+      break;
+    }
+    case Method::kQosStats: {
+      ar << *reinterpret_cast<QosStatsTask*>(task);
+      break;
+    }
+    case Method::kLaneStats: {
+      ar << *reinterpret_cast<LaneStatsTask*>(task);
+      break;
+    }
+    case Method::kInflight: {
+      ar << *reinterpret_cast<InflightTask*>(task);
+      break;
+    }
+    case Method::kStaging: {
+      ar << *reinterpret_cast<StagingTask*>(task);
+      break;
+    }
+    case Method::kFlush: {
+      ar << *reinterpret_cast<FlushTask*>(task);
+      break;
+    }
+    case Method::kCompact: {
+      ar << *reinterpret_cast<CompactTask*>(task);
+      break;
+    }
+    case Method::kPackGet: {
+      ar << *reinterpret_cast<PackGetTask*>(task);
+      break;
+    }
+    case Method::kPackPut: {
+      ar << *reinterpret_cast<PackPutTask*>(task);
+      break;
+    }
+    case Method::kPackRemove: {
+      ar << *reinterpret_cast<PackRemoveTask*>(task);
+      break;
+    }
+    case Method::kMemOpen: {
+      ar << *reinterpret_cast<MemOpenTask*>(task);
+      break;
+    }
+    case Method::kDiscard: {
+      ar << *reinterpret_cast<DiscardTask*>(task);
+      break;
+    }
+    case Method::kCopy: {
+      ar << *reinterpret_cast<CopyTask*>(task);
+      break;
+    }
+    case Method::kTierStats: {
+      ar << *reinterpret_cast<TierStatsTask*>(task);
+      break;
+    }
+    case Method::kRecordExtents: {
+      ar << *reinterpret_cast<RecordExtentsTask*>(task);
+      break;
+    }
+    case Method::kTruncate: {
+      ar << *reinterpret_cast<TruncateTask*>(task);
+      break;
+    }
   }
 }
 /** Deserialize a task when popping from remote queue */
@@ -368,6 +1052,82 @@ void LoadEnd(u32 method, BinaryInputArchive<false> &ar, Task *task) override {
       ar >> *reinterpret_cast<ScheduleTask*>(task);
       break;
     }
+    case Method::kWriteV: {
+      ar >> *reinterpret_cast<WriteVTask*>(task);
+      break;
+    }
+    case Method::kReadV: {
+      ar >> *reinterpret_cast<ReadVTask*>(task);
+      break;
+    }
+    case Method::kCollectStats: {
+      ar >> *reinterpret_cast<CollectStatsTask*>(task);
+      break;
+    }
+    case Method::kPublishStats: {
+      ar >> *reinterpret_cast<PublishStatsTask*>(task);
+      break;
+    }
+    case Method::kQosStats: {
+      ar >> *reinterpret_cast<QosStatsTask*>(task);
+      break;
+    }
+    case Method::kLaneStats: {
+      ar >> *reinterpret_cast<LaneStatsTask*>(task);
+      break;
+    }
+    case Method::kInflight: {
+      ar >> *reinterpret_cast<InflightTask*>(task);
+      break;
+    }
+    case Method::kStaging: {
+      ar >> *reinterpret_cast<StagingTask*>(task);
+      break;
+    }
+    case Method::kFlush: {
+      ar >> *reinterpret_cast<FlushTask*>(task);
+      break;
+    }
+    case Method::kCompact: {
+      ar >> *reinterpret_cast<CompactTask*>(task);
+      break;
+    }
+    case Method::kPackGet: {
+      ar >> *reinterpret_cast<PackGetTask*>(task);
+      break;
+    }
+    case Method::kPackPut: {
+      ar >> *reinterpret_cast<PackPutTask*>(task);
+      break;
+    }
+    case Method::kPackRemove: {
+      ar >> *reinterpret_cast<PackRemoveTask*>(task);
+      break;
+    }
+    case Method::kMemOpen: {
+      ar >> *reinterpret_cast<MemOpenTask*>(task);
+      break;
+    }
+    case Method::kDiscard: {
+      ar >> *reinterpret_cast<DiscardTask*>(task);
+      break;
+    }
+    case Method::kCopy: {
+      ar >> *reinterpret_cast<CopyTask*>(task);
+      break;
+    }
+    case Method::kTierStats: {
+      ar >> *reinterpret_cast<TierStatsTask*>(task);
+      break;
+    }
+    case Method::kRecordExtents: {
+      ar >> *reinterpret_cast<RecordExtentsTask*>(task);
+      break;
+    }
+    case Method::kTruncate: {
+      ar >> *reinterpret_cast<TruncateTask*>(task);
+      break;
+    }
   }
 }
 
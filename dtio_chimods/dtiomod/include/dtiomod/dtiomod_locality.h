@@ -0,0 +1,186 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_LOCALITY_H_
+#define CHI_dtiomod_LOCALITY_H_
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "chimaera/chimaera_namespace.h"
+
+namespace chi::dtiomod {
+
+/**
+ * Tracks which container holds each byte range of a file. Ranges are
+ * recorded once the writes to them complete, so reads can be sent to the
+ * container that wrote them. The map is only a hint: it holds a bounded
+ * number of files and extents, and forgets a file rather than grow past it.
+ * */
+class ExtentMap {
+ public:
+  /** Most files tracked at once */
+  CLS_CONST size_t kMaxFiles = 4096;
+  /** Most extents tracked per file */
+  CLS_CONST size_t kMaxExtents = 16384;
+
+  /** A byte range [off, end_) held by @owner_, keyed by its offset */
+  struct Extent {
+    size_t end_;
+    u32 owner_;
+  };
+  typedef std::map<size_t, Extent> FileExtents;
+  typedef std::unordered_map<std::string, FileExtents> Files;
+
+ public:
+  /** The container a stripe of @filename is homed on */
+  static u32 Home(const std::string &filename, size_t stripe,
+                  u32 num_containers) {
+    u64 h = std::hash<std::string>{}(filename) ^
+            (stripe * 0x9e3779b97f4a7c15ull);
+    // splitmix64 finalizer, so neighbouring stripes spread out
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return static_cast<u32>(h % num_containers);
+  }
+
+  /** Record that @owner now holds [off, off + size) of @filename */
+  void Assign(const std::string &filename, size_t off, size_t size,
+              u32 owner) {
+    if (size == 0) {
+      return;
+    }
+    if (files_.size() >= kMaxFiles && !files_.count(filename)) {
+      files_.erase(files_.begin());
+    }
+    FileExtents &extents = files_[filename];
+    size_t end = off + size;
+
+    // Trim the extents overlapping the new one
+    auto it = extents.lower_bound(off);
+    if (it != extents.begin()) {
+      auto prev = std::prev(it);
+      if (prev->second.end_ > off) {
+        Extent tail = prev->second;
+        prev->second.end_ = off;
+        if (tail.end_ > end) {
+          extents.emplace(end, tail);
+        }
+      }
+    }
+    while (it != extents.end() && it->first < end) {
+      if (it->second.end_ > end) {
+        extents.emplace(end, it->second);
+      }
+      it = extents.erase(it);
+    }
+
+    // Insert, merging with neighbours on the same container
+    it = extents.emplace(off, Extent{end, owner}).first;
+    auto next = std::next(it);
+    if (next != extents.end() && next->first == end &&
+        next->second.owner_ == owner) {
+      it->second.end_ = next->second.end_;
+      extents.erase(next);
+    }
+    if (it != extents.begin()) {
+      auto prev = std::prev(it);
+      if (prev->second.end_ == off && prev->second.owner_ == owner) {
+        prev->second.end_ = it->second.end_;
+        extents.erase(it);
+      }
+    }
+    if (extents.size() > kMaxExtents) {
+      files_.erase(filename);
+    }
+  }
+
+  /**
+   * The container holding the most bytes of [off, off + size) of @filename.
+   * Returns false if no part of the range has been placed.
+   * */
+  bool Owner(const std::string &filename, size_t off, size_t size,
+             u32 &owner) const {
+    auto file = files_.find(filename);
+    if (file == files_.end()) {
+      return false;
+    }
+    const FileExtents &extents = file->second;
+    size_t end = off + std::max<size_t>(size, 1);
+    auto it = extents.upper_bound(off);
+    if (it != extents.begin()) {
+      --it;
+    }
+    std::unordered_map<u32, size_t> held;
+    size_t best = 0;
+    for (; it != extents.end() && it->first < end; ++it) {
+      size_t lo = std::max(it->first, off);
+      size_t hi = std::min(it->second.end_, end);
+      if (hi <= lo) {
+        continue;
+      }
+      size_t bytes = held[it->second.owner_] += hi - lo;
+      if (bytes > best) {
+        best = bytes;
+        owner = it->second.owner_;
+      }
+    }
+    return best > 0;
+  }
+
+  /** How many extents of @filename are recorded */
+  size_t Count(const std::string &filename) const {
+    auto file = files_.find(filename);
+    return file == files_.end() ? 0 : file->second.size();
+  }
+
+  /** Forget where @filename lives */
+  void Erase(const std::string &filename) { files_.erase(filename); }
+
+  /** Forget where the bytes of @filename at or past @size live */
+  void Truncate(const std::string &filename, size_t size) {
+    auto file = files_.find(filename);
+    if (file == files_.end()) {
+      return;
+    }
+    FileExtents &extents = file->second;
+    auto it = extents.lower_bound(size);
+    extents.erase(it, extents.end());
+    if (!extents.empty()) {
+      Extent &last = extents.rbegin()->second;
+      last.end_ = std::min(last.end_, size);
+    }
+    if (extents.empty()) {
+      files_.erase(file);
+    }
+  }
+
+  /** Hand over every recorded extent, leaving the map empty */
+  Files Take() {
+    Files files;
+    files.swap(files_);
+    return files;
+  }
+
+ private:
+  Files files_;
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_LOCALITY_H_
@@ -0,0 +1,712 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef CHI_dtiomod_LOGS_H_
+#define CHI_dtiomod_LOGS_H_
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtiomod_tiers.h"
+
+namespace chi::dtiomod {
+
+/** One write appended to a log, as recorded in its index */
+struct LogEntry {
+  u64 offset_;   /**< Where the data goes in the file */
+  u64 size_;
+  u64 log_pos_;  /**< Where the data is in the log */
+  u64 stamp_ns_; /**< Its hybrid logical clock, to order overlapping writes */
+};
+
+/**
+ * Log-structured storage for files written by many processes at once (the
+ * PLFS approach). Each container appends the writes it receives to a log of
+ * its own, so the PFS sees one sequential writer per file per node instead
+ * of interleaved strided writes to a shared file. An index records where in
+ * the log each write went. When tiers are enabled, the log is written
+ * through them and drained to the PFS in the background.
+ *
+ * The logs of a file live in "<path>.logs/", as "<container>.<gen>.log"
+ * and "<container>.<gen>.index". Sync appends a container's new index
+ * entries to its index file once its log data is on the PFS, which makes
+ * them visible to every other container. A read merges the index files,
+ * the newest write winning where writes overlap, and reads each range from
+ * the log that holds it. Ranges in no log come from the file in place.
+ *
+ * Writes are ordered by a hybrid logical clock, since containers on
+ * different nodes share no clock. A write is stamped with the larger of
+ * the wall clock and one past the last stamp its container issued or saw
+ * in another container's index. So a container's own writes keep their
+ * order, and a write made after a container read another's synced write
+ * orders after it. Writes on different nodes that raced are ordered by
+ * wall clock, as closely as the nodes' clocks agree. Equal stamps are
+ * ordered by container, then by place in the index, so every container
+ * builds the same view.
+ *
+ * Compaction runs on one container per file. It copies the synced entries
+ * into the file in offset order and records how many entries of each index
+ * it consumed in "<container>.<gen>.done". Readers skip consumed entries.
+ * Once all of a container's entries are consumed, it starts a new
+ * generation and removes the old files.
+ * */
+class LogStore {
+ public:
+  /** How stale a container's view of the other containers' indexes gets */
+  CLS_CONST u64 kRefreshMs = 100;
+  /** How long a file's compaction waits for more requests to arrive */
+  CLS_CONST u64 kCompactDelayMs = 1000;
+  /** Largest write compaction issues to the file */
+  CLS_CONST size_t kCompactSize = MEGABYTES(8);
+
+ public:
+  void Configure(bool enabled, u32 container_id, TierManager *tiers) {
+    enabled_ = enabled;
+    container_id_ = container_id;
+    tiers_ = tiers;
+  }
+
+  bool Enabled() const { return enabled_; }
+
+  /** Append @size bytes of @data for @offset of @path to this container's
+   * log. Returns the bytes written, or -1. */
+  ssize_t Write(const std::string &path, size_t offset, const char *data,
+                size_t size) {
+    std::shared_ptr<FileLog> file = GetFile(path);
+    u64 pos;
+    std::string log;
+    {
+      std::lock_guard<std::mutex> guard(file->lock_);
+      if (file->log_end_ == 0) {
+        mkdir(LogDir(path).c_str(), 0775);
+      }
+      pos = file->log_end_;
+      file->log_end_ += size;
+      file->writing_ += 1;
+      log = LogPath(path, container_id_, file->gen_);
+    }
+    ssize_t ret = tiers_ && tiers_->Enabled()
+                      ? tiers_->Write(log, pos, data, size)
+                      : PosixWrite(log, data, size, pos);
+    std::lock_guard<std::mutex> guard(file->lock_);
+    file->writing_ -= 1;
+    if (ret != static_cast<ssize_t>(size)) {
+      return -1;
+    }
+    file->entries_.emplace_back(LogEntry{offset, size, pos, Tick()});
+    file->view_stale_ = true;
+    return size;
+  }
+
+  /**
+   * Read @size bytes at @offset of @path into @data from the logs and the
+   * file. Returns the bytes up to the end of the file, or -1.
+   * */
+  ssize_t Read(const std::string &path, size_t offset, char *data,
+               size_t size, u64 now_ns) {
+    std::shared_ptr<FileLog> file = GetFile(path);
+    std::lock_guard<std::mutex> guard(file->lock_);
+    if (file->view_stale_ ||
+        now_ns - file->view_stamp_ns_ > kRefreshMs * 1000000) {
+      RefreshView(path, *file, now_ns);
+    }
+    size_t end = offset + size;
+    size_t valid = 0; /**< End of the bytes known to exist */
+    std::map<size_t, Piece> &view = file->view_;
+    auto it = view.upper_bound(offset);
+    if (it != view.begin() && std::prev(it)->second.end_ > offset) {
+      --it;
+    }
+    for (size_t pos = offset; pos < end;) {
+      char *out = data + (pos - offset);
+      if (it != view.end() && it->first <= pos) {
+        size_t len = std::min<size_t>(it->second.end_, end) - pos;
+        if (ReadPiece(path, *file, it->first, it->second, pos, out, len) <
+            0) {
+          return -1;
+        }
+        pos += len;
+        valid = pos;
+        ++it;
+        continue;
+      }
+      size_t gap_end = it == view.end() ? end : std::min(it->first, end);
+      size_t len = gap_end - pos;
+      ssize_t ret = PosixRead(path, out, len, pos);
+      size_t got = ret > 0 ? ret : 0;
+      memset(out + got, 0, len - got);
+      if (got) {
+        valid = pos + got;
+      }
+      pos = gap_end;
+    }
+    if (!view.empty()) {
+      valid = std::max(valid, std::min<size_t>(end, view.rbegin()->second.end_));
+    }
+    return valid > offset ? valid - offset : 0;
+  }
+
+  /**
+   * Put this container's log of @path on the PFS and publish its new index
+   * entries to the other containers. Returns false if the PFS failed.
+   * */
+  bool Sync(const std::string &path) {
+    std::shared_ptr<FileLog> file = GetFile(path);
+    std::lock_guard<std::mutex> guard(file->lock_);
+    return SyncLocked(path, *file);
+  }
+
+  /** Sync every file this container has logged. Returns false on failure. */
+  bool SyncAll() {
+    bool synced = true;
+    for (const std::string &path : Paths()) {
+      synced &= Sync(path);
+    }
+    return synced;
+  }
+
+  /** Compact @path once no request has arrived for kCompactDelayMs */
+  void RequestCompact(const std::string &path, u64 now_ns) {
+    std::lock_guard<std::mutex> guard(lock_);
+    compact_due_[path] = now_ns + kCompactDelayMs * 1000000;
+  }
+
+  /** Compact the files whose requests are due. Returns the bytes copied. */
+  size_t CompactDue(u64 now_ns) {
+    std::vector<std::string> due;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      for (auto it = compact_due_.begin(); it != compact_due_.end();) {
+        if (it->second <= now_ns) {
+          due.emplace_back(it->first);
+          it = compact_due_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    size_t compacted = 0;
+    for (const std::string &path : due) {
+      compacted += Compact(path);
+    }
+    return compacted;
+  }
+
+  /**
+   * Copy the synced entries of every log of @path into the file, in offset
+   * order, and mark them consumed. Returns the bytes copied.
+   * */
+  size_t Compact(const std::string &path) {
+    Sync(path);
+    std::vector<Source> sources = LoadSources(path, kAllGens);
+    std::vector<SourcedEntry> entries;
+    for (size_t i = 0; i < sources.size(); ++i) {
+      for (size_t j = sources[i].done_; j < sources[i].entries_.size(); ++j) {
+        entries.emplace_back(
+            SourcedEntry{sources[i].entries_[j], i, sources[i].container_, j});
+      }
+    }
+    std::map<size_t, Piece> view;
+    BuildView(entries, view);
+
+    // Coalesce adjacent pieces into large writes
+    size_t compacted = 0;
+    for (auto it = view.begin(); it != view.end();) {
+      size_t begin = it->first;
+      size_t end = begin;
+      std::vector<char> buf;
+      for (; it != view.end() && it->first == end &&
+             end - begin < kCompactSize;
+           ++it) {
+        size_t len = it->second.end_ - it->first;
+        buf.resize(buf.size() + len);
+        const Source &source = sources[it->second.source_];
+        ssize_t ret = PosixRead(source.log_, buf.data() + (end - begin), len,
+                                it->second.log_pos_);
+        if (ret < 0) {
+          return compacted;
+        }
+        memset(buf.data() + (end - begin) + ret, 0, len - ret);
+        end = it->second.end_;
+      }
+      if (PosixWrite(path, buf.data(), buf.size(), begin) !=
+          static_cast<ssize_t>(buf.size())) {
+        return compacted;
+      }
+      compacted += buf.size();
+    }
+    for (const Source &source : sources) {
+      u64 done = source.entries_.size();
+      std::string tmp = source.done_path_ + ".tmp";
+      if (PosixWrite(tmp, reinterpret_cast<const char *>(&done), sizeof(done),
+                     0) == sizeof(done)) {
+        rename(tmp.c_str(), source.done_path_.c_str());
+      }
+    }
+    return compacted;
+  }
+
+  /**
+   * Drop what this container's logs hold of @path at or past @size, once
+   * the file was truncated to it, or remove them all if @unlinked. Entries
+   * are clipped rather than removed, so the counts in the done files still
+   * hold. Returns false if an index could not be rewritten.
+   * */
+  bool Truncate(const std::string &path, size_t size, bool unlinked) {
+    std::shared_ptr<FileLog> file = GetFile(path);
+    std::lock_guard<std::mutex> guard(file->lock_);
+    file->view_stale_ = true;
+    if (unlinked) {
+      {
+        std::lock_guard<std::mutex> guard(lock_);
+        compact_due_.erase(path);
+      }
+      std::string log = LogPath(path, container_id_, file->gen_);
+      if (tiers_ && tiers_->Enabled()) {
+        tiers_->Discard(log, 0);
+      }
+      unlink(log.c_str());
+      for (const IndexName &name : ListIndexes(path)) {
+        if (name.container_ == container_id_) {
+          unlink(LogPath(path, container_id_, name.gen_).c_str());
+          unlink(IndexPath(path, container_id_, name.gen_).c_str());
+          unlink(DonePath(path, container_id_, name.gen_).c_str());
+        }
+      }
+      rmdir(LogDir(path).c_str());  // Fails while other logs remain
+      file->gen_ += 1;
+      file->log_end_ = 0;
+      file->entries_.clear();
+      file->synced_ = 0;
+      return true;
+    }
+    ClipEntries(file->entries_, size);
+    bool rewritten = true;
+    for (const IndexName &name : ListIndexes(path)) {
+      if (name.container_ != container_id_) {
+        continue;
+      }
+      std::vector<LogEntry> entries;
+      if (name.gen_ == file->gen_) {
+        entries.assign(file->entries_.begin(),
+                       file->entries_.begin() + file->synced_);
+      } else {
+        ReadIndex(IndexPath(path, container_id_, name.gen_), entries);
+        ClipEntries(entries, size);
+      }
+      rewritten &=
+          RewriteIndex(IndexPath(path, container_id_, name.gen_), entries);
+    }
+    return rewritten;
+  }
+
+  /**
+   * Start a new generation of each log whose entries have all been
+   * compacted, removing the old files.
+   * */
+  void Trim() {
+    for (const std::string &path : Paths()) {
+      std::shared_ptr<FileLog> file = GetFile(path);
+      std::lock_guard<std::mutex> guard(file->lock_);
+      if (file->entries_.empty() || file->writing_ ||
+          file->synced_ != file->entries_.size()) {
+        continue;
+      }
+      std::string done_path = DonePath(path, container_id_, file->gen_);
+      if (ReadDone(done_path) != file->entries_.size()) {
+        continue;
+      }
+      std::string log = LogPath(path, container_id_, file->gen_);
+      unlink(log.c_str());
+      unlink(IndexPath(path, container_id_, file->gen_).c_str());
+      unlink(done_path.c_str());
+      rmdir(LogDir(path).c_str());  // Fails while other logs remain
+      file->gen_ += 1;
+      file->log_end_ = 0;
+      file->entries_.clear();
+      file->synced_ = 0;
+      file->view_stale_ = true;
+    }
+  }
+
+ private:
+  /** A range of the file and the log that holds it */
+  struct Piece {
+    size_t end_;
+    size_t source_; /**< Index into FileLog::sources_ */
+    u64 log_pos_;   /**< Where the range's first byte is in the log */
+  };
+
+  /** One container's log and index of a file */
+  struct Source {
+    std::string log_;
+    std::string done_path_;
+    std::vector<LogEntry> entries_;
+    size_t done_ = 0; /**< Entries already compacted into the file */
+    u32 container_ = 0;
+    bool local_ = false;
+  };
+
+  struct SourcedEntry {
+    LogEntry entry_;
+    size_t source_;
+    u32 container_;
+    size_t index_; /**< Place in its container's index */
+  };
+
+  /** This container's log of a file, and its view of every log */
+  struct FileLog {
+    std::mutex lock_;
+    u64 gen_ = 0;
+    u64 log_end_ = 0;
+    std::vector<LogEntry> entries_; /**< This container's, in order */
+    size_t synced_ = 0;             /**< Entries in the index file */
+    std::vector<Source> sources_;
+    std::map<size_t, Piece> view_;
+    u64 view_stamp_ns_ = 0; /**< When view_ was built */
+    bool view_stale_ = true; /**< This container appended since */
+    size_t writing_ = 0;    /**< Appends whose data is being written */
+  };
+
+  /** Loading every generation of every container's log */
+  CLS_CONST u64 kAllGens = ~0ull;
+
+  std::shared_ptr<FileLog> GetFile(const std::string &path) {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::shared_ptr<FileLog> &file = files_[path];
+    if (!file) {
+      // Logs left by an earlier run are read, never appended to
+      file = std::make_shared<FileLog>();
+      for (const IndexName &name : ListIndexes(path)) {
+        if (name.container_ == container_id_) {
+          file->gen_ = std::max(file->gen_, name.gen_ + 1);
+        }
+      }
+    }
+    return file;
+  }
+
+  /** An index file in a file's log directory */
+  struct IndexName {
+    u32 container_;
+    u64 gen_;
+  };
+
+  static std::vector<IndexName> ListIndexes(const std::string &path) {
+    std::vector<IndexName> names;
+    DIR *dp = opendir(LogDir(path).c_str());
+    if (!dp) {
+      return names;
+    }
+    while (struct dirent *ent = readdir(dp)) {
+      unsigned container;
+      unsigned long long gen;
+      char kind[8];
+      if (sscanf(ent->d_name, "%u.%llu.%7s", &container, &gen, kind) == 3 &&
+          strcmp(kind, "index") == 0) {
+        names.emplace_back(IndexName{container, gen});
+      }
+    }
+    closedir(dp);
+    return names;
+  }
+
+  std::vector<std::string> Paths() {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::vector<std::string> paths;
+    for (auto &entry : files_) {
+      paths.emplace_back(entry.first);
+    }
+    return paths;
+  }
+
+  /** Requires @file's lock */
+  bool SyncLocked(const std::string &path, FileLog &file) {
+    if (file.synced_ == file.entries_.size()) {
+      return true;
+    }
+    std::string log = LogPath(path, container_id_, file.gen_);
+    if (tiers_ && tiers_->Enabled()) {
+      tiers_->DrainFile(log, SIZE_MAX);
+      if (tiers_->Progress(log).held_bytes_) {
+        return false;
+      }
+    }
+    size_t count = file.entries_.size() - file.synced_;
+    ssize_t ret = PosixWrite(
+        IndexPath(path, container_id_, file.gen_),
+        reinterpret_cast<const char *>(file.entries_.data() + file.synced_),
+        count * sizeof(LogEntry), file.synced_ * sizeof(LogEntry));
+    if (ret != static_cast<ssize_t>(count * sizeof(LogEntry))) {
+      return false;
+    }
+    file.synced_ = file.entries_.size();
+    return true;
+  }
+
+  /**
+   * The synced logs of @path on the PFS, except this container's log of
+   * generation @skip_gen
+   * */
+  std::vector<Source> LoadSources(const std::string &path, u64 skip_gen) {
+    std::vector<Source> sources;
+    for (const IndexName &name : ListIndexes(path)) {
+      if (name.container_ == container_id_ && name.gen_ == skip_gen) {
+        continue;
+      }
+      Source source;
+      source.container_ = name.container_;
+      source.log_ = LogPath(path, name.container_, name.gen_);
+      source.done_path_ = DonePath(path, name.container_, name.gen_);
+      source.done_ = ReadDone(source.done_path_);
+      ReadIndex(IndexPath(path, name.container_, name.gen_), source.entries_);
+      sources.emplace_back(std::move(source));
+    }
+    return sources;
+  }
+
+  /**
+   * Rebuild @file's view of every log, taking this container's current log
+   * with its unsynced entries from memory. Requires @file's lock.
+   * */
+  void RefreshView(const std::string &path, FileLog &file, u64 now_ns) {
+    file.sources_ = LoadSources(path, file.gen_);
+    Source local;
+    local.container_ = container_id_;
+    local.log_ = LogPath(path, container_id_, file.gen_);
+    local.done_path_ = DonePath(path, container_id_, file.gen_);
+    local.done_ = ReadDone(local.done_path_);
+    local.entries_ = file.entries_;
+    local.local_ = true;
+    file.sources_.emplace_back(std::move(local));
+    std::vector<SourcedEntry> entries;
+    u64 seen = 0;
+    for (size_t i = 0; i < file.sources_.size(); ++i) {
+      const Source &source = file.sources_[i];
+      for (size_t j = source.done_; j < source.entries_.size(); ++j) {
+        entries.emplace_back(
+            SourcedEntry{source.entries_[j], i, source.container_, j});
+        seen = std::max(seen, source.entries_[j].stamp_ns_);
+      }
+    }
+    Observe(seen);
+    BuildView(entries, file.view_);
+    file.view_stamp_ns_ = now_ns;
+    file.view_stale_ = false;
+  }
+
+  /** A stamp for a write made now, later than any issued or seen */
+  u64 Tick() {
+    u64 wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    std::lock_guard<std::mutex> guard(lock_);
+    clock_ = std::max(clock_ + 1, wall);
+    return clock_;
+  }
+
+  /** Move the clock past @stamp, seen in another container's index */
+  void Observe(u64 stamp) {
+    std::lock_guard<std::mutex> guard(lock_);
+    clock_ = std::max(clock_, stamp);
+  }
+
+  /** Lay @entries over each other, oldest first, into @view */
+  static void BuildView(std::vector<SourcedEntry> &entries,
+                        std::map<size_t, Piece> &view) {
+    std::sort(entries.begin(), entries.end(),
+              [](const SourcedEntry &a, const SourcedEntry &b) {
+                if (a.entry_.stamp_ns_ != b.entry_.stamp_ns_) {
+                  return a.entry_.stamp_ns_ < b.entry_.stamp_ns_;
+                }
+                if (a.container_ != b.container_) {
+                  return a.container_ < b.container_;
+                }
+                return a.index_ < b.index_;
+              });
+    view.clear();
+    for (const SourcedEntry &sourced : entries) {
+      const LogEntry &entry = sourced.entry_;
+      size_t begin = entry.offset_;
+      size_t end = entry.offset_ + entry.size_;
+      if (begin == end) {
+        continue;
+      }
+      // Cut what the entry overwrites
+      auto it = view.upper_bound(begin);
+      if (it != view.begin() && std::prev(it)->second.end_ > begin) {
+        --it;
+      }
+      while (it != view.end() && it->first < end) {
+        size_t piece_begin = it->first;
+        Piece piece = it->second;
+        it = view.erase(it);
+        if (piece_begin < begin) {
+          Piece left = piece;
+          left.end_ = begin;
+          view.emplace(piece_begin, left);
+        }
+        if (piece.end_ > end) {
+          Piece right = piece;
+          right.log_pos_ += end - piece_begin;
+          view.emplace(end, right);
+          break;
+        }
+      }
+      view.emplace(begin, Piece{end, sourced.source_, entry.log_pos_});
+    }
+  }
+
+  /** Copy [@pos, @pos + @len) of @piece, which starts at @begin, to @out */
+  ssize_t ReadPiece(const std::string &path, FileLog &file, size_t begin,
+                    const Piece &piece, size_t pos, char *out, size_t len) {
+    const Source &source = file.sources_[piece.source_];
+    u64 log_pos = piece.log_pos_ + (pos - begin);
+    ssize_t ret;
+    if (source.local_ && tiers_ && tiers_->Enabled()) {
+      ret = tiers_->Read(source.log_, log_pos, out, len);
+    } else {
+      ret = PosixRead(source.log_, out, len, log_pos);
+    }
+    if (ret == kNoLog) {
+      // Removed after being compacted, so the file has the data
+      ret = PosixRead(path, out, len, pos);
+      ret = ret == kNoLog ? 0 : ret;
+    }
+    if (ret < 0) {
+      return -1;
+    }
+    memset(out + ret, 0, len - ret);
+    return len;
+  }
+
+  static void ReadIndex(const std::string &index,
+                        std::vector<LogEntry> &entries) {
+    struct stat st;
+    if (stat(index.c_str(), &st) < 0) {
+      return;
+    }
+    entries.resize(st.st_size / sizeof(LogEntry));
+    ssize_t ret = PosixRead(index, reinterpret_cast<char *>(entries.data()),
+                            entries.size() * sizeof(LogEntry), 0);
+    entries.resize(ret > 0 ? ret / sizeof(LogEntry) : 0);
+  }
+
+  /** Replace the index file @index with @entries */
+  static bool RewriteIndex(const std::string &index,
+                           const std::vector<LogEntry> &entries) {
+    std::string tmp = index + ".tmp";
+    unlink(tmp.c_str());
+    size_t size = entries.size() * sizeof(LogEntry);
+    if (PosixWrite(tmp, reinterpret_cast<const char *>(entries.data()), size,
+                   0) != static_cast<ssize_t>(size)) {
+      return false;
+    }
+    return rename(tmp.c_str(), index.c_str()) == 0;
+  }
+
+  /** Cut @entries off at @size */
+  static void ClipEntries(std::vector<LogEntry> &entries, size_t size) {
+    for (LogEntry &entry : entries) {
+      entry.size_ = entry.offset_ >= size
+                        ? 0
+                        : std::min<u64>(entry.size_, size - entry.offset_);
+    }
+  }
+
+  static u64 ReadDone(const std::string &done_path) {
+    u64 done = 0;
+    if (PosixRead(done_path, reinterpret_cast<char *>(&done), sizeof(done),
+                  0) != sizeof(done)) {
+      return 0;
+    }
+    return done;
+  }
+
+  static std::string LogDir(const std::string &path) {
+    return path + ".logs";
+  }
+
+  static std::string LogPath(const std::string &path, u32 container,
+                             u64 gen) {
+    return Name(path, container, gen, "log");
+  }
+
+  static std::string IndexPath(const std::string &path, u32 container,
+                               u64 gen) {
+    return Name(path, container, gen, "index");
+  }
+
+  static std::string DonePath(const std::string &path, u32 container,
+                              u64 gen) {
+    return Name(path, container, gen, "done");
+  }
+
+  static std::string Name(const std::string &path, u32 container, u64 gen,
+                          const char *kind) {
+    return LogDir(path) + "/" + std::to_string(container) + "." +
+           std::to_string(gen) + "." + kind;
+  }
+
+  /** A read of a log that does not exist */
+  CLS_CONST ssize_t kNoLog = -2;
+
+  static ssize_t PosixWrite(const std::string &path, const char *data,
+                            size_t size, size_t offset) {
+    int fd = open64(path.c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd < 0) {
+      return -1;
+    }
+    ssize_t ret = pwrite64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+
+  /** Returns kNoLog if @path does not exist */
+  static ssize_t PosixRead(const std::string &path, char *data, size_t size,
+                           size_t offset) {
+    int fd = open64(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return errno == ENOENT ? kNoLog : -1;
+    }
+    ssize_t ret = pread64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+
+  bool enabled_ = false;
+  u32 container_id_ = 0;
+  TierManager *tiers_ = nullptr;
+  std::mutex lock_;
+  std::unordered_map<std::string, std::shared_ptr<FileLog>> files_;
+  u64 clock_ = 0; /**< The last stamp issued or seen */
+  /** When each file asked to be compacted is due */
+  std::unordered_map<std::string, u64> compact_due_;
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_LOGS_H_
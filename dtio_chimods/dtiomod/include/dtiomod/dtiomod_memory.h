@@ -0,0 +1,413 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_MEMORY_H_
+#define CHI_dtiomod_MEMORY_H_
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtiomod_stats.h"
+
+namespace chi::dtiomod {
+
+/** I/O tasks name a file kept in memory by its path behind this prefix */
+static const char kMemoryScheme[] = "mem://";
+
+/** Whether @filename names a file kept in memory */
+static inline bool IsMemoryName(const std::string &filename) {
+  return filename.compare(0, sizeof(kMemoryScheme) - 1, kMemoryScheme) == 0;
+}
+
+/** The name I/O tasks use for @path when it is kept in memory */
+static inline std::string MemoryName(const std::string &path) {
+  return kMemoryScheme + path;
+}
+
+/** The path of the file a memory @filename names */
+static inline std::string MemoryPath(const std::string &filename) {
+  return filename.substr(sizeof(kMemoryScheme) - 1);
+}
+
+/**
+ * Keeps files entirely in memory on their home container, for intermediate
+ * data one stage of a workflow writes and the next reads and deletes. A
+ * file is the list of extents written to it, and only reaches the PFS if it
+ * is still alive when the runtime stops, or when memory runs short: then
+ * the least recently used files are persisted to their paths and dropped
+ * from memory, and I/O on them goes to the PFS from then on.
+ * */
+class MemoryStore {
+ public:
+  /** Files are persisted in the background past this share of capacity */
+  CLS_CONST double kHighWater = 0.75;
+
+ public:
+  MemoryStore() = default;
+  MemoryStore(const MemoryStore &) = delete;
+  MemoryStore &operator=(const MemoryStore &) = delete;
+
+  /** Hold up to @capacity bytes of files (0 disables the store) */
+  void Configure(size_t capacity) { capacity_ = capacity; }
+
+  bool Enabled() const { return capacity_ > 0; }
+
+  /** Whether files should be persisted to bring memory use down */
+  bool Pressured() const {
+    return Enabled() && used_.load() > capacity_ * kHighWater;
+  }
+
+  size_t Used() const { return used_.load(); }
+
+  /**
+   * Look up @path, creating it empty in memory if @create and it exists
+   * nowhere, or emptying it if @truncate and it is in memory. A file on the
+   * PFS stays there, and is described from its stat.
+   * */
+  MemoryInfo Open(const std::string &path, bool create, bool truncate,
+                  u32 mode) {
+    MemoryInfo info;
+    std::shared_ptr<MemFile> file = GetFile(path);
+    if (file) {
+      std::lock_guard<std::mutex> guard(file->lock_);
+      if (!file->gone_) {
+        if (truncate) {
+          Carve(*file, 0, SIZE_MAX);
+          file->size_ = 0;
+          file->mtime_ = time(nullptr);
+        }
+        Touch(*file);
+        Describe(*file, info);
+        return info;
+      }
+    }
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+      info.exists_ = true;
+      info.size_ = st.st_size;
+      info.mode_ = st.st_mode & 07777;
+      info.mtime_ = st.st_mtime;
+      return info;
+    }
+    if (!create || !Enabled()) {
+      return info;
+    }
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (!files_.count(path)) {
+        auto created = std::make_shared<MemFile>();
+        created->mode_ = mode;
+        created->mtime_ = time(nullptr);
+        Touch(*created);
+        files_.emplace(path, created);
+        info.created_ = true;
+      }
+    }
+    if (!info.created_) {
+      // Another open created it first
+      return Open(path, false, truncate, mode);
+    }
+    info.in_memory_ = true;
+    info.exists_ = true;
+    info.mode_ = mode;
+    info.mtime_ = time(nullptr);
+    return info;
+  }
+
+  /**
+   * Write @size bytes of @data at @offset of @path into memory, with the
+   * result in @ret. Returns false if @path is not in memory, so the write
+   * goes to the PFS. When memory is short the coldest other files are
+   * persisted to make room, or this one if none is left.
+   * */
+  bool Write(const std::string &path, size_t offset, const char *data,
+             size_t size, ssize_t &ret) {
+    std::shared_ptr<MemFile> file = GetFile(path);
+    if (!file) {
+      return false;
+    }
+    while (!Reserve(size)) {
+      std::string victim;
+      if (!Coldest(path, victim) || !Persist(victim)) {
+        if (Persist(path)) {
+          return false;
+        }
+        ret = -1;
+        return true;
+      }
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    if (file->gone_) {
+      Release(size);
+      return false;
+    }
+    auto mem = std::make_shared<std::vector<char>>(data, data + size);
+    Insert(*file, offset, Extent{offset + size, mem, 0});
+    file->size_ = std::max(file->size_, offset + size);
+    file->mtime_ = time(nullptr);
+    Touch(*file);
+    ret = size;
+    return true;
+  }
+
+  /**
+   * Read @size bytes at @offset of @path from memory into @data, with the
+   * bytes up to the end of the file in @ret. Holes read as zeros. Returns
+   * false if @path is not in memory.
+   * */
+  bool Read(const std::string &path, size_t offset, char *data, size_t size,
+            ssize_t &ret) {
+    std::shared_ptr<MemFile> file = GetFile(path);
+    if (!file) {
+      return false;
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    if (file->gone_) {
+      return false;
+    }
+    Touch(*file);
+    if (offset >= file->size_) {
+      ret = 0;
+      return true;
+    }
+    size_t end = std::min(offset + size, file->size_);
+    memset(data, 0, end - offset);
+    auto it = file->extents_.upper_bound(offset);
+    if (it != file->extents_.begin() && std::prev(it)->second.end_ > offset) {
+      --it;
+    }
+    for (; it != file->extents_.end() && it->first < end; ++it) {
+      size_t begin = std::max(it->first, offset);
+      size_t len = std::min(it->second.end_, end) - begin;
+      memcpy(data + (begin - offset),
+             it->second.mem_->data() + it->second.mem_off_ +
+                 (begin - it->first),
+             len);
+    }
+    ret = end - offset;
+    return true;
+  }
+
+  /**
+   * Drop @path from memory without persisting it, as it was deleted.
+   * Returns false if it was not in memory.
+   * */
+  bool Discard(const std::string &path) {
+    std::shared_ptr<MemFile> file;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      auto it = files_.find(path);
+      if (it == files_.end()) {
+        return false;
+      }
+      file = it->second;
+      files_.erase(it);
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    if (file->gone_) {
+      // It was persisted as it was deleted, so it is on the PFS
+      return false;
+    }
+    Carve(*file, 0, SIZE_MAX);
+    file->gone_ = true;
+    return true;
+  }
+
+  /**
+   * Write @path out to the PFS and drop it from memory. Returns false if
+   * the PFS failed, which leaves it in memory.
+   * */
+  bool Persist(const std::string &path) {
+    std::shared_ptr<MemFile> file = GetFile(path);
+    if (!file) {
+      return true;
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    if (file->gone_) {
+      return true;
+    }
+    int fd = open64(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                    file->mode_ ? file->mode_ : 0664);
+    if (fd < 0) {
+      return false;
+    }
+    bool ok = true;
+    for (auto &entry : file->extents_) {
+      const Extent &ext = entry.second;
+      size_t len = ext.end_ - entry.first;
+      ok = ok && pwrite64(fd, ext.mem_->data() + ext.mem_off_, len,
+                          entry.first) == static_cast<ssize_t>(len);
+    }
+    ok = ok && ftruncate64(fd, file->size_) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok) {
+      return false;
+    }
+    persisted_ += file->size_;
+    Carve(*file, 0, SIZE_MAX);
+    file->gone_ = true;
+    std::lock_guard<std::mutex> files_guard(lock_);
+    auto it = files_.find(path);
+    if (it != files_.end() && it->second == file) {
+      files_.erase(it);
+    }
+    return true;
+  }
+
+  /**
+   * Persist the least recently used files until memory use is back under
+   * the high water mark. Returns the number of files persisted.
+   * */
+  size_t Relieve() {
+    size_t count = 0;
+    std::string victim;
+    while (Pressured() && Coldest(std::string(), victim) && Persist(victim)) {
+      ++count;
+    }
+    return count;
+  }
+
+  /** Persist every file still in memory, as the runtime stops */
+  void PersistAll() {
+    std::vector<std::string> paths;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      for (auto &entry : files_) {
+        paths.emplace_back(entry.first);
+      }
+    }
+    for (const std::string &path : paths) {
+      Persist(path);
+    }
+  }
+
+  /** Bytes of files written out to the PFS so far */
+  u64 Persisted() const { return persisted_.load(); }
+
+ private:
+  /** A byte range [off, end_) of a file, keyed by its offset */
+  struct Extent {
+    size_t end_;
+    std::shared_ptr<std::vector<char>> mem_;
+    size_t mem_off_; /**< Where the range starts in mem_ */
+  };
+
+  struct MemFile {
+    std::mutex lock_;
+    std::map<size_t, Extent> extents_;
+    size_t size_ = 0;
+    u32 mode_ = 0;
+    u64 mtime_ = 0;
+    std::atomic<u64> stamp_{0}; /**< When it was last used */
+    bool gone_ = false;         /**< It was persisted or discarded */
+  };
+
+  std::shared_ptr<MemFile> GetFile(const std::string &path) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = files_.find(path);
+    return it == files_.end() ? nullptr : it->second;
+  }
+
+  void Touch(MemFile &file) { file.stamp_ = ++clock_; }
+
+  static void Describe(const MemFile &file, MemoryInfo &info) {
+    info.in_memory_ = true;
+    info.exists_ = true;
+    info.size_ = file.size_;
+    info.mode_ = file.mode_;
+    info.mtime_ = file.mtime_;
+  }
+
+  /** The least recently used file other than @except */
+  bool Coldest(const std::string &except, std::string &victim) {
+    std::lock_guard<std::mutex> guard(lock_);
+    u64 oldest = UINT64_MAX;
+    for (auto &entry : files_) {
+      u64 stamp = entry.second->stamp_.load();
+      if (entry.first != except && stamp < oldest) {
+        oldest = stamp;
+        victim = entry.first;
+      }
+    }
+    return oldest != UINT64_MAX;
+  }
+
+  /** Claim @size bytes, if there is room */
+  bool Reserve(size_t size) {
+    size_t cur = used_.load();
+    do {
+      if (cur + size > capacity_) {
+        return false;
+      }
+    } while (!used_.compare_exchange_weak(cur, cur + size));
+    return true;
+  }
+
+  void Release(size_t size) { used_ -= size; }
+
+  /** Drop the parts of @file's extents within [@begin, @end) */
+  void Carve(MemFile &file, size_t begin, size_t end) {
+    auto it = file.extents_.upper_bound(begin);
+    if (it != file.extents_.begin() && std::prev(it)->second.end_ > begin) {
+      --it;
+    }
+    while (it != file.extents_.end() && it->first < end) {
+      size_t ext_begin = it->first;
+      Extent ext = it->second;
+      it = file.extents_.erase(it);
+      Release(std::min(ext.end_, end) - std::max(ext_begin, begin));
+      if (ext_begin < begin) {
+        Extent left = ext;
+        left.end_ = begin;
+        file.extents_.emplace(ext_begin, left);
+      }
+      if (ext.end_ > end) {
+        Extent right = ext;
+        right.mem_off_ += end - ext_begin;
+        it = file.extents_.emplace(end, right).first;
+        break;
+      }
+    }
+  }
+
+  /** Record @ext at @begin, replacing what it overwrites */
+  void Insert(MemFile &file, size_t begin, const Extent &ext) {
+    Carve(file, begin, ext.end_);
+    file.extents_.emplace(begin, ext);
+  }
+
+  size_t capacity_ = 0;
+  std::atomic<size_t> used_{0};
+  std::atomic<u64> clock_{0};
+  std::atomic<u64> persisted_{0};
+  std::mutex lock_;
+  std::unordered_map<std::string, std::shared_ptr<MemFile>> files_;
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_MEMORY_H_
@@ -9,7 +9,26 @@ struct Method : public TaskMethod {
   TASK_METHOD_T kMetaPut = 13;
   TASK_METHOD_T kMetaGet = 14;
   TASK_METHOD_T kSchedule = 15;
-  TASK_METHOD_T kCount = 16;
+  TASK_METHOD_T kWriteV = 16;
+  TASK_METHOD_T kReadV = 17;
+  TASK_METHOD_T kCollectStats = 18;
+  TASK_METHOD_T kPublishStats = 19;
+  TASK_METHOD_T kQosStats = 20;
+  TASK_METHOD_T kLaneStats = 21;
+  TASK_METHOD_T kInflight = 22;
+  TASK_METHOD_T kStaging = 23;
+  TASK_METHOD_T kFlush = 24;
+  TASK_METHOD_T kCompact = 25;
+  TASK_METHOD_T kPackGet = 26;
+  TASK_METHOD_T kPackPut = 27;
+  TASK_METHOD_T kPackRemove = 28;
+  TASK_METHOD_T kMemOpen = 29;
+  TASK_METHOD_T kDiscard = 30;
+  TASK_METHOD_T kCopy = 31;
+  TASK_METHOD_T kTierStats = 32;
+  TASK_METHOD_T kRecordExtents = 33;
+  TASK_METHOD_T kTruncate = 34;
+  TASK_METHOD_T kCount = 35;
 };
 
 #endif  // CHI_DTIOMOD_METHODS_H_
@@ -0,0 +1,451 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef CHI_dtiomod_PACKS_H_
+#define CHI_dtiomod_PACKS_H_
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtiomod_stats.h"
+
+namespace chi::dtiomod {
+
+/** Where a packed file's bytes are, as recorded in the pack index */
+struct PackEntry {
+  u32 pack_;   /**< Which of this container's packs holds the file */
+  u64 offset_; /**< Where the file starts in the pack */
+  u64 size_;
+  u32 mode_;
+  u64 mtime_; /**< Seconds since the epoch */
+};
+
+/**
+ * Stores small files whole in large shared pack files, so a file costs an
+ * index entry instead of a create and an inode on the PFS. A file is
+ * packed by the container its name hashes to, which appends its bytes to
+ * its current pack and records name -> (pack, offset, length) in its
+ * index. Packing a file again appends a new copy, and the old copy becomes
+ * dead space in its pack.
+ *
+ * Dead space is reclaimed by Compact. Once a full pack is more than
+ * kMaxDead dead, the files still in it are copied to the current pack, and
+ * the pack is deleted when none are left. Readers hold the pack they read
+ * open, so a pack deleted under a read is still read whole.
+ *
+ * Packs are "<dir>/<container>.<pack>.pack". The index is held in memory
+ * and logged to "<dir>/<container>.index", which is replayed and rewritten
+ * with only the live entries when the container starts. Packs left with no
+ * live entries are deleted then.
+ * */
+class PackStore {
+ public:
+  /** A pack takes no new files once it holds this many bytes */
+  CLS_CONST size_t kPackSize = GIGABYTES(1);
+  /** The pack of an index record that removes a file */
+  CLS_CONST u32 kRemoved = UINT32_MAX;
+  /** A full pack is compacted once more than this share of it is dead */
+  CLS_CONST double kMaxDead = 0.5;
+
+ public:
+  PackStore() = default;
+  PackStore(const PackStore &) = delete;
+  PackStore &operator=(const PackStore &) = delete;
+
+  ~PackStore() {
+    if (index_fd_ >= 0) {
+      close(index_fd_);
+    }
+  }
+
+  /** Keep packs in @dir (empty disables packing) */
+  void Configure(const std::string &dir, u32 container_id) {
+    dir_ = dir;
+    container_id_ = container_id;
+    if (!Enabled()) {
+      return;
+    }
+    mkdir(dir_.c_str(), 0775);
+    Replay();
+    RewriteIndex();
+
+    // Resume appending to the newest pack, and drop the dead ones
+    for (const auto &it : index_) {
+      cur_ = std::max(cur_, it.second.pack_);
+      use_[it.second.pack_].live_ += it.second.size_;
+    }
+    for (auto &it : use_) {
+      struct stat st;
+      if (stat(PackPath(it.first).c_str(), &st) == 0) {
+        it.second.end_ = st.st_size;
+      }
+    }
+    cur_end_ = use_[cur_].end_;
+    RemoveStrayPacks();
+  }
+
+  bool Enabled() const { return !dir_.empty(); }
+
+  /**
+   * Look up @path in the index, and copy up to @size bytes of it into
+   * @data. Returns the bytes copied, or -1 if the pack could not be read.
+   * */
+  ssize_t Get(const std::string &path, char *data, size_t size,
+              PackInfo &info) {
+    PackEntry entry;
+    std::shared_ptr<PackFile> pack;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      auto it = index_.find(path);
+      if (it == index_.end()) {
+        info = PackInfo();
+        return 0;
+      }
+      entry = it->second;
+      pack = PackFd(entry.pack_);
+    }
+    info.found_ = true;
+    info.size_ = entry.size_;
+    info.mode_ = entry.mode_;
+    info.mtime_ = entry.mtime_;
+    size_t len = std::min<size_t>(size, entry.size_);
+    if (len == 0) {
+      return 0;
+    }
+    if (!pack || pread(pack->fd_, data, len, entry.offset_) !=
+                     static_cast<ssize_t>(len)) {
+      return -1;
+    }
+    return len;
+  }
+
+  /**
+   * Pack @size bytes of @data as the whole of @path, replacing any earlier
+   * copy. Returns the bytes packed, or -1.
+   * */
+  ssize_t Put(const std::string &path, const char *data, size_t size,
+              u32 mode) {
+    PackEntry entry{0, 0, size, mode, static_cast<u64>(time(nullptr))};
+    std::shared_ptr<PackFile> pack;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      Allocate(entry);
+      pack = PackFd(entry.pack_);
+    }
+    bool ok = pack && (!size || pwrite(pack->fd_, data, size, entry.offset_) ==
+                                    static_cast<ssize_t>(size));
+    std::lock_guard<std::mutex> guard(lock_);
+    use_[entry.pack_].writing_ -= 1;
+    if (!ok || !LogRecord(path, entry)) {
+      return -1;
+    }
+    Replace(path, entry);
+    return size;
+  }
+
+  /** Drop @path from the index. Returns false if it was not packed. */
+  bool Remove(const std::string &path) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = index_.find(path);
+    if (it == index_.end()) {
+      return false;
+    }
+    LogRecord(path, PackEntry{kRemoved, 0, 0, 0, 0});
+    use_[it->second.pack_].live_ -= it->second.size_;
+    index_.erase(it);
+    return true;
+  }
+
+  /**
+   * Copy about @budget bytes of files out of the full pack with the most
+   * dead space, if it is more than kMaxDead dead, and delete the pack once
+   * it holds no files. Returns the bytes copied.
+   * */
+  size_t Compact(size_t budget) {
+    u32 victim;
+    std::vector<std::pair<std::string, PackEntry>> files;
+    std::shared_ptr<PackFile> src;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (!PickVictim(victim)) {
+        return 0;
+      }
+      for (const auto &it : index_) {
+        if (it.second.pack_ == victim) {
+          files.emplace_back(it);
+        }
+      }
+      src = PackFd(victim);
+    }
+    size_t moved = 0;
+    for (const auto &file : files) {
+      if (moved >= budget || !src) {
+        break;
+      }
+      const PackEntry &old = file.second;
+      std::vector<char> buf(old.size_);
+      if (pread(src->fd_, buf.data(), buf.size(), old.offset_) !=
+          static_cast<ssize_t>(buf.size())) {
+        break;
+      }
+      PackEntry entry = old;
+      std::shared_ptr<PackFile> dst;
+      {
+        std::lock_guard<std::mutex> guard(lock_);
+        Allocate(entry);
+        dst = PackFd(entry.pack_);
+      }
+      bool ok = dst && (buf.empty() ||
+                        pwrite(dst->fd_, buf.data(), buf.size(),
+                               entry.offset_) ==
+                            static_cast<ssize_t>(buf.size()));
+      std::lock_guard<std::mutex> guard(lock_);
+      use_[entry.pack_].writing_ -= 1;
+      if (!ok) {
+        break;
+      }
+      auto it = index_.find(file.first);
+      if (it == index_.end() || it->second.pack_ != old.pack_ ||
+          it->second.offset_ != old.offset_) {
+        continue;  // Packed again or removed since, so the copy is dead
+      }
+      if (!LogRecord(file.first, entry)) {
+        break;
+      }
+      Replace(file.first, entry);
+      moved += old.size_;
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    RemoveDeadPacks();
+    return moved;
+  }
+
+ private:
+  /** An open pack. Closed once no reader or writer holds it. */
+  struct PackFile {
+    int fd_;
+    explicit PackFile(int fd) : fd_(fd) {}
+    ~PackFile() { close(fd_); }
+  };
+
+  /** How much of a pack is in use */
+  struct PackUse {
+    u64 live_ = 0; /**< Bytes of the files the index points into it */
+    u64 end_ = 0;  /**< Bytes appended to it */
+    u32 writing_ = 0; /**< Copies still being written into it */
+  };
+
+  /** An index record as logged: the entry, then the name's bytes */
+  struct IndexRecord {
+    u32 name_len_;
+    PackEntry entry_;
+  };
+
+  std::string PackPath(u32 pack) const {
+    return dir_ + "/" + std::to_string(container_id_) + "." +
+           std::to_string(pack) + ".pack";
+  }
+
+  std::string IndexPath() const {
+    return dir_ + "/" + std::to_string(container_id_) + ".index";
+  }
+
+  /** The open @pack, or null. The caller holds lock_. */
+  std::shared_ptr<PackFile> PackFd(u32 pack) {
+    auto it = pack_fds_.find(pack);
+    if (it != pack_fds_.end()) {
+      return it->second;
+    }
+    int fd = open(PackPath(pack).c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd < 0) {
+      return nullptr;
+    }
+    auto file = std::make_shared<PackFile>(fd);
+    pack_fds_.emplace(pack, file);
+    return file;
+  }
+
+  /**
+   * Place @entry's bytes at the end of the current pack, starting a new one
+   * if it is full. The pack is kept until the caller drops its write
+   * count. The caller holds lock_.
+   * */
+  void Allocate(PackEntry &entry) {
+    if (cur_end_ && cur_end_ + entry.size_ > kPackSize) {
+      cur_ += 1;
+      cur_end_ = 0;
+    }
+    entry.pack_ = cur_;
+    entry.offset_ = cur_end_;
+    cur_end_ += entry.size_;
+    use_[cur_].end_ = cur_end_;
+    use_[cur_].writing_ += 1;
+  }
+
+  /** Point @path at @entry, its old copy going dead. Requires lock_. */
+  void Replace(const std::string &path, const PackEntry &entry) {
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+      use_[it->second.pack_].live_ -= it->second.size_;
+    }
+    index_[path] = entry;
+    use_[entry.pack_].live_ += entry.size_;
+  }
+
+  /**
+   * The full pack with the most dead space, if it is more than kMaxDead
+   * dead. The caller holds lock_.
+   * */
+  bool PickVictim(u32 &victim) const {
+    bool found = false;
+    u64 most = 0;
+    for (const auto &it : use_) {
+      const PackUse &use = it.second;
+      u64 dead = use.end_ > use.live_ ? use.end_ - use.live_ : 0;
+      if (it.first == cur_ || use.writing_ ||
+          (use.live_ && dead <= kMaxDead * use.end_)) {
+        continue;
+      }
+      if (!found || dead > most) {
+        found = true;
+        most = dead;
+        victim = it.first;
+      }
+    }
+    return found;
+  }
+
+  /** Delete the packs other than the current one that hold no files */
+  void RemoveDeadPacks() {
+    for (auto it = use_.begin(); it != use_.end();) {
+      if (it->first != cur_ && it->second.live_ == 0 &&
+          it->second.writing_ == 0) {
+        pack_fds_.erase(it->first);
+        unlink(PackPath(it->first).c_str());
+        it = use_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  /** Delete this container's packs that no index entry points into */
+  void RemoveStrayPacks() {
+    DIR *dp = opendir(dir_.c_str());
+    if (!dp) {
+      return;
+    }
+    while (struct dirent *ent = readdir(dp)) {
+      unsigned container, pack;
+      char kind[8];
+      if (sscanf(ent->d_name, "%u.%u.%7s", &container, &pack, kind) == 3 &&
+          container == container_id_ && strcmp(kind, "pack") == 0 &&
+          pack != cur_ && !use_.count(pack)) {
+        unlink(PackPath(pack).c_str());
+      }
+    }
+    closedir(dp);
+  }
+
+  /** Append a record to the index file. The caller holds lock_. */
+  bool LogRecord(const std::string &path, const PackEntry &entry) {
+    std::vector<char> buf;
+    AppendRecord(buf, path, entry);
+    return index_fd_ >= 0 && write(index_fd_, buf.data(), buf.size()) ==
+                                 static_cast<ssize_t>(buf.size());
+  }
+
+  static void AppendRecord(std::vector<char> &buf, const std::string &path,
+                           const PackEntry &entry) {
+    IndexRecord rec{static_cast<u32>(path.size()), entry};
+    const char *bytes = reinterpret_cast<const char *>(&rec);
+    buf.insert(buf.end(), bytes, bytes + sizeof(rec));
+    buf.insert(buf.end(), path.begin(), path.end());
+  }
+
+  /** Rebuild the index from its file. A torn last record is dropped. */
+  void Replay() {
+    int fd = open(IndexPath().c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    std::vector<char> buf;
+    char chunk[65536];
+    ssize_t ret;
+    while ((ret = read(fd, chunk, sizeof(chunk))) > 0) {
+      buf.insert(buf.end(), chunk, chunk + ret);
+    }
+    close(fd);
+    for (size_t pos = 0; pos + sizeof(IndexRecord) <= buf.size();) {
+      IndexRecord rec;
+      memcpy(&rec, buf.data() + pos, sizeof(rec));
+      pos += sizeof(rec);
+      if (pos + rec.name_len_ > buf.size()) {
+        break;
+      }
+      std::string path(buf.data() + pos, rec.name_len_);
+      pos += rec.name_len_;
+      if (rec.entry_.pack_ == kRemoved) {
+        index_.erase(path);
+      } else {
+        index_[path] = rec.entry_;
+      }
+    }
+  }
+
+  /** Replace the index file with the live entries, and open it to log */
+  void RewriteIndex() {
+    std::vector<char> buf;
+    for (const auto &it : index_) {
+      AppendRecord(buf, it.first, it.second);
+    }
+    std::string tmp = IndexPath() + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (fd >= 0) {
+      bool done = write(fd, buf.data(), buf.size()) ==
+                  static_cast<ssize_t>(buf.size());
+      close(fd);
+      if (done) {
+        rename(tmp.c_str(), IndexPath().c_str());
+      }
+    }
+    index_fd_ = open(IndexPath().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0664);
+  }
+
+ private:
+  std::string dir_;
+  u32 container_id_ = 0;
+  std::mutex lock_;
+  std::unordered_map<std::string, PackEntry> index_;
+  std::unordered_map<u32, std::shared_ptr<PackFile>> pack_fds_;
+  std::unordered_map<u32, PackUse> use_;
+  int index_fd_ = -1;
+  u32 cur_ = 0;      /**< The pack new files are appended to */
+  u64 cur_end_ = 0;  /**< Bytes in the current pack */
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_PACKS_H_
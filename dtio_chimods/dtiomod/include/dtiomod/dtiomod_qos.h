@@ -0,0 +1,421 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_QOS_H_
+#define CHI_dtiomod_QOS_H_
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtiomod_stats.h"
+
+namespace chi::dtiomod {
+
+/** An I/O class shared by the clients configured to use it */
+struct QosClass {
+  std::string name_ = "default";
+  u32 weight_ = 1;           /**< Share of the device relative to others */
+  size_t bytes_per_sec_ = 0; /**< Rate limit on bytes (0 is unlimited) */
+  size_t ops_per_sec_ = 0;   /**< Rate limit on I/O tasks (0 is unlimited) */
+
+  template <typename Ar>
+  void serialize(Ar &ar) {
+    ar(name_, weight_, bytes_per_sec_, ops_per_sec_);
+  }
+};
+
+/** Per-task scheduling and placement options, set by the issuing client */
+struct IoOpts {
+  u64 client_ = 0;      /**< Job or process the task belongs to */
+  u32 class_ = 0;       /**< Index of the client's QosClass */
+  u32 deadline_us_ = 0; /**< Time allowed from queueing to start (0 is none) */
+  u32 tier_ = 0; /**< Fastest tier written data may be held on (LocationType) */
+  bool cacheable_ = true; /**< Whether read-hot blocks may be copied up */
+
+  /** These options with a deadline of @deadline_us */
+  HSHM_INLINE_CROSS_FUN IoOpts WithDeadline(u32 deadline_us) const {
+    IoOpts opts = *this;
+    opts.deadline_us_ = deadline_us;
+    return opts;
+  }
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(client_, class_, deadline_us_, tier_, cacheable_);
+  }
+};
+
+/** What the QoS gate needs to know about an I/O task */
+struct IoDesc {
+  IoOpts opts_;
+  size_t size_ = 0;
+  u64 file_ = 0; /**< Hash of the file the task touches */
+  size_t offset_ = 0;
+};
+
+/** What one QosClass has been served on a container */
+struct QosClassStats {
+  u32 class_ = 0;
+  u64 ops_ = 0;         /**< I/O tasks dispatched */
+  u64 bytes_ = 0;       /**< Bytes carried by those tasks */
+  u64 throttled_ = 0;   /**< Tasks held back by the rate limits */
+  u64 waiting_ = 0;     /**< Tasks currently held at the gate */
+  u64 wait_ns_ = 0;     /**< Total time tasks spent at the gate */
+  u64 max_wait_ns_ = 0; /**< Longest time a task spent at the gate */
+  u64 missed_ = 0;      /**< Tasks that started after their deadline */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(class_, ops_, bytes_, throttled_, waiting_, wait_ns_, max_wait_ns_,
+       missed_);
+  }
+};
+
+/**
+ * A token bucket. Tokens accrue at @rate per second up to a burst of
+ * kBurstMs worth. A task may start once the bucket is not in debt, and then
+ * takes its full cost, so tasks larger than the burst are not starved.
+ * */
+class TokenBucket {
+ public:
+  CLS_CONST u64 kBurstMs = 100;
+
+  void Configure(size_t rate) {
+    rate_ = rate;
+    burst_ = std::max<double>(rate * kBurstMs / 1000.0, 1);
+    tokens_ = burst_;
+    last_ns_ = 0;
+  }
+
+  /** Whether a task may start at @now_ns */
+  bool Ready(u64 now_ns) {
+    if (rate_ == 0) {
+      return true;
+    }
+    if (last_ns_) {
+      tokens_ += rate_ * ((now_ns - last_ns_) / 1e9);
+      tokens_ = std::min(tokens_, burst_);
+    }
+    last_ns_ = now_ns;
+    return tokens_ >= 0;
+  }
+
+  void Take(double cost) {
+    if (rate_) {
+      tokens_ -= cost;
+    }
+  }
+
+ private:
+  size_t rate_ = 0;
+  double burst_ = 1;
+  double tokens_ = 1;
+  u64 last_ns_ = 0;
+};
+
+/**
+ * Orders I/O tasks across clients with self-clocked weighted fair queueing,
+ * and holds back classes that exceed their rate limits. A task is tagged as
+ * it is queued with a virtual finish time: its client's previous tag (or
+ * the current virtual time, if later) plus its cost over its class weight.
+ *
+ * Tasks also carry a deadline: the one their client set, or kMaxAgeNs after
+ * queueing if it set none. Tasks within kUrgentNs of their deadline are
+ * urgent and go first, earliest deadline first. So a tight deadline jumps
+ * the queue right away, while loose deadlines and aging only stop a task
+ * from being starved by the fair share.
+ *
+ * When a task reaches the gate, it may start once no urgent task and no
+ * task with a smaller tag is waiting in an unthrottled class. Tasks that
+ * may not start yield and retry. A task is only held for one that has not
+ * reached the gate yet for kMaxHoldNs, so the gate never depends on the
+ * order the worker polls in.
+ *
+ * With an elevator window of N, the first N queued tasks of each file are
+ * also kept sorted by offset. When the fair share picks a task, the gate
+ * instead starts the task of the same file at or after where the file's
+ * last task ended, wrapping around at the end (C-SCAN). Strided writes
+ * from many ranks thus reach the file as ascending sweeps. Urgent tasks
+ * skip the elevator, so a task it keeps passing over still ages out.
+ * */
+class QosGate {
+ public:
+  /** Tasks smaller than this are charged as if they were this large */
+  CLS_CONST size_t kMinCost = KILOBYTES(4);
+  /** Client tags are pruned once this many are remembered */
+  CLS_CONST size_t kMaxClients = 4096;
+  /** How long a task waits on one that is queued but not yet at the gate */
+  CLS_CONST u64 kMaxHoldNs = 200000;
+  /** Tasks this close to their deadline are dispatched by deadline */
+  CLS_CONST u64 kUrgentNs = 1000000;
+  /** The deadline of tasks queued without one */
+  CLS_CONST u64 kMaxAgeNs = 500000000;
+
+ public:
+  void Configure(const std::vector<QosClass> &classes, u32 elevator_window) {
+    std::lock_guard<std::mutex> guard(lock_);
+    elevator_window_ = elevator_window;
+    max_window_ = elevator_window;
+    classes_.clear();
+    classes_.resize(std::max<size_t>(classes.size(), 1));
+    for (size_t i = 0; i < classes.size(); ++i) {
+      classes_[i].weight_ = std::max<u32>(classes[i].weight_, 1);
+      classes_[i].bytes_.Configure(classes[i].bytes_per_sec_);
+      classes_[i].ops_.Configure(classes[i].ops_per_sec_);
+    }
+    for (size_t i = 0; i < classes_.size(); ++i) {
+      classes_[i].stats_.class_ = i;
+    }
+  }
+
+  /**
+   * Hold up to @window tasks per file in the elevator, at least one and at
+   * most the configured window. A shrunk window drains as tasks dispatch.
+   * */
+  void SetElevatorWindow(u32 window) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (max_window_) {
+      elevator_window_ = std::clamp<u32>(window, 1, max_window_);
+    }
+  }
+
+  /** Tag @task, described by @io, as it is queued */
+  void Enqueue(const Task *task, const IoDesc &io) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (waiting_.find(task) == waiting_.end()) {
+      Enqueue(task, io, WorkerStatsTable::NowNs());
+    }
+  }
+
+  /**
+   * Whether @task may start now. Tasks that were never enqueued are enqueued
+   * by their first call. Once this returns true the task has left the gate.
+   * */
+  bool TryDispatch(const Task *task, const IoDesc &io) {
+    std::lock_guard<std::mutex> guard(lock_);
+    u64 now_ns = WorkerStatsTable::NowNs();
+    auto it = waiting_.find(task);
+    if (it == waiting_.end()) {
+      it = Enqueue(task, io, now_ns);
+    }
+    Waiting &waiting = it->second;
+    if (!waiting.arrive_ns_) {
+      waiting.arrive_ns_ = now_ns;
+    }
+
+    // Find the most urgent task in an unthrottled class, or else the one
+    // with the smallest tag
+    std::vector<char> ready(classes_.size(), -1);
+    auto class_ready = [&](u32 class_id) {
+      if (ready[class_id] < 0) {
+        ClassState &cls = classes_[class_id];
+        ready[class_id] = cls.bytes_.Ready(now_ns) && cls.ops_.Ready(now_ns);
+      }
+      return ready[class_id] > 0;
+    };
+    const Waiting *next = nullptr;
+    for (const auto &entry : deadlines_) {
+      if (entry.first > now_ns + kUrgentNs) {
+        break;
+      }
+      Waiting &other = waiting_[entry.second];
+      if (class_ready(other.class_)) {
+        next = &other;
+        break;
+      }
+      other.throttled_ = true;
+    }
+    if (!next) {
+      for (const auto &entry : order_) {
+        Waiting &other = waiting_[entry.second];
+        if (class_ready(other.class_)) {
+          next = Sweep(other, class_ready);
+          break;
+        }
+        other.throttled_ = true;
+      }
+    }
+    if (next != &waiting) {
+      // Only overtake a task that has not reached the gate in time
+      if (!next || next->arrive_ns_ || !class_ready(waiting.class_) ||
+          now_ns - waiting.arrive_ns_ < kMaxHoldNs) {
+        return false;
+      }
+    }
+
+    // Dispatch
+    ClassState &cls = classes_[waiting.class_];
+    cls.bytes_.Take(waiting.size_);
+    cls.ops_.Take(1);
+    vtime_ = std::max(vtime_, waiting.finish_);
+    u64 wait_ns = now_ns - waiting.enqueue_ns_;
+    QosClassStats &stats = cls.stats_;
+    stats.ops_ += 1;
+    stats.bytes_ += waiting.size_;
+    stats.throttled_ += waiting.throttled_;
+    stats.waiting_ -= 1;
+    stats.wait_ns_ += wait_ns;
+    stats.max_wait_ns_ = std::max(stats.max_wait_ns_, wait_ns);
+    stats.missed_ += now_ns > waiting.deadline_ns_;
+    order_.erase({waiting.finish_, task});
+    deadlines_.erase({waiting.deadline_ns_, task});
+    if (elevator_window_) {
+      Unsweep(task, waiting);
+    }
+    waiting_.erase(it);
+    return true;
+  }
+
+  /** What each class has been served so far */
+  std::vector<QosClassStats> Stats() {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::vector<QosClassStats> stats;
+    stats.reserve(classes_.size());
+    for (const ClassState &cls : classes_) {
+      stats.emplace_back(cls.stats_);
+    }
+    return stats;
+  }
+
+ private:
+  struct ClassState {
+    u32 weight_ = 1;
+    TokenBucket bytes_;
+    TokenBucket ops_;
+    QosClassStats stats_;
+  };
+
+  struct Waiting {
+    double finish_;
+    u32 class_;
+    size_t size_;
+    u64 enqueue_ns_;
+    u64 deadline_ns_;
+    u64 arrive_ns_; /**< When it reached the gate, or 0 */
+    bool throttled_;
+    u64 file_;
+    size_t offset_;
+    u64 seq_; /**< Queueing order */
+  };
+
+  /** The queued tasks of one file, for the elevator */
+  struct FileQueue {
+    std::set<std::pair<size_t, const Task *>> window_; /**< By offset */
+    std::set<std::pair<u64, const Task *>> overflow_;  /**< By arrival */
+    size_t head_ = 0; /**< Where the last dispatched task ended */
+  };
+
+  typedef std::unordered_map<const Task *, Waiting>::iterator WaitingIter;
+
+  /**
+   * The task the elevator starts in place of @picked: the next one by offset
+   * in its file's window, if its class is not throttled.
+   * */
+  template <typename ReadyT>
+  const Waiting *Sweep(const Waiting &picked, ReadyT &class_ready) {
+    if (!elevator_window_) {
+      return &picked;
+    }
+    FileQueue &queue = files_[picked.file_];
+    auto it = queue.window_.lower_bound({queue.head_, nullptr});
+    if (it == queue.window_.end()) {
+      it = queue.window_.begin();
+    }
+    if (it == queue.window_.end()) {
+      return &picked;
+    }
+    const Waiting &next = waiting_[it->second];
+    return class_ready(next.class_) ? &next : &picked;
+  }
+
+  /** Remove a dispatched task from its file's elevator */
+  void Unsweep(const Task *task, const Waiting &waiting) {
+    auto file = files_.find(waiting.file_);
+    if (file == files_.end()) {
+      return;
+    }
+    FileQueue &queue = file->second;
+    queue.head_ = waiting.offset_ + waiting.size_;
+    if (queue.window_.erase({waiting.offset_, task})) {
+      if (!queue.overflow_.empty() &&
+          queue.window_.size() < elevator_window_) {
+        const Task *promoted = queue.overflow_.begin()->second;
+        queue.window_.emplace(waiting_[promoted].offset_, promoted);
+        queue.overflow_.erase(queue.overflow_.begin());
+      }
+    } else {
+      queue.overflow_.erase({waiting.seq_, task});
+    }
+    if (queue.window_.empty()) {
+      files_.erase(file);
+    }
+  }
+
+  /** Tag @task and add it to the tasks waiting at the gate */
+  WaitingIter Enqueue(const Task *task, const IoDesc &io, u64 now_ns) {
+    const IoOpts &opts = io.opts_;
+    size_t size = io.size_;
+    u32 class_id = opts.class_ < classes_.size() ? opts.class_ : 0;
+    ClassState &cls = classes_[class_id];
+    if (client_finish_.size() >= kMaxClients) {
+      // Tags behind the virtual time carry no history
+      for (auto it = client_finish_.begin(); it != client_finish_.end();) {
+        it = it->second <= vtime_ ? client_finish_.erase(it) : std::next(it);
+      }
+    }
+    double &client_finish = client_finish_[opts.client_];
+    double finish = std::max(client_finish, vtime_) +
+                    static_cast<double>(std::max(size, kMinCost)) / cls.weight_;
+    client_finish = finish;
+    u64 deadline =
+        now_ns + (opts.deadline_us_ ? opts.deadline_us_ * 1000ull : kMaxAgeNs);
+    cls.stats_.waiting_ += 1;
+    order_.emplace(finish, task);
+    deadlines_.emplace(deadline, task);
+    u64 seq = seq_++;
+    if (elevator_window_) {
+      FileQueue &queue = files_[io.file_];
+      if (queue.window_.size() < elevator_window_) {
+        queue.window_.emplace(io.offset_, task);
+      } else {
+        queue.overflow_.emplace(seq, task);
+      }
+    }
+    return waiting_
+        .emplace(task, Waiting{finish, class_id, size, now_ns, deadline, 0,
+                               false, io.file_, io.offset_, seq})
+        .first;
+  }
+
+  std::mutex lock_;
+  std::vector<ClassState> classes_ = std::vector<ClassState>(1);
+  std::unordered_map<const Task *, Waiting> waiting_;
+  std::set<std::pair<double, const Task *>> order_;
+  std::set<std::pair<u64, const Task *>> deadlines_;
+  std::unordered_map<u64, double> client_finish_;
+  double vtime_ = 0;
+  u32 elevator_window_ = 0;
+  u32 max_window_ = 0;
+  std::unordered_map<u64, FileQueue> files_;
+  u64 seq_ = 0;
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_QOS_H_
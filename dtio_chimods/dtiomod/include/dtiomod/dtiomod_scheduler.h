@@ -0,0 +1,218 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_SCHEDULER_H_
+#define CHI_dtiomod_SCHEDULER_H_
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtio/dtio_enumerations.h"
+
+namespace chi::dtiomod {
+
+/** What the scheduler knows about one container */
+struct ContainerLoad {
+  double capacity_ = 1; /**< Relative service rate */
+  double queued_ = 0;   /**< Bytes waiting to be serviced */
+  double overhead_ = 0; /**< Fixed cost of one task, in bytes of service */
+
+  /** When the container would be done after @tasks more tasks of @extra */
+  double FinishTime(double extra, size_t tasks = 1) const {
+    return (queued_ + extra + tasks * overhead_) / capacity_;
+  }
+
+  /** Queue a task of @size bytes */
+  void Charge(size_t size) { queued_ += size + overhead_; }
+};
+
+/** Places batches of I/O tasks onto containers */
+class Scheduler {
+ public:
+  virtual ~Scheduler() = default;
+
+  /**
+   * Choose a container for each task in @sizes. @loads has one entry per
+   * container and is charged with the bytes assigned to it.
+   * */
+  virtual void Place(const std::vector<size_t> &sizes,
+                     std::vector<ContainerLoad> &loads,
+                     std::vector<u32> &placement) = 0;
+
+  /** Build the policy for @type */
+  static std::unique_ptr<Scheduler> Create(dtio::SolverImplType type);
+};
+
+/** Cycle through the containers regardless of load */
+class RoundRobinScheduler : public Scheduler {
+ public:
+  void Place(const std::vector<size_t> &sizes,
+             std::vector<ContainerLoad> &loads,
+             std::vector<u32> &placement) override {
+    placement.resize(sizes.size());
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      placement[i] = next_++ % loads.size();
+      loads[placement[i]].Charge(sizes[i]);
+    }
+  }
+
+ private:
+  size_t next_ = 0;
+};
+
+/** Pick containers uniformly at random */
+class RandomScheduler : public Scheduler {
+ public:
+  void Place(const std::vector<size_t> &sizes,
+             std::vector<ContainerLoad> &loads,
+             std::vector<u32> &placement) override {
+    std::uniform_int_distribution<u32> dist(0, loads.size() - 1);
+    placement.resize(sizes.size());
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      placement[i] = dist(rng_);
+      loads[placement[i]].Charge(sizes[i]);
+    }
+  }
+
+ private:
+  std::mt19937 rng_{std::random_device{}()};
+};
+
+/**
+ * Longest-processing-time-first: the largest remaining task goes to the
+ * container that would finish it earliest. Within 4/3 of the optimal
+ * makespan.
+ * */
+class GreedyScheduler : public Scheduler {
+ public:
+  void Place(const std::vector<size_t> &sizes,
+             std::vector<ContainerLoad> &loads,
+             std::vector<u32> &placement) override {
+    std::vector<size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return sizes[a] > sizes[b];
+    });
+    placement.resize(sizes.size());
+    for (size_t i : order) {
+      u32 best = 0;
+      for (u32 c = 1; c < loads.size(); ++c) {
+        if (loads[c].FinishTime(sizes[i]) < loads[best].FinishTime(sizes[i])) {
+          best = c;
+        }
+      }
+      placement[i] = best;
+      loads[best].Charge(sizes[i]);
+    }
+  }
+};
+
+/**
+ * Exact minimum-makespan placement by dynamic programming over subsets of
+ * the batch: best[c][S] is the smallest makespan when the first c
+ * containers service exactly the tasks in S. This costs O(containers * 3^n),
+ * so batches larger than kMaxBatch fall back to the greedy solver.
+ * */
+class DpScheduler : public Scheduler {
+ public:
+  static constexpr size_t kMaxBatch = 8;
+
+  void Place(const std::vector<size_t> &sizes,
+             std::vector<ContainerLoad> &loads,
+             std::vector<u32> &placement) override {
+    size_t n = sizes.size();
+    if (n > kMaxBatch) {
+      greedy_.Place(sizes, loads, placement);
+      return;
+    }
+    size_t nsets = size_t(1) << n;
+    size_t ncont = loads.size();
+
+    // Bytes in each subset of the batch
+    std::vector<double> set_bytes(nsets, 0);
+    for (size_t set = 1; set < nsets; ++set) {
+      size_t low = __builtin_ctzll(set);
+      set_bytes[set] = set_bytes[set & (set - 1)] + sizes[low];
+    }
+
+    const double kInf = std::numeric_limits<double>::infinity();
+    std::vector<double> best(nsets, kInf), next(nsets);
+    std::vector<std::vector<size_t>> choice(ncont,
+                                            std::vector<size_t>(nsets, 0));
+    best[0] = 0;
+    for (size_t c = 0; c < ncont; ++c) {
+      for (size_t set = 0; set < nsets; ++set) {
+        // Enumerate every subset of set, including the empty one
+        double set_best = kInf;
+        size_t sub = set;
+        while (true) {
+          double span = std::max(best[set ^ sub],
+                                 loads[c].FinishTime(set_bytes[sub],
+                                                     __builtin_popcountll(sub)));
+          if (span < set_best) {
+            set_best = span;
+            choice[c][set] = sub;
+          }
+          if (sub == 0) {
+            break;
+          }
+          sub = (sub - 1) & set;
+        }
+        next[set] = set_best;
+      }
+      std::swap(best, next);
+    }
+
+    // Walk the choices back from the full batch
+    placement.resize(n);
+    size_t set = nsets - 1;
+    for (size_t c = ncont; c-- > 0;) {
+      size_t sub = choice[c][set];
+      for (size_t i = 0; i < n; ++i) {
+        if (sub & (size_t(1) << i)) {
+          placement[i] = c;
+          loads[c].Charge(sizes[i]);
+        }
+      }
+      set ^= sub;
+    }
+  }
+
+ private:
+  GreedyScheduler greedy_;
+};
+
+inline std::unique_ptr<Scheduler> Scheduler::Create(
+    dtio::SolverImplType type) {
+  switch (type) {
+    case dtio::SolverImplType::kDp:
+      return std::make_unique<DpScheduler>();
+    case dtio::SolverImplType::kGreedy:
+      return std::make_unique<GreedyScheduler>();
+    case dtio::SolverImplType::kRandomSelect:
+      return std::make_unique<RandomScheduler>();
+    case dtio::SolverImplType::kRoundRobin:
+    case dtio::SolverImplType::kDefault:
+    default:
+      return std::make_unique<RoundRobinScheduler>();
+  }
+}
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_SCHEDULER_H_
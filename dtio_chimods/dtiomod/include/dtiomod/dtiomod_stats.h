@@ -0,0 +1,230 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_STATS_H_
+#define CHI_dtiomod_STATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#include "chimaera/chimaera_namespace.h"
+
+namespace chi::dtiomod {
+
+/** A point-in-time report of the load on one container */
+struct WorkerStats {
+  u32 container_id_ = 0;
+  u64 queue_depth_ = 0;    /**< I/O tasks queued or running */
+  u64 inflight_bytes_ = 0; /**< Bytes carried by those tasks */
+  double throughput_ = 0;  /**< Bytes per second of busy time (EWMA) */
+  u64 free_capacity_ = 0;  /**< Staging buffer bytes not in flight */
+  double cost_fixed_ns_ = 0;    /**< Predicted latency of an empty I/O */
+  double cost_ns_per_byte_ = 0; /**< Predicted latency per byte, 0 if unknown */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(container_id_, queue_depth_, inflight_bytes_, throughput_,
+       free_capacity_, cost_fixed_ns_, cost_ns_per_byte_);
+  }
+};
+
+/** Bytes of I/O queued or running on a container */
+struct InflightStats {
+  u64 client_bytes_ = 0; /**< Those of one client */
+  u64 node_bytes_ = 0;   /**< Those of all clients */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(client_bytes_, node_bytes_);
+  }
+};
+
+/** What a container knows of a small file stored in one of its packs */
+struct PackInfo {
+  bool found_ = false; /**< Whether the file is packed */
+  u64 size_ = 0;
+  u32 mode_ = 0;
+  u64 mtime_ = 0; /**< Seconds since the epoch */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(found_, size_, mode_, mtime_);
+  }
+};
+
+/** What the home container of a file kept in memory knows of it */
+struct MemoryInfo {
+  bool in_memory_ = false; /**< Whether the file is held in memory */
+  bool exists_ = false;    /**< Whether it exists, in memory or on the PFS */
+  bool created_ = false;   /**< Whether this open created it */
+  u64 size_ = 0;
+  u32 mode_ = 0;
+  u64 mtime_ = 0; /**< Seconds since the epoch */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(in_memory_, exists_, created_, size_, mode_, mtime_);
+  }
+};
+
+/** How far the data of a file held above the PFS has been drained */
+struct StageProgress {
+  u64 held_bytes_ = 0;    /**< Bytes still waiting to reach the PFS */
+  u64 drained_bytes_ = 0; /**< Bytes written to the PFS so far */
+  u64 held_end_ = 0;      /**< End of the file's data held above the PFS */
+  bool sync_failed_ = false; /**< A log could not be put on the PFS */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(held_bytes_, drained_bytes_, held_end_, sync_failed_);
+  }
+};
+
+/** How full the tiers above the PFS are and how memory is being freed */
+struct TierStats {
+  u64 buffers_capacity_ = 0;
+  u64 buffers_used_ = 0;  /**< Bytes held in memory */
+  u64 buffers_dirty_ = 0; /**< Of those, bytes not yet on the PFS */
+  u64 cache_capacity_ = 0;
+  u64 cache_used_ = 0;
+  u64 cache_dirty_ = 0;
+  u64 evicted_bytes_ = 0;      /**< Clean bytes dropped from memory */
+  u64 demoted_bytes_ = 0;      /**< Dirty bytes moved to the cache tier */
+  u64 written_back_bytes_ = 0; /**< Dirty bytes written back to the PFS */
+  u64 stalls_ = 0; /**< Writes memory had no room for even after eviction */
+  u64 evict_rate_ = 0;     /**< Clean bytes dropped per second, lately */
+  u64 writeback_rate_ = 0; /**< Dirty bytes moved out per second, lately */
+
+  template <typename Ar>
+  HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
+    ar(buffers_capacity_, buffers_used_, buffers_dirty_, cache_capacity_,
+       cache_used_, cache_dirty_, evicted_bytes_, demoted_bytes_,
+       written_back_bytes_, stalls_, evict_rate_, writeback_rate_);
+  }
+};
+
+/**
+ * The latest WorkerStats of every container. This is what WORKER_SCORE and
+ * WORKER_CAPACITY hold in docs/map-layouts.txt. Each slot is a seqlock, so
+ * Get never blocks Publish. If two reports for the same container race, the
+ * later one is dropped. The next interval brings a fresh report anyway.
+ * */
+class WorkerStatsTable {
+ public:
+  /** Allocate one slot per container */
+  void Resize(size_t count) {
+    slots_ = std::make_unique<Slot[]>(count);
+    count_ = count;
+  }
+
+  size_t size() const { return count_; }
+
+  /** Current time in the clock used to stamp reports */
+  static u64 NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /** Store @stats as the latest report of its container */
+  void Publish(const WorkerStats &stats) {
+    if (stats.container_id_ >= count_) {
+      return;
+    }
+    Slot &slot = slots_[stats.container_id_];
+    u64 seq = slot.seq_.load(std::memory_order_relaxed);
+    if ((seq & 1) ||
+        !slot.seq_.compare_exchange_strong(seq, seq + 1,
+                                           std::memory_order_acquire)) {
+      return;
+    }
+    slot.queue_depth_.store(stats.queue_depth_, std::memory_order_relaxed);
+    slot.inflight_bytes_.store(stats.inflight_bytes_,
+                               std::memory_order_relaxed);
+    slot.throughput_bits_.store(ToBits(stats.throughput_),
+                                std::memory_order_relaxed);
+    slot.free_capacity_.store(stats.free_capacity_, std::memory_order_relaxed);
+    slot.cost_fixed_bits_.store(ToBits(stats.cost_fixed_ns_),
+                                std::memory_order_relaxed);
+    slot.cost_per_byte_bits_.store(ToBits(stats.cost_ns_per_byte_),
+                                   std::memory_order_relaxed);
+    slot.stamp_ns_.store(NowNs(), std::memory_order_relaxed);
+    slot.seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * Read the latest report of @container_id into @stats, and when it was
+   * published into @stamp_ns. Returns false if it never reported.
+   * */
+  bool Get(u32 container_id, WorkerStats &stats, u64 &stamp_ns) const {
+    if (container_id >= count_) {
+      return false;
+    }
+    const Slot &slot = slots_[container_id];
+    u64 seq, throughput_bits, cost_fixed_bits, cost_per_byte_bits;
+    do {
+      seq = slot.seq_.load(std::memory_order_acquire);
+      stats.queue_depth_ = slot.queue_depth_.load(std::memory_order_relaxed);
+      stats.inflight_bytes_ =
+          slot.inflight_bytes_.load(std::memory_order_relaxed);
+      throughput_bits = slot.throughput_bits_.load(std::memory_order_relaxed);
+      stats.free_capacity_ =
+          slot.free_capacity_.load(std::memory_order_relaxed);
+      cost_fixed_bits = slot.cost_fixed_bits_.load(std::memory_order_relaxed);
+      cost_per_byte_bits =
+          slot.cost_per_byte_bits_.load(std::memory_order_relaxed);
+      stamp_ns = slot.stamp_ns_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != slot.seq_.load(std::memory_order_relaxed));
+    stats.throughput_ = FromBits(throughput_bits);
+    stats.cost_fixed_ns_ = FromBits(cost_fixed_bits);
+    stats.cost_ns_per_byte_ = FromBits(cost_per_byte_bits);
+    stats.container_id_ = container_id;
+    return stamp_ns != 0;
+  }
+
+ private:
+  /** A double as the bits a slot stores it in */
+  static u64 ToBits(double value) {
+    u64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  /** The double stored in a slot as @bits */
+  static double FromBits(u64 bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  struct Slot {
+    std::atomic<u64> seq_{0};
+    std::atomic<u64> queue_depth_{0};
+    std::atomic<u64> inflight_bytes_{0};
+    std::atomic<u64> throughput_bits_{0};
+    std::atomic<u64> free_capacity_{0};
+    std::atomic<u64> cost_fixed_bits_{0};
+    std::atomic<u64> cost_per_byte_bits_{0};
+    std::atomic<u64> stamp_ns_{0};
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t count_ = 0;
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_STATS_H_
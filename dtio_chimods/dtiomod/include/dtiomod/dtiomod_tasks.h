@@ -7,6 +7,9 @@
 
 #include "chimaera/chimaera_namespace.h"
 #include "dtio/dtio_enumerations.h"
+#include "dtiomod_lanes.h"
+#include "dtiomod_qos.h"
+#include "dtiomod_stats.h"
 
 namespace chi::dtiomod {
 
@@ -18,19 +21,74 @@ CHI_BEGIN(Create)
 struct CreateTaskParams {
   CLS_CONST char *lib_name_ = "example_dtiomod";
   int dtiomod_id_;
+  dtio::SolverImplType solver_;
+  u32 stats_period_ms_;    /**< How often containers report their load */
+  size_t buffer_capacity_; /**< Staging buffer bytes per container */
+  size_t stripe_size_;     /**< Granularity at which writes are homed */
+  /** I/O classes, indexed by IoOpts::class_ */
+  std::vector<QosClass> qos_classes_;
+  /** Queued tasks per file sorted by offset before dispatch (0 is off) */
+  u32 elevator_window_;
+  u32 lanes_;     /**< Most lanes a container spreads I/O tasks over */
+  u32 min_lanes_; /**< Lanes kept active when the container is idle */
+  /** Tiers holding written data ahead of the PFS */
+  size_t tier_buffers_capacity_;
+  std::string tier_cache_dir_;
+  size_t tier_cache_capacity_;
+  size_t drain_rate_; /**< Bytes per second drained to the PFS (0 is off) */
+  /** Which read-hot blocks are copied up onto the tiers */
+  dtio::TierPolicyType tier_policy_;
+  size_t chunk_size_; /**< Bytes per chunk of a chunked file (0 is off) */
+  bool log_structured_; /**< Append writes to per-container logs */
+  std::string pack_dir_; /**< Where small files are packed (empty is off) */
+  size_t memory_capacity_; /**< Bytes of files kept in memory (0 is off) */
 
   HSHM_INLINE_CROSS_FUN
   CreateTaskParams() = default;
 
   HSHM_INLINE_CROSS_FUN
-  CreateTaskParams(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc,
-                   int dtiomod_id = 0) {
+  CreateTaskParams(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, int dtiomod_id = 0,
+      dtio::SolverImplType solver = dtio::SolverImplType::kDefault,
+      u32 stats_period_ms = 100,
+      size_t buffer_capacity = GIGABYTES(1),
+      size_t stripe_size = MEGABYTES(1),
+      const std::vector<QosClass> &qos_classes = {},
+      u32 elevator_window = 0, u32 lanes = 1, u32 min_lanes = 1,
+      size_t tier_buffers_capacity = 0,
+      const std::string &tier_cache_dir = std::string(),
+      size_t tier_cache_capacity = 0, size_t drain_rate = 0,
+      dtio::TierPolicyType tier_policy = dtio::TierPolicyType::kNone,
+      size_t chunk_size = 0, bool log_structured = false,
+      const std::string &pack_dir = std::string(),
+      size_t memory_capacity = 0) {
     dtiomod_id_ = dtiomod_id;
+    solver_ = solver;
+    stats_period_ms_ = stats_period_ms;
+    buffer_capacity_ = buffer_capacity;
+    stripe_size_ = stripe_size;
+    qos_classes_ = qos_classes;
+    elevator_window_ = elevator_window;
+    lanes_ = lanes;
+    min_lanes_ = min_lanes;
+    tier_buffers_capacity_ = tier_buffers_capacity;
+    tier_cache_dir_ = tier_cache_dir;
+    tier_cache_capacity_ = tier_cache_capacity;
+    drain_rate_ = drain_rate;
+    tier_policy_ = tier_policy;
+    chunk_size_ = chunk_size;
+    log_structured_ = log_structured;
+    pack_dir_ = pack_dir;
+    memory_capacity_ = memory_capacity;
   }
 
   template <typename Ar>
   HSHM_INLINE_CROSS_FUN void serialize(Ar &ar) {
-    ar(dtiomod_id_);
+    ar(dtiomod_id_, solver_, stats_period_ms_, buffer_capacity_, stripe_size_,
+       qos_classes_, elevator_window_, lanes_, min_lanes_,
+       tier_buffers_capacity_, tier_cache_dir_, tier_cache_capacity_,
+       drain_rate_, tier_policy_, chunk_size_, log_structured_, pack_dir_,
+       memory_capacity_);
   }
 };
 typedef chi::Admin::CreatePoolBaseTask<CreateTaskParams> CreateTask;
@@ -48,6 +106,8 @@ struct WriteTask : public Task, TaskFlags<TF_SRL_SYM> {
   IN size_t data_size_;
   IN chi::ipc::string filename_;
   IN dtio::IoClientType iface_;
+  IN IoOpts opts_;
+  OUT ssize_t ret_;
 
   /** SHM default constructor */
   HSHM_INLINE explicit WriteTask(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
@@ -58,7 +118,8 @@ struct WriteTask : public Task, TaskFlags<TF_SRL_SYM> {
       const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
       const PoolId &pool_id, const DomainQuery &dom_query,
       const hipc::Pointer &data, size_t data_size, size_t data_offset,
-      const chi::string &filename, dtio::IoClientType iface)
+      const chi::string &filename, dtio::IoClientType iface,
+      const IoOpts &opts = IoOpts())
       : Task(alloc), filename_(alloc, filename) {
     // Initialize task
     task_node_ = task_node;
@@ -73,6 +134,8 @@ struct WriteTask : public Task, TaskFlags<TF_SRL_SYM> {
     data_size_ = data_size;
     data_offset_ = data_offset;
     iface_ = iface;
+    opts_ = opts;
+    ret_ = 0;
   }
 
   /** Duplicate message */
@@ -82,6 +145,8 @@ struct WriteTask : public Task, TaskFlags<TF_SRL_SYM> {
     data_offset_ = other.data_offset_;
     filename_ = other.filename_;
     iface_ = other.iface_;
+    opts_ = other.opts_;
+    ret_ = other.ret_;
     if (!deep) {
       UnsetDataOwner();
     }
@@ -91,12 +156,14 @@ struct WriteTask : public Task, TaskFlags<TF_SRL_SYM> {
   template <typename Ar>
   void SerializeStart(Ar &ar) {
     ar.bulk(DT_WRITE, data_, data_size_);
-    ar(filename_, data_size_, data_offset_, iface_);
+    ar(filename_, data_size_, data_offset_, iface_, opts_);
   }
 
   /** (De)serialize message return */
   template <typename Ar>
-  void SerializeEnd(Ar &ar) {}
+  void SerializeEnd(Ar &ar) {
+    ar(ret_);
+  }
 };
 CHI_END(Write)
 
@@ -108,6 +175,8 @@ struct ReadTask : public Task, TaskFlags<TF_SRL_SYM> {
   IN size_t data_size_;
   IN chi::ipc::string filename_;
   IN dtio::IoClientType iface_;
+  IN IoOpts opts_;
+  OUT ssize_t ret_;
 
   /** SHM default constructor */
   HSHM_INLINE explicit ReadTask(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
@@ -120,7 +189,8 @@ struct ReadTask : public Task, TaskFlags<TF_SRL_SYM> {
                                 const DomainQuery &dom_query,
                                 const hipc::Pointer &data, size_t data_size,
                                 size_t data_offset, const chi::string &filename,
-                                dtio::IoClientType iface)
+                                dtio::IoClientType iface,
+                                const IoOpts &opts = IoOpts())
       : Task(alloc), filename_(alloc, filename) {
     // Initialize task
     task_node_ = task_node;
@@ -135,6 +205,8 @@ struct ReadTask : public Task, TaskFlags<TF_SRL_SYM> {
     data_size_ = data_size;
     data_offset_ = data_offset;
     iface_ = iface;
+    opts_ = opts;
+    ret_ = 0;
   }
 
   /** Duplicate message */
@@ -144,6 +216,8 @@ struct ReadTask : public Task, TaskFlags<TF_SRL_SYM> {
     data_offset_ = other.data_offset_;
     filename_ = other.filename_;
     iface_ = other.iface_;
+    opts_ = other.opts_;
+    ret_ = other.ret_;
     if (!deep) {
       UnsetDataOwner();
     }
@@ -153,12 +227,14 @@ struct ReadTask : public Task, TaskFlags<TF_SRL_SYM> {
   template <typename Ar>
   void SerializeStart(Ar &ar) {
     ar.bulk(DT_WRITE, data_, data_size_);
-    ar(filename_, data_size_, data_offset_, iface_);
+    ar(filename_, data_size_, data_offset_, iface_, opts_);
   }
 
   /** (De)serialize message return */
   template <typename Ar>
-  void SerializeEnd(Ar &ar) {}
+  void SerializeEnd(Ar &ar) {
+    ar(ret_);
+  }
 };
 CHI_END(Read);
 
@@ -302,20 +378,42 @@ struct MetaGetTask : public Task, TaskFlags<TF_SRL_SYM> {
 CHI_END(MetaGet);
 
 CHI_BEGIN(Schedule)
-/** The ScheduleTask task */
+/**
+ * The ScheduleTask task. Places a batch of pending I/O tasks, given by their
+ * sizes in bytes, onto the global containers of the pool. If a filename is
+ * given, the tasks are I/O of kind @op_ on that file at @offsets_, and reads
+ * are placed near data the pool wrote unless that container is overloaded.
+ * */
 struct ScheduleTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::vector<size_t> sizes_;
+  IN chi::ipc::string filename_;
+  IN chi::ipc::vector<size_t> offsets_;
+  IN dtio::Operation op_;
+  OUT chi::ipc::vector<u32> placement_;
   OUT size_t schedule_num_;
 
   /** SHM default constructor */
   HSHM_INLINE explicit ScheduleTask(
       const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
-      : Task(alloc) {}
+      : Task(alloc),
+        sizes_(alloc),
+        filename_(alloc),
+        offsets_(alloc),
+        placement_(alloc) {}
 
   /** Emplace constructor */
   HSHM_INLINE explicit ScheduleTask(
       const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
-      const PoolId &pool_id, const DomainQuery &dom_query)
-      : Task(alloc) {
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const std::vector<size_t> &sizes,
+      const chi::string &filename = chi::string(),
+      const std::vector<size_t> &offsets = {},
+      dtio::Operation op = dtio::Operation::kWrite)
+      : Task(alloc),
+        sizes_(alloc),
+        filename_(alloc, filename),
+        offsets_(alloc),
+        placement_(alloc) {
     // Initialize task
     task_node_ = task_node;
     prio_ = TaskPrioOpt::kLowLatency;
@@ -325,27 +423,1066 @@ struct ScheduleTask : public Task, TaskFlags<TF_SRL_SYM> {
     dom_query_ = dom_query;
 
     // Custom
+    sizes_.reserve(sizes.size());
+    for (size_t size : sizes) {
+      sizes_.emplace_back(size);
+    }
+    offsets_.reserve(offsets.size());
+    for (size_t offset : offsets) {
+      offsets_.emplace_back(offset);
+    }
+    op_ = op;
+    schedule_num_ = 0;
   }
 
   /** Duplicate message */
   void CopyStart(const ScheduleTask &other, bool deep) {
+    sizes_ = other.sizes_;
+    filename_ = other.filename_;
+    offsets_ = other.offsets_;
+    op_ = other.op_;
+    placement_ = other.placement_;
     schedule_num_ = other.schedule_num_;
   }
 
   /** (De)serialize message call */
   template <typename Ar>
-  void SerializeStart(Ar &ar) {}
+  void SerializeStart(Ar &ar) {
+    ar(sizes_, filename_, offsets_, op_);
+  }
 
   /** (De)serialize message return */
   template <typename Ar>
   void SerializeEnd(Ar &ar) {
-    ar(schedule_num_);
+    ar(placement_, schedule_num_);
   }
 };
 CHI_END(Schedule);
 
+CHI_BEGIN(WriteV)
+/**
+ * A vectored write. All segments are packed back to back in one shm staging
+ * region and land contiguously in the file starting at data_offset_.
+ * */
+struct WriteVTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN hipc::Pointer data_;
+  IN size_t data_offset_;
+  IN size_t data_size_;
+  IN chi::ipc::vector<size_t> seg_sizes_;
+  IN chi::ipc::string filename_;
+  IN dtio::IoClientType iface_;
+  IN IoOpts opts_;
+  OUT ssize_t ret_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit WriteVTask(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), seg_sizes_(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit WriteVTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const hipc::Pointer &data, const std::vector<size_t> &seg_sizes,
+      size_t data_size, size_t data_offset, const chi::string &filename,
+      dtio::IoClientType iface, const IoOpts &opts = IoOpts())
+      : Task(alloc), seg_sizes_(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kHighLatency;
+    pool_ = pool_id;
+    method_ = Method::kWriteV;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    data_ = data;
+    data_size_ = data_size;
+    data_offset_ = data_offset;
+    seg_sizes_.reserve(seg_sizes.size());
+    for (size_t seg_size : seg_sizes) {
+      seg_sizes_.emplace_back(seg_size);
+    }
+    iface_ = iface;
+    opts_ = opts;
+    ret_ = 0;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const WriteVTask &other, bool deep) {
+    data_ = other.data_;
+    data_size_ = other.data_size_;
+    data_offset_ = other.data_offset_;
+    seg_sizes_ = other.seg_sizes_;
+    filename_ = other.filename_;
+    iface_ = other.iface_;
+    opts_ = other.opts_;
+    ret_ = other.ret_;
+    if (!deep) {
+      UnsetDataOwner();
+    }
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar.bulk(DT_WRITE, data_, data_size_);
+    ar(filename_, seg_sizes_, data_size_, data_offset_, iface_,
+       opts_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(ret_);
+  }
+};
+CHI_END(WriteV);
+
+CHI_BEGIN(ReadV)
+/**
+ * A vectored read. The contiguous file range starting at data_offset_ is
+ * scattered into the segments of one shm staging region.
+ * */
+struct ReadVTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN hipc::Pointer data_;
+  IN size_t data_offset_;
+  IN size_t data_size_;
+  IN chi::ipc::vector<size_t> seg_sizes_;
+  IN chi::ipc::string filename_;
+  IN dtio::IoClientType iface_;
+  IN IoOpts opts_;
+  OUT ssize_t ret_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit ReadVTask(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), seg_sizes_(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit ReadVTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const hipc::Pointer &data, const std::vector<size_t> &seg_sizes,
+      size_t data_size, size_t data_offset, const chi::string &filename,
+      dtio::IoClientType iface, const IoOpts &opts = IoOpts())
+      : Task(alloc), seg_sizes_(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kReadV;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    data_ = data;
+    data_size_ = data_size;
+    data_offset_ = data_offset;
+    seg_sizes_.reserve(seg_sizes.size());
+    for (size_t seg_size : seg_sizes) {
+      seg_sizes_.emplace_back(seg_size);
+    }
+    iface_ = iface;
+    opts_ = opts;
+    ret_ = 0;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const ReadVTask &other, bool deep) {
+    data_ = other.data_;
+    data_size_ = other.data_size_;
+    data_offset_ = other.data_offset_;
+    seg_sizes_ = other.seg_sizes_;
+    filename_ = other.filename_;
+    iface_ = other.iface_;
+    opts_ = other.opts_;
+    ret_ = other.ret_;
+    if (!deep) {
+      UnsetDataOwner();
+    }
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar.bulk(DT_WRITE, data_, data_size_);
+    ar(filename_, seg_sizes_, data_size_, data_offset_, iface_,
+       opts_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(ret_);
+  }
+};
+CHI_END(ReadV);
+
 CHI_AUTOGEN_METHODS  // keep at class bottom
 
+CHI_BEGIN(CollectStats)
+/**
+ * A periodic task that snapshots the load on one container and reports it
+ * to container 0, which owns the worker stats table used for scheduling.
+ * */
+struct CollectStatsTask : public Task, TaskFlags<TF_SRL_SYM> {
+  /** SHM default constructor */
+  HSHM_INLINE explicit CollectStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit CollectStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query, u32 period_ms)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kCollectStats;
+    task_flags_.SetBits(TASK_LONG_RUNNING);
+    SetPeriodMs(period_ms);
+    dom_query_ = dom_query;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const CollectStatsTask &other, bool deep) {}
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {}
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {}
+};
+CHI_END(CollectStats);
+
+CHI_BEGIN(PublishStats)
+/** Store the load report of one container in the worker stats table */
+struct PublishStatsTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN WorkerStats stats_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit PublishStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit PublishStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const WorkerStats &stats)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kPublishStats;
+    task_flags_.SetBits(TASK_FIRE_AND_FORGET);
+    dom_query_ = dom_query;
+
+    // Custom
+    stats_ = stats;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const PublishStatsTask &other, bool deep) {
+    stats_ = other.stats_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(stats_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {}
+};
+CHI_END(PublishStats);
+
+CHI_BEGIN(QosStats)
+/** Fetch what each QoS class has been served on one container */
+struct QosStatsTask : public Task, TaskFlags<TF_SRL_SYM> {
+  OUT chi::ipc::vector<QosClassStats> stats_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit QosStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), stats_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit QosStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query)
+      : Task(alloc), stats_(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kQosStats;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const QosStatsTask &other, bool deep) {
+    stats_ = other.stats_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {}
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(stats_);
+  }
+};
+CHI_END(QosStats);
+
+CHI_BEGIN(LaneStats)
+/** Fetch how I/O tasks have been spread over the lanes of one container */
+struct LaneStatsTask : public Task, TaskFlags<TF_SRL_SYM> {
+  OUT LaneStats stats_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit LaneStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit LaneStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kLaneStats;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const LaneStatsTask &other, bool deep) {
+    stats_ = other.stats_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {}
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(stats_);
+  }
+};
+CHI_END(LaneStats);
+
+CHI_BEGIN(Inflight)
+/** Fetch the bytes of I/O in flight on one container */
+struct InflightTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN u64 client_;
+  OUT InflightStats stats_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit InflightTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit InflightTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query, u64 client)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kInflight;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    client_ = client;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const InflightTask &other, bool deep) {
+    client_ = other.client_;
+    stats_ = other.stats_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(client_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(stats_);
+  }
+};
+CHI_END(Inflight);
+
+CHI_BEGIN(Staging)
+/**
+ * A periodic task that drains the data one container holds above the PFS
+ * down to it, behind foreground I/O.
+ * */
+struct StagingTask : public Task, TaskFlags<TF_SRL_SYM> {
+  /** SHM default constructor */
+  HSHM_INLINE explicit StagingTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit StagingTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query, u32 period_ms)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kStaging;
+    task_flags_.SetBits(TASK_LONG_RUNNING);
+    SetPeriodMs(period_ms);
+    dom_query_ = dom_query;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const StagingTask &other, bool deep) {}
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {}
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {}
+};
+CHI_END(Staging);
+
+CHI_BEGIN(Flush)
+/**
+ * Drain a file's data held above the PFS down to it, or only report how
+ * far it has been drained
+ * */
+struct FlushTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  IN bool wait_;
+  OUT StageProgress progress_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit FlushTask(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit FlushTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename, bool wait)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kFlush;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    wait_ = wait;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const FlushTask &other, bool deep) {
+    filename_ = other.filename_;
+    wait_ = other.wait_;
+    progress_ = other.progress_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(filename_, wait_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(progress_);
+  }
+};
+CHI_END(Flush);
+
+CHI_BEGIN(Compact)
+/**
+ * Copy the logs of a log-structured file into the file, now or once
+ * requests to do so stop arriving
+ * */
+struct CompactTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  IN bool wait_;
+  OUT u64 compacted_; /**< Bytes copied into the file */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit CompactTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit CompactTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename, bool wait)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kCompact;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    wait_ = wait;
+    compacted_ = 0;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const CompactTask &other, bool deep) {
+    filename_ = other.filename_;
+    wait_ = other.wait_;
+    compacted_ = other.compacted_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(filename_, wait_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(compacted_);
+  }
+};
+CHI_END(Compact);
+
+CHI_BEGIN(PackGet)
+/** Look up a packed file, and copy it out of its pack */
+struct PackGetTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  IN hipc::Pointer data_;
+  IN size_t data_size_; /**< Most bytes of the file to copy into data_ */
+  OUT PackInfo info_;
+  OUT ssize_t ret_; /**< Bytes copied, or -1 */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit PackGetTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit PackGetTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename, const hipc::Pointer &data,
+      size_t data_size)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kPackGet;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    data_ = data;
+    data_size_ = data_size;
+    ret_ = 0;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const PackGetTask &other, bool deep) {
+    filename_ = other.filename_;
+    data_ = other.data_;
+    data_size_ = other.data_size_;
+    info_ = other.info_;
+    ret_ = other.ret_;
+    if (!deep) {
+      UnsetDataOwner();
+    }
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar.bulk(DT_WRITE, data_, data_size_);
+    ar(filename_, data_size_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(info_, ret_);
+  }
+};
+CHI_END(PackGet);
+
+CHI_BEGIN(PackPut)
+/** Store the whole of a small file in a pack */
+struct PackPutTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  IN hipc::Pointer data_;
+  IN size_t data_size_;
+  IN u32 mode_;
+  OUT ssize_t ret_; /**< Bytes packed, or -1 */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit PackPutTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit PackPutTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename, const hipc::Pointer &data,
+      size_t data_size, u32 mode)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kPackPut;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    data_ = data;
+    data_size_ = data_size;
+    mode_ = mode;
+    ret_ = 0;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const PackPutTask &other, bool deep) {
+    filename_ = other.filename_;
+    data_ = other.data_;
+    data_size_ = other.data_size_;
+    mode_ = other.mode_;
+    ret_ = other.ret_;
+    if (!deep) {
+      UnsetDataOwner();
+    }
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar.bulk(DT_WRITE, data_, data_size_);
+    ar(filename_, data_size_, mode_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(ret_);
+  }
+};
+CHI_END(PackPut);
+
+CHI_BEGIN(PackRemove)
+/** Drop a small file from its pack */
+struct PackRemoveTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  OUT bool removed_; /**< Whether the file was packed */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit PackRemoveTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit PackRemoveTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kPackRemove;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    removed_ = false;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const PackRemoveTask &other, bool deep) {
+    filename_ = other.filename_;
+    removed_ = other.removed_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(filename_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(removed_);
+  }
+};
+CHI_END(PackRemove);
+
+CHI_BEGIN(MemOpen)
+/** Open or stat a file that may be kept in memory */
+struct MemOpenTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  IN bool create_;   /**< Create it in memory if it exists nowhere */
+  IN bool truncate_; /**< Empty it if it is in memory */
+  IN u32 mode_;
+  OUT MemoryInfo info_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit MemOpenTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit MemOpenTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename, bool create, bool truncate, u32 mode)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kMemOpen;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    create_ = create;
+    truncate_ = truncate;
+    mode_ = mode;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const MemOpenTask &other, bool deep) {
+    filename_ = other.filename_;
+    create_ = other.create_;
+    truncate_ = other.truncate_;
+    mode_ = other.mode_;
+    info_ = other.info_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(filename_, create_, truncate_, mode_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(info_);
+  }
+};
+CHI_END(MemOpen);
+
+CHI_BEGIN(Discard)
+/** Drop a deleted file from memory without persisting it */
+struct DiscardTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  OUT bool discarded_; /**< Whether the file was in memory */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit DiscardTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit DiscardTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kDiscard;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    discarded_ = false;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const DiscardTask &other, bool deep) {
+    filename_ = other.filename_;
+    discarded_ = other.discarded_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(filename_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(discarded_);
+  }
+};
+CHI_END(Discard);
+
+CHI_BEGIN(Copy)
+/**
+ * Copy a range of one file into another inside the runtime. A copy of 0
+ * bytes only reports the size of the source.
+ * */
+struct CopyTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string src_;
+  IN chi::ipc::string dst_;
+  IN size_t src_offset_;
+  IN size_t dst_offset_;
+  IN size_t size_;
+  OUT size_t src_size_; /**< The size of the source, as seen by the copy */
+  OUT ssize_t ret_;     /**< Bytes copied, or -1 */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit CopyTask(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), src_(alloc), dst_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit CopyTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &src, size_t src_offset, const chi::string &dst,
+      size_t dst_offset, size_t size)
+      : Task(alloc), src_(alloc, src), dst_(alloc, dst) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kCopy;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    src_offset_ = src_offset;
+    dst_offset_ = dst_offset;
+    size_ = size;
+    src_size_ = 0;
+    ret_ = 0;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const CopyTask &other, bool deep) {
+    src_ = other.src_;
+    dst_ = other.dst_;
+    src_offset_ = other.src_offset_;
+    dst_offset_ = other.dst_offset_;
+    size_ = other.size_;
+    src_size_ = other.src_size_;
+    ret_ = other.ret_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(src_, dst_, src_offset_, dst_offset_, size_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(src_size_, ret_);
+  }
+};
+CHI_END(Copy);
+
+CHI_BEGIN(TierStats)
+/** Fetch how full the tiers of one container are */
+struct TierStatsTask : public Task, TaskFlags<TF_SRL_SYM> {
+  OUT TierStats stats_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit TierStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit TierStatsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kTierStats;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const TierStatsTask &other, bool deep) {
+    stats_ = other.stats_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {}
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(stats_);
+  }
+};
+CHI_END(TierStats);
+
+CHI_BEGIN(RecordExtents)
+/**
+ * Record on container 0 the ranges of a file that @owner_ wrote. Sent once
+ * the writes completed, so reads are only steered to data that exists.
+ * */
+struct RecordExtentsTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  IN chi::ipc::vector<size_t> offsets_;
+  IN chi::ipc::vector<size_t> sizes_;
+  IN u32 owner_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit RecordExtentsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc), offsets_(alloc), sizes_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit RecordExtentsTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename, const std::vector<size_t> &offsets,
+      const std::vector<size_t> &sizes, u32 owner)
+      : Task(alloc), filename_(alloc, filename), offsets_(alloc), sizes_(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kRecordExtents;
+    task_flags_.SetBits(TASK_FIRE_AND_FORGET);
+    dom_query_ = dom_query;
+
+    // Custom
+    offsets_.reserve(offsets.size());
+    for (size_t offset : offsets) {
+      offsets_.emplace_back(offset);
+    }
+    sizes_.reserve(sizes.size());
+    for (size_t size : sizes) {
+      sizes_.emplace_back(size);
+    }
+    owner_ = owner;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const RecordExtentsTask &other, bool deep) {
+    filename_ = other.filename_;
+    offsets_ = other.offsets_;
+    sizes_ = other.sizes_;
+    owner_ = other.owner_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(filename_, offsets_, sizes_, owner_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {}
+};
+CHI_END(RecordExtents);
+
+CHI_BEGIN(Truncate)
+/**
+ * Drop what the pool keeps of a file past @size_ bytes, after the file was
+ * truncated, or all of it if the file is being unlinked
+ * */
+struct TruncateTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN chi::ipc::string filename_;
+  IN size_t size_;
+  IN bool unlink_;
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit TruncateTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc), filename_(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit TruncateTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const chi::string &filename, size_t size, bool unlink)
+      : Task(alloc), filename_(alloc, filename) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kTruncate;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    size_ = size;
+    unlink_ = unlink;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const TruncateTask &other, bool deep) {
+    filename_ = other.filename_;
+    size_ = other.size_;
+    unlink_ = other.unlink_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(filename_, size_, unlink_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {}
+};
+CHI_END(Truncate);
+
 }  // namespace chi::dtiomod
 
 #endif  // CHI_TASKS_TASK_TEMPL_INCLUDE_dtiomod_dtiomod_TASKS_H_
@@ -0,0 +1,897 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef CHI_dtiomod_TIERS_H_
+#define CHI_dtiomod_TIERS_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chimaera/chimaera_namespace.h"
+#include "dtio/dtio_enumerations.h"
+#include "dtiomod_stats.h"
+
+namespace chi::dtiomod {
+
+/** Where a container keeps file data ahead of the PFS */
+struct TierConfig {
+  size_t buffers_capacity_ = 0; /**< Bytes of runtime memory (0 is off) */
+  std::string cache_dir_;       /**< Node-local directory, e.g. on an SSD */
+  size_t cache_capacity_ = 0;   /**< Bytes of cache_dir_ to use (0 is off) */
+  size_t drain_align_ = MEGABYTES(1); /**< PFS writes start at multiples */
+
+  bool Enabled() const {
+    return buffers_capacity_ || (!cache_dir_.empty() && cache_capacity_);
+  }
+};
+
+/**
+ * Places file data on a hierarchy of tiers: runtime memory (kBuffers), a
+ * node-local directory (kCache), and the file's own path on the PFS
+ * (kPfs). A write lands on the fastest tier with room for it. A per-file
+ * extent map records the ranges held above the PFS. Ranges not in it live
+ * on the PFS. A read is assembled from whichever tier holds each range, so
+ * it always sees the latest write.
+ *
+ * The cache tier keeps one sparse file per PFS file, at the same offsets.
+ *
+ * Held data is drained down to the PFS in offset order, resuming where the
+ * file's last drain stopped. Adjacent extents are coalesced into writes of
+ * up to kDrainSize, cut at multiples of drain_align_ so each write covers
+ * whole PFS stripes where it can. A file's lock is held while one of its
+ * writes is in flight, so a newer write to the same range cannot be
+ * overwritten by older drained data.
+ *
+ * Ranges can also be copied up from the PFS to serve reads from a faster
+ * tier. These clean copies are never drained. They are dropped when
+ * demoted, or replaced when the range is written.
+ *
+ * A file's entry is dropped once it holds nothing, and Discard drops what a
+ * truncated or unlinked file holds, so it is never drained back.
+ *
+ * Memory is a hard budget. A write that does not fit makes room by
+ * sweeping a CLOCK hand over the memory extents of every file: an extent
+ * read or written since the hand last passed it is skipped once, and clean
+ * extents are dropped before any dirty one is touched. Dirty extents are
+ * then moved to the cache tier while it has room, and written back to the
+ * PFS when it does not. Relieve does the same in the background once
+ * memory passes kHighWater, down to kLowWater, so writes rarely wait.
+ * */
+class TierManager {
+ public:
+  /** Writes and reads a file's data on the PFS, in the Posix* signatures */
+  typedef std::function<ssize_t(const std::string &, const char *, size_t,
+                                size_t)>
+      PfsWriteFn;
+  typedef std::function<ssize_t(const std::string &, char *, size_t, size_t)>
+      PfsReadFn;
+
+  CLS_CONST size_t kNumTiers = 3;
+  /** Largest write a drain issues to the PFS */
+  CLS_CONST size_t kDrainSize = MEGABYTES(8);
+  /** Share of a tier's capacity past which it is drained regardless */
+  CLS_CONST double kHighWater = 0.75;
+  /** Share of memory Relieve brings it back down to */
+  CLS_CONST double kLowWater = 0.5;
+  /** How often the eviction rates are sampled */
+  CLS_CONST u64 kRatePeriodNs = 1000000000;
+
+ public:
+  void Configure(const TierConfig &config) {
+    config_ = config;
+    config_.drain_align_ = std::max<size_t>(config.drain_align_, 1);
+    capacity_[Index(dtio::LocationType::kBuffers)] = config.buffers_capacity_;
+    capacity_[Index(dtio::LocationType::kCache)] =
+        config.cache_dir_.empty() ? 0 : config.cache_capacity_;
+    if (capacity_[Index(dtio::LocationType::kCache)]) {
+      mkdir(config.cache_dir_.c_str(), 0775);
+    }
+  }
+
+  bool Enabled() const { return config_.Enabled(); }
+
+  /** Store data on the PFS through @write and @read instead of in place */
+  void SetPfs(PfsWriteFn write, PfsReadFn read) {
+    pfs_write_ = std::move(write);
+    pfs_read_ = std::move(read);
+  }
+
+  /** Bytes the tiers above the PFS can hold */
+  size_t Capacity() const {
+    return capacity_[Index(dtio::LocationType::kBuffers)] +
+           capacity_[Index(dtio::LocationType::kCache)];
+  }
+
+  /** Bytes held on @tier */
+  size_t Used(dtio::LocationType tier) const {
+    return used_[Index(tier)].load();
+  }
+
+  /**
+   * Write @size bytes of @data at @offset of @path, on the fastest tier
+   * with room that is no faster than @tier. Returns the bytes written, or
+   * -1.
+   * */
+  ssize_t Write(const std::string &path, size_t offset, const char *data,
+                size_t size,
+                dtio::LocationType tier = dtio::LocationType::kBuffers) {
+    std::unique_lock<std::mutex> guard;
+    std::shared_ptr<FileTiers> file = LockFile(path, guard);
+    if (tier == dtio::LocationType::kBuffers &&
+        MakeRoom(size, file.get())) {
+      auto mem = std::make_shared<std::vector<char>>(data, data + size);
+      Insert(*file, offset,
+             Extent{offset + size, dtio::LocationType::kBuffers, mem, 0});
+      return size;
+    }
+    if (tier != dtio::LocationType::kPfs &&
+        Reserve(dtio::LocationType::kCache, size)) {
+      if (PosixWrite(CachePath(path), data, size, offset) ==
+          static_cast<ssize_t>(size)) {
+        Insert(*file, offset,
+               Extent{offset + size, dtio::LocationType::kCache, nullptr, 0});
+        return size;
+      }
+      Release(dtio::LocationType::kCache, size);
+    }
+    ssize_t ret = PfsWrite(path, data, size, offset);
+    if (ret > 0) {
+      Carve(*file, offset, offset + ret);
+    }
+    Prune(path, *file);
+    return ret;
+  }
+
+  /**
+   * Read @size bytes at @offset of @path into @data. Ranges above the PFS
+   * come from their tier, the rest from the PFS. Returns the bytes up to
+   * the end of the file's data, or -1.
+   * */
+  ssize_t Read(const std::string &path, size_t offset, char *data,
+               size_t size) {
+    std::shared_ptr<FileTiers> file = GetFile(path, false);
+    if (!file) {
+      return PfsRead(path, data, size, offset);
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    size_t end = offset + size;
+    size_t valid = offset; /**< End of the bytes known to exist */
+    auto it = file->extents_.upper_bound(offset);
+    if (it != file->extents_.begin() && std::prev(it)->second.end_ > offset) {
+      --it;
+    }
+    for (size_t pos = offset; pos < end;) {
+      char *out = data + (pos - offset);
+      if (it != file->extents_.end() && it->first <= pos) {
+        // The range is held above the PFS
+        it->second.referenced_ = true;
+        size_t len = std::min(it->second.end_, end) - pos;
+        if (ReadExtent(path, it->first, it->second, pos, out, len) < 0) {
+          return -1;
+        }
+        pos += len;
+        valid = pos;
+        ++it;
+        continue;
+      }
+      // A gap comes from the PFS. Past its end are holes.
+      size_t gap_end =
+          it == file->extents_.end() ? end : std::min(it->first, end);
+      size_t len = gap_end - pos;
+      ssize_t ret = PfsRead(path, out, len, pos);
+      size_t got = ret > 0 ? ret : 0;
+      memset(out + got, 0, len - got);
+      if (got) {
+        valid = pos + got;
+      }
+      pos = gap_end;
+    }
+    // Holes before the last extent are part of the file
+    if (!file->extents_.empty()) {
+      valid = std::max(valid,
+                       std::min(end, file->extents_.rbegin()->second.end_));
+    }
+    return valid - offset;
+  }
+
+  /**
+   * Copy [@offset, @offset + @size) of @path from the PFS to the fastest
+   * tier with room, as a clean copy. Ranges already held are left alone.
+   * Returns the bytes copied.
+   * */
+  size_t Promote(const std::string &path, size_t offset, size_t size) {
+    std::unique_lock<std::mutex> guard;
+    std::shared_ptr<FileTiers> file = LockFile(path, guard);
+    // Find the gaps first, since inserting changes the map
+    std::vector<std::pair<size_t, size_t>> gaps;
+    size_t end = offset + size;
+    size_t pos = offset;
+    auto it = file->extents_.upper_bound(offset);
+    if (it != file->extents_.begin() && std::prev(it)->second.end_ > offset) {
+      --it;
+    }
+    for (; it != file->extents_.end() && it->first < end; ++it) {
+      if (it->first > pos) {
+        gaps.emplace_back(pos, it->first);
+      }
+      pos = std::max(pos, it->second.end_);
+    }
+    if (pos < end) {
+      gaps.emplace_back(pos, end);
+    }
+
+    size_t promoted = 0;
+    for (auto &gap : gaps) {
+      auto mem = std::make_shared<std::vector<char>>(gap.second - gap.first);
+      ssize_t ret = PfsRead(path, mem->data(), mem->size(), gap.first);
+      if (ret <= 0) {
+        break;
+      }
+      size_t len = ret;
+      mem->resize(len);
+      Extent ext{gap.first + len, dtio::LocationType::kBuffers, mem, 0, false};
+      if (!Reserve(dtio::LocationType::kBuffers, len)) {
+        if (!Reserve(dtio::LocationType::kCache, len)) {
+          break;
+        }
+        if (PosixWrite(CachePath(path), mem->data(), len, gap.first) !=
+            static_cast<ssize_t>(len)) {
+          Release(dtio::LocationType::kCache, len);
+          break;
+        }
+        ext.tier_ = dtio::LocationType::kCache;
+        ext.mem_ = nullptr;
+      }
+      file->extents_.emplace(gap.first, ext);
+      promoted += len;
+      if (len < gap.second - gap.first) {
+        break;  // The end of the file
+      }
+    }
+    Prune(path, *file);
+    return promoted;
+  }
+
+  /**
+   * Drop the clean copies within [@offset, @offset + @size) of @path.
+   * Returns the bytes dropped.
+   * */
+  size_t Demote(const std::string &path, size_t offset, size_t size) {
+    std::shared_ptr<FileTiers> file = GetFile(path, false);
+    if (!file) {
+      return 0;
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    std::vector<std::pair<size_t, size_t>> clean;
+    size_t end = offset + size;
+    auto it = file->extents_.upper_bound(offset);
+    if (it != file->extents_.begin() && std::prev(it)->second.end_ > offset) {
+      --it;
+    }
+    for (; it != file->extents_.end() && it->first < end; ++it) {
+      if (!it->second.dirty_) {
+        clean.emplace_back(std::max(it->first, offset),
+                           std::min(it->second.end_, end));
+      }
+    }
+    size_t dropped = 0;
+    for (auto &range : clean) {
+      Carve(*file, range.first, range.second);
+      dropped += range.second - range.first;
+    }
+    Prune(path, *file);
+    return dropped;
+  }
+
+  /**
+   * Drop what @path holds at or past @size, since the file was truncated
+   * there or, at 0, unlinked. Dirty data dropped is never drained. Returns
+   * whether anything was held for @path.
+   * */
+  bool Discard(const std::string &path, size_t size) {
+    std::shared_ptr<FileTiers> file = GetFile(path, false);
+    if (!file) {
+      return false;
+    }
+    std::lock_guard<std::mutex> guard(file->lock_);
+    bool held = !file->extents_.empty();
+    Carve(*file, size, SIZE_MAX);
+    file->drain_pos_ = std::min(file->drain_pos_, size);
+    if (!file->extents_.empty() &&
+        capacity_[Index(dtio::LocationType::kCache)]) {
+      truncate(CachePath(path).c_str(), size);
+    }
+    Prune(path, *file);
+    return held;
+  }
+
+  /**
+   * Drain up to about @budget bytes of @path to the PFS. Returns the bytes
+   * drained, which is 0 once nothing is held or the PFS fails.
+   * */
+  size_t DrainFile(const std::string &path, size_t budget) {
+    std::shared_ptr<FileTiers> file = GetFile(path, false);
+    if (!file) {
+      return 0;
+    }
+    size_t drained = 0;
+    while (drained < budget) {
+      std::lock_guard<std::mutex> guard(file->lock_);
+      size_t ret = DrainOnce(path, *file);
+      if (!ret) {
+        break;
+      }
+      drained += ret;
+    }
+    return drained;
+  }
+
+  /**
+   * Drain up to about @budget bytes over all files, taking one write from
+   * each file in turn. Returns the bytes drained.
+   * */
+  size_t Drain(size_t budget) {
+    std::vector<std::string> paths = HeldPaths();
+    size_t drained = 0;
+    bool progress = true;
+    while (drained < budget && progress) {
+      progress = false;
+      for (size_t i = 0; i < paths.size() && drained < budget; ++i) {
+        size_t ret = DrainFile(paths[(drain_next_ + i) % paths.size()], 1);
+        drained += ret;
+        progress |= ret > 0;
+      }
+      drain_next_ += 1;
+    }
+    return drained;
+  }
+
+  /** Move everything held above the PFS down to it */
+  void FlushAll() {
+    for (const std::string &path : HeldPaths()) {
+      DrainFile(path, SIZE_MAX);
+    }
+  }
+
+  /** How far @path has been drained, or all files if it is empty */
+  StageProgress Progress(const std::string &path) {
+    StageProgress progress;
+    if (path.empty()) {
+      progress.held_bytes_ = Held();
+      progress.drained_bytes_ = drained_.load();
+      return progress;
+    }
+    std::shared_ptr<FileTiers> file = GetFile(path, false);
+    if (file) {
+      std::lock_guard<std::mutex> guard(file->lock_);
+      progress.held_bytes_ = file->held_;
+      progress.drained_bytes_ = file->drained_;
+      if (!file->extents_.empty()) {
+        progress.held_end_ = file->extents_.rbegin()->second.end_;
+      }
+    }
+    return progress;
+  }
+
+  /**
+   * Free memory once it is filled past kHighWater, until it is down to
+   * kLowWater: clean extents first, then up to about @budget bytes of dirty
+   * ones moved down. Also samples the eviction rates at time @now. Returns
+   * the bytes freed.
+   * */
+  size_t Relieve(size_t budget, u64 now) {
+    SampleRates(now);
+    size_t capacity = capacity_[Index(dtio::LocationType::kBuffers)];
+    size_t used = Used(dtio::LocationType::kBuffers);
+    size_t target = kLowWater * capacity;
+    if (used > kHighWater * capacity) {
+      relieving_ = true;
+    }
+    if (!relieving_ || used <= target) {
+      relieving_ = false;
+      return 0;
+    }
+    size_t freed = Evict(target, SIZE_MAX, nullptr, false);
+    if (Used(dtio::LocationType::kBuffers) > target) {
+      freed += Evict(target, budget, nullptr, true);
+    }
+    relieving_ = Used(dtio::LocationType::kBuffers) > target;
+    return freed;
+  }
+
+  /** Occupancy of the tiers and how data has been moved out of memory */
+  TierStats Stats() const {
+    TierStats stats;
+    size_t buffers = Index(dtio::LocationType::kBuffers);
+    size_t cache = Index(dtio::LocationType::kCache);
+    stats.buffers_capacity_ = capacity_[buffers];
+    stats.buffers_used_ = used_[buffers].load();
+    stats.buffers_dirty_ = dirty_bytes_[buffers].load();
+    stats.cache_capacity_ = capacity_[cache];
+    stats.cache_used_ = used_[cache].load();
+    stats.cache_dirty_ = dirty_bytes_[cache].load();
+    stats.evicted_bytes_ = evicted_.load();
+    stats.demoted_bytes_ = demoted_.load();
+    stats.written_back_bytes_ = written_back_.load();
+    stats.stalls_ = stalls_.load();
+    stats.evict_rate_ = evict_rate_.load();
+    stats.writeback_rate_ = writeback_rate_.load();
+    return stats;
+  }
+
+  /** Written bytes held above the PFS over all files */
+  size_t Held() const { return held_.load(); }
+
+  /** Whether a tier is filled past kHighWater */
+  bool Pressured() const {
+    for (size_t i = 0; i < kNumTiers; ++i) {
+      if (capacity_[i] && used_[i].load() > kHighWater * capacity_[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  /**
+   * A range of a file held above the PFS. Memory extents share the buffer
+   * they were written in, so splitting one copies nothing.
+   * */
+  struct Extent {
+    size_t end_;
+    dtio::LocationType tier_;
+    std::shared_ptr<std::vector<char>> mem_;
+    size_t mem_off_; /**< Where the extent's first byte is in mem_ */
+    bool dirty_ = true; /**< Newer than the PFS, so it must be drained */
+    bool referenced_ = true; /**< Used since the CLOCK hand last passed */
+  };
+
+  /** The extents of one file, by offset */
+  struct FileTiers {
+    std::mutex lock_;
+    std::map<size_t, Extent> extents_;
+    size_t held_ = 0;      /**< Bytes in dirty extents_ */
+    u64 drained_ = 0;      /**< Bytes drained to the PFS */
+    size_t drain_pos_ = 0; /**< Where the last drain ended */
+    bool removed_ = false; /**< Pruned from files_, so no longer used */
+  };
+
+  static size_t Index(dtio::LocationType tier) {
+    return static_cast<size_t>(tier);
+  }
+
+  std::shared_ptr<FileTiers> GetFile(const std::string &path, bool create) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = files_.find(path);
+    if (it != files_.end()) {
+      return it->second;
+    }
+    if (!create) {
+      return nullptr;
+    }
+    return files_.emplace(path, std::make_shared<FileTiers>()).first->second;
+  }
+
+  /**
+   * Lock @path's extents into @guard, creating them if need be. Extents
+   * pruned while the lock was awaited are replaced by fresh ones.
+   * */
+  std::shared_ptr<FileTiers> LockFile(const std::string &path,
+                                      std::unique_lock<std::mutex> &guard) {
+    while (true) {
+      std::shared_ptr<FileTiers> file = GetFile(path, true);
+      guard = std::unique_lock<std::mutex>(file->lock_);
+      if (!file->removed_) {
+        return file;
+      }
+      guard.unlock();
+    }
+  }
+
+  /**
+   * Forget @file once it holds nothing, along with its cache file.
+   * Requires @file's lock. Takes lock_, so lock_ is never held while
+   * waiting on a file's lock.
+   * */
+  void Prune(const std::string &path, FileTiers &file) {
+    if (!file.extents_.empty() || file.removed_) {
+      return;
+    }
+    if (capacity_[Index(dtio::LocationType::kCache)]) {
+      unlink(CachePath(path).c_str());
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = files_.find(path);
+    if (it != files_.end() && it->second.get() == &file) {
+      files_.erase(it);
+    }
+    file.removed_ = true;
+  }
+
+  /** Claim @size bytes of @tier, if it has room */
+  bool Reserve(dtio::LocationType tier, size_t size) {
+    size_t capacity = capacity_[Index(tier)];
+    std::atomic<size_t> &used = used_[Index(tier)];
+    size_t cur = used.load();
+    do {
+      if (!capacity || cur + size > capacity) {
+        return false;
+      }
+    } while (!used.compare_exchange_weak(cur, cur + size));
+    return true;
+  }
+
+  void Release(dtio::LocationType tier, size_t size) {
+    used_[Index(tier)] -= size;
+  }
+
+  /**
+   * Claim @size bytes of memory for a write to @held, whose lock the caller
+   * holds, evicting clean extents and then moving dirty ones down if it is
+   * full. Returns false if it still has no room.
+   * */
+  bool MakeRoom(size_t size, FileTiers *held) {
+    if (Reserve(dtio::LocationType::kBuffers, size)) {
+      return true;
+    }
+    size_t capacity = capacity_[Index(dtio::LocationType::kBuffers)];
+    if (!capacity || size > capacity) {
+      return false;
+    }
+    for (bool dirty : {false, true}) {
+      Evict(capacity - size, SIZE_MAX, held, dirty);
+      if (Reserve(dtio::LocationType::kBuffers, size)) {
+        return true;
+      }
+    }
+    stalls_ += 1;
+    return false;
+  }
+
+  /**
+   * Sweep the CLOCK hand over the memory extents of every file until memory
+   * is down to @target bytes or about @budget bytes have been freed. Only
+   * clean extents are dropped unless @dirty, when dirty ones are moved down
+   * instead. @held is a file whose lock the caller holds. Other files busy
+   * with I/O are skipped. Returns the bytes freed.
+   * */
+  size_t Evict(size_t target, size_t budget, FileTiers *held, bool dirty) {
+    std::lock_guard<std::mutex> clock_guard(clock_lock_);
+    std::vector<std::string> paths = HeldPaths();
+    size_t freed = 0;
+    // Up to two turns, since the first may only clear reference bits
+    for (size_t visit = 0; !paths.empty() && visit <= 2 * paths.size();
+         ++visit) {
+      const std::string &path = paths[clock_file_ % paths.size()];
+      std::shared_ptr<FileTiers> file = GetFile(path, false);
+      if (!file) {
+        clock_file_ += 1;
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(file->lock_, std::defer_lock);
+      if (file.get() == held || lock.try_lock()) {
+        bool done = !Sweep(path, *file, target, budget, dirty, freed);
+        if (file.get() != held) {
+          // The file being written to is about to hold its write
+          Prune(path, *file);
+        }
+        if (done) {
+          break;
+        }
+      }
+      clock_file_ += 1;
+    }
+    return freed;
+  }
+
+  /**
+   * Advance the CLOCK hand over @file's memory extents, adding the bytes
+   * freed to @freed. Returns false if it stopped inside the file, since
+   * Evict's goal was met. Requires @file's lock.
+   * */
+  bool Sweep(const std::string &path, FileTiers &file, size_t target,
+             size_t budget, bool dirty, size_t &freed) {
+    size_t pos = path == clock_path_ ? clock_pos_ : 0;
+    clock_path_ = path;
+    clock_pos_ = 0;
+    auto it = file.extents_.lower_bound(pos);
+    while (it != file.extents_.end()) {
+      if (Used(dtio::LocationType::kBuffers) <= target || freed >= budget) {
+        clock_pos_ = it->first;
+        return false;
+      }
+      size_t begin = it->first;
+      Extent &ext = it->second;
+      size_t len = ext.end_ - begin;
+      if (ext.tier_ != dtio::LocationType::kBuffers || (ext.dirty_ && !dirty)) {
+        ++it;
+        continue;
+      }
+      if (ext.referenced_) {
+        ext.referenced_ = false;  // A second chance
+        ++it;
+        continue;
+      }
+      if (!ext.dirty_) {
+        Carve(file, begin, begin + len);
+        evicted_ += len;
+      } else if (!MoveDown(path, file, begin)) {
+        ++it;
+        continue;
+      }
+      freed += len;
+      it = file.extents_.lower_bound(begin + len);
+    }
+    return true;
+  }
+
+  /**
+   * Move @file's dirty memory extent at @begin to the cache tier, or write
+   * it back to the PFS if the cache has no room. Returns false if neither
+   * worked. Requires @file's lock.
+   * */
+  bool MoveDown(const std::string &path, FileTiers &file, size_t begin) {
+    Extent &ext = file.extents_.at(begin);
+    size_t len = ext.end_ - begin;
+    const char *data = ext.mem_->data() + ext.mem_off_;
+    if (Reserve(dtio::LocationType::kCache, len)) {
+      if (PosixWrite(CachePath(path), data, len, begin) ==
+          static_cast<ssize_t>(len)) {
+        ext.tier_ = dtio::LocationType::kCache;
+        ext.mem_ = nullptr;
+        ext.mem_off_ = 0;
+        Release(dtio::LocationType::kBuffers, len);
+        dirty_bytes_[Index(dtio::LocationType::kBuffers)] -= len;
+        dirty_bytes_[Index(dtio::LocationType::kCache)] += len;
+        demoted_ += len;
+        return true;
+      }
+      Release(dtio::LocationType::kCache, len);
+    }
+    if (PfsWrite(path, data, len, begin) != static_cast<ssize_t>(len)) {
+      return false;
+    }
+    Carve(file, begin, begin + len);
+    file.drained_ += len;
+    drained_ += len;
+    written_back_ += len;
+    return true;
+  }
+
+  /** Turn the eviction counters into rates, once per kRatePeriodNs */
+  void SampleRates(u64 now) {
+    if (now - rate_time_ < kRatePeriodNs) {
+      return;
+    }
+    u64 evicted = evicted_.load();
+    u64 moved = demoted_.load() + written_back_.load();
+    if (rate_time_) {
+      double secs = (now - rate_time_) / 1e9;
+      evict_rate_ = (evicted - rate_evicted_) / secs;
+      writeback_rate_ = (moved - rate_moved_) / secs;
+    }
+    rate_time_ = now;
+    rate_evicted_ = evicted;
+    rate_moved_ = moved;
+  }
+
+  /** The files that may have data held above the PFS */
+  std::vector<std::string> HeldPaths() {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::vector<std::string> paths;
+    for (auto &entry : files_) {
+      paths.emplace_back(entry.first);
+    }
+    return paths;
+  }
+
+  /**
+   * Write the next run of @file's dirty extents at or after its drain
+   * position to the PFS, wrapping around at the end. Returns the bytes
+   * drained, or 0 if nothing is held or the write failed. Requires @file's
+   * lock.
+   * */
+  size_t DrainOnce(const std::string &path, FileTiers &file) {
+    if (!file.held_) {
+      return 0;
+    }
+    auto it = NextDirty(file, file.extents_.lower_bound(file.drain_pos_));
+    if (it == file.extents_.end()) {
+      it = NextDirty(file, file.extents_.begin());
+    }
+    // Coalesce adjacent extents, cut at a multiple of drain_align_
+    size_t begin = it->first;
+    size_t end = begin + kDrainSize;
+    size_t run_end = begin;
+    for (auto run = it; run != file.extents_.end() && run->first == run_end &&
+                        run->second.dirty_ && run_end < end;
+         ++run) {
+      run_end = run->second.end_;
+    }
+    if (run_end < end) {
+      end = run_end;
+    } else {
+      size_t aligned = end - end % config_.drain_align_;
+      end = aligned > begin ? aligned : end;
+    }
+
+    std::vector<char> buf(end - begin);
+    for (auto run = it; run != file.extents_.end() && run->first < end;
+         ++run) {
+      size_t len = std::min(run->second.end_, end) - run->first;
+      if (ReadExtent(path, run->first, run->second, run->first,
+                     buf.data() + (run->first - begin), len) < 0) {
+        return 0;
+      }
+    }
+    if (PfsWrite(path, buf.data(), buf.size(), begin) !=
+        static_cast<ssize_t>(buf.size())) {
+      return 0;
+    }
+    Carve(file, begin, end);
+    file.drained_ += end - begin;
+    drained_ += end - begin;
+    file.drain_pos_ = end;
+    Prune(path, file);
+    return end - begin;
+  }
+
+  /** The first dirty extent of @file at or after @it */
+  static std::map<size_t, Extent>::iterator NextDirty(
+      FileTiers &file, std::map<size_t, Extent>::iterator it) {
+    while (it != file.extents_.end() && !it->second.dirty_) {
+      ++it;
+    }
+    return it;
+  }
+
+  /** Drop the parts of @file's extents within [@begin, @end) */
+  void Carve(FileTiers &file, size_t begin, size_t end) {
+    auto it = file.extents_.upper_bound(begin);
+    if (it != file.extents_.begin() && std::prev(it)->second.end_ > begin) {
+      --it;
+    }
+    while (it != file.extents_.end() && it->first < end) {
+      size_t ext_begin = it->first;
+      Extent ext = it->second;
+      it = file.extents_.erase(it);
+      size_t cut = std::min(ext.end_, end) - std::max(ext_begin, begin);
+      Release(ext.tier_, cut);
+      if (ext.dirty_) {
+        file.held_ -= cut;
+        held_ -= cut;
+        dirty_bytes_[Index(ext.tier_)] -= cut;
+      }
+      if (ext_begin < begin) {
+        Extent left = ext;
+        left.end_ = begin;
+        file.extents_.emplace(ext_begin, left);
+      }
+      if (ext.end_ > end) {
+        Extent right = ext;
+        right.mem_off_ += end - ext_begin;
+        it = file.extents_.emplace(end, right).first;
+        break;
+      }
+    }
+  }
+
+  /** Record @ext at @begin, replacing what it overwrites */
+  void Insert(FileTiers &file, size_t begin, const Extent &ext) {
+    Carve(file, begin, ext.end_);
+    file.extents_.emplace(begin, ext);
+    if (ext.dirty_) {
+      file.held_ += ext.end_ - begin;
+      held_ += ext.end_ - begin;
+      dirty_bytes_[Index(ext.tier_)] += ext.end_ - begin;
+    }
+  }
+
+  /** Copy [@pos, @pos + @len) of @ext, which starts at @begin, into @out */
+  ssize_t ReadExtent(const std::string &path, size_t begin, const Extent &ext,
+                     size_t pos, char *out, size_t len) {
+    if (ext.tier_ == dtio::LocationType::kBuffers) {
+      memcpy(out, ext.mem_->data() + ext.mem_off_ + (pos - begin), len);
+      return len;
+    }
+    ssize_t ret = PosixRead(CachePath(path), out, len, pos);
+    if (ret < 0) {
+      return -1;
+    }
+    memset(out + ret, 0, len - ret);
+    return len;
+  }
+
+  /** The file holding @path's data on the cache tier */
+  std::string CachePath(const std::string &path) const {
+    return config_.cache_dir_ + "/" +
+           std::to_string(std::hash<std::string>{}(path)) + ".dtio";
+  }
+
+  ssize_t PfsWrite(const std::string &path, const char *data, size_t size,
+                   size_t offset) {
+    return pfs_write_ ? pfs_write_(path, data, size, offset)
+                      : PosixWrite(path, data, size, offset);
+  }
+
+  ssize_t PfsRead(const std::string &path, char *data, size_t size,
+                  size_t offset) {
+    return pfs_read_ ? pfs_read_(path, data, size, offset)
+                     : PosixRead(path, data, size, offset);
+  }
+
+  static ssize_t PosixWrite(const std::string &path, const char *data,
+                            size_t size, size_t offset) {
+    int fd = open64(path.c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd < 0) {
+      return -1;
+    }
+    ssize_t ret = pwrite64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+
+  static ssize_t PosixRead(const std::string &path, char *data, size_t size,
+                           size_t offset) {
+    int fd = open64(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return errno == ENOENT ? 0 : -1;
+    }
+    ssize_t ret = pread64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+
+  TierConfig config_;
+  PfsWriteFn pfs_write_;
+  PfsReadFn pfs_read_;
+  size_t capacity_[kNumTiers] = {0};
+  std::atomic<size_t> used_[kNumTiers] = {};
+  std::mutex lock_;
+  std::unordered_map<std::string, std::shared_ptr<FileTiers>> files_;
+  size_t drain_next_ = 0; /**< The file Drain starts from */
+  std::atomic<u64> drained_{0};
+  std::atomic<size_t> held_{0}; /**< Bytes in dirty extents */
+  std::atomic<size_t> dirty_bytes_[kNumTiers] = {};
+  std::mutex clock_lock_;  /**< Held while the CLOCK hand moves */
+  size_t clock_file_ = 0;  /**< The file the hand is at */
+  std::string clock_path_; /**< The file the hand stopped inside, if any */
+  size_t clock_pos_ = 0;   /**< The offset it stopped at */
+  bool relieving_ = false; /**< Memory passed kHighWater */
+  std::atomic<u64> evicted_{0};
+  std::atomic<u64> demoted_{0};
+  std::atomic<u64> written_back_{0};
+  std::atomic<u64> stalls_{0};
+  u64 rate_time_ = 0; /**< When the rates were last sampled */
+  u64 rate_evicted_ = 0;
+  u64 rate_moved_ = 0;
+  std::atomic<u64> evict_rate_{0};
+  std::atomic<u64> writeback_rate_{0};
+};
+
+}  // namespace chi::dtiomod
+
+#endif  // CHI_dtiomod_TIERS_H_
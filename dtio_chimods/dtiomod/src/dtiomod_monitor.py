@@ -1,16 +1,18 @@
 """
-This file is not strictly required. You can use it to build
-your monitoring functions for that task. Otherwise, if you
-delete, please remove the corresponding CMake line that
-installs it.
+Offline counterpart of the cost model in dtiomod_cost.h. The runtime fits
+the same model online from its kSampleLoad monitor hooks. This residual can
+be handed to scipy.optimize.least_squares to fit a trace of I/O samples,
+e.g., to pick a starting point or check what the runtime learned.
 
-This skeleton does not actually call this file right now.
-More detailed examples on how to use Python for monitoring
-in Chimaera are in tasks/small_message.
+Each row of x is one I/O: size in bytes, queue depth, and whether it was
+sequential. y is its latency in microseconds.
 """
 class dtiomod:
     @staticmethod
     def monitor_io(params, x, y):
-        io_size = x[:, 0]
-        y_pred = params[0] * io_size
+        io_mb = x[:, 0] / (1 << 20)
+        depth = x[:, 1]
+        random = 1 - x[:, 2]
+        y_pred = params[0] + params[1] * io_mb + params[2] * depth + \
+            params[3] * random
         return y_pred - y
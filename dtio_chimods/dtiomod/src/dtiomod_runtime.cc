@@ -10,21 +10,111 @@
  * have access to the file, you may request a copy from help@hdfgroup.org.   *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
 #include "chimaera/api/chimaera_runtime.h"
 #include "chimaera/monitor/monitor.h"
 #include "chimaera_admin/chimaera_admin_client.h"
 #include "dtio/dtio_enumerations.h"
 #include "dtiomod/dtiomod_client.h"
+#include "dtiomod/dtiomod_cost.h"
+#include "dtiomod/dtiomod_lanes.h"
+#include "dtiomod/dtiomod_locality.h"
+#include "dtiomod/dtiomod_chunks.h"
+#include "dtiomod/dtiomod_heat.h"
+#include "dtiomod/dtiomod_logs.h"
+#include "dtiomod/dtiomod_memory.h"
+#include "dtiomod/dtiomod_packs.h"
+#include "dtiomod/dtiomod_qos.h"
+#include "dtiomod/dtiomod_scheduler.h"
+#include "dtiomod/dtiomod_tiers.h"
 
 namespace chi::dtiomod {
 
 class Server : public Module {
  public:
   CLS_CONST LaneGroupId kDefaultGroup = 0;
+  /** Half-life of the bytes charged to a container by the scheduler */
+  CLS_CONST double kLoadHalfLifeMs = 100;
+  /** Reports older than this many stats periods are ignored */
+  CLS_CONST u64 kStaleReports = 5;
+  /** Slowdown a read accepts to stay on the container holding its data */
+  CLS_CONST double kLocalitySlack = 2;
+  /** Weight of the newest sample in the throughput EWMA */
+  CLS_CONST double kThroughputAlpha = 0.25;
+  /** How often held data is drained to the PFS and hot data copied up */
+  CLS_CONST u32 kStagingPeriodMs = 10;
+  /** Most bytes drained per staging period */
+  CLS_CONST size_t kDrainBatch = 4 * TierManager::kDrainSize;
+  /** Bytes a copy moves between yields */
+  CLS_CONST size_t kCopyStep = MEGABYTES(8);
+  /** Bytes moved through the pipe per splice */
+  CLS_CONST size_t kSpliceSize = KILOBYTES(64);
 
  public:
   std::unordered_map<std::string, std::string> metamap;
-  size_t schedule_num;
+  Client client_;
+  std::unique_ptr<Scheduler> scheduler_;
+  std::vector<ContainerLoad> loads_;
+  /** Bytes placed on each container since its last report */
+  std::vector<double> placed_;
+  std::vector<u64> report_stamp_;
+  std::chrono::steady_clock::time_point loads_time_;
+  WorkerStatsTable stats_table_;
+  /** Which container holds each extent written through the pool */
+  ExtentMap extents_;
+  /** Extents this container wrote since its last report to container 0 */
+  std::mutex written_lock_;
+  ExtentMap written_;
+  size_t stripe_size_;
+  /** Orders I/O across clients and enforces class rate limits */
+  QosGate qos_;
+  /** Spreads I/O over lanes, keeping each file's tasks in order */
+  LaneBalancer lanes_;
+  /** Grows and shrinks the lanes in use with the load */
+  LaneScaler lane_scaler_;
+  /** Places written data on memory, a local directory, or the PFS */
+  TierManager tiers_;
+  /** Paces draining held data to the PFS */
+  TokenBucket drain_bucket_;
+  /** Copies read-hot blocks up onto the tiers and drops cold ones */
+  TierMover mover_;
+  /** Stores the chunks of files this container owns, when files are chunked */
+  ChunkStore chunks_;
+  /** Appends writes to this container's logs, when files are log-structured */
+  LogStore logs_;
+  /** Packs the small files whose names hash to this container */
+  PackStore packs_;
+  /** Keeps the files kept in memory whose names hash to this container */
+  MemoryStore memory_;
+  /** Predicts I/O latency on the storage under this container */
+  CostModel cost_;
+  u32 stats_period_ms_;
+  u32 elevator_window_;
+  size_t buffer_capacity_;
+
+  /** Load on this container */
+  std::atomic<i64> queue_depth_{0};
+  std::atomic<i64> inflight_bytes_{0};
+  std::atomic<u64> bytes_done_{0};
+  std::atomic<u64> busy_ns_{0};
+  /** Bytes in flight on this container per client */
+  std::mutex client_inflight_lock_;
+  std::unordered_map<u64, u64> client_inflight_;
+  u64 last_bytes_done_ = 0;
+  u64 last_busy_ns_ = 0;
+  u64 last_collect_ns_ = 0;
+  double throughput_ = 0;
 
   Server() = default;
 
@@ -32,30 +122,203 @@ class Server : public Module {
   /** Construct dtiomod */
   void Create(CreateTask *task, RunContext &rctx) {
     // Create a set of lanes for holding tasks
-    schedule_num = 0;
-    CreateLaneGroup(kDefaultGroup, 1, QUEUE_LOW_LATENCY);
+    CreateTaskParams params = task->GetParams();
+    u32 num_lanes = std::max<u32>(params.lanes_, 1);
+    CreateLaneGroup(kDefaultGroup, num_lanes, QUEUE_LOW_LATENCY);
+    lanes_.Resize(num_lanes);
+    lane_scaler_.Configure(params.min_lanes_, num_lanes);
+    lanes_.SetActive(lane_scaler_.Active());
+
+    // Placement policy, used by container 0 to answer Schedule tasks
+    scheduler_ = Scheduler::Create(params.solver_);
+    size_t num_containers = std::max<u32>(task->ctx_.global_containers_, 1);
+    loads_.resize(num_containers);
+    placed_.assign(num_containers, 0);
+    report_stamp_.assign(num_containers, 0);
+    loads_time_ = std::chrono::steady_clock::now();
+    stats_table_.Resize(num_containers);
+    stripe_size_ = std::max<size_t>(params.stripe_size_, 1);
+    if (params.chunk_size_) {
+      // Chunks are homed like stripes, so each is owned by its home
+      stripe_size_ = params.chunk_size_;
+      chunks_.Configure(params.chunk_size_);
+    }
+    qos_.Configure(params.qos_classes_, params.elevator_window_);
+    elevator_window_ = params.elevator_window_;
+    TierConfig tiers;
+    tiers.buffers_capacity_ = params.tier_buffers_capacity_;
+    tiers.cache_dir_ = params.tier_cache_dir_;
+    tiers.cache_capacity_ = params.tier_cache_capacity_;
+    tiers.drain_align_ = stripe_size_;
+    tiers_.Configure(tiers);
+    if (chunks_.Enabled()) {
+      tiers_.SetPfs(
+          [this](const std::string &path, const char *data, size_t size,
+                 size_t offset) {
+            return chunks_.Write(path, offset, data, size);
+          },
+          [this](const std::string &path, char *data, size_t size,
+                 size_t offset) {
+            return chunks_.Read(path, offset, data, size);
+          });
+    }
+    drain_bucket_.Configure(params.drain_rate_);
+    logs_.Configure(params.log_structured_, container_id_, &tiers_);
+    packs_.Configure(params.pack_dir_, container_id_);
+    memory_.Configure(params.memory_capacity_);
+    if (tiers_.Enabled()) {
+      mover_.Configure(params.tier_policy_, stripe_size_);
+    }
+
+    // Report the load on this container periodically
+    stats_period_ms_ = params.stats_period_ms_;
+    buffer_capacity_ = params.buffer_capacity_;
+    client_.Init(pool_id_);
+    client_.AsyncCollectStats(
+        HSHM_MCTX,
+        chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
+                                        container_id_),
+        stats_period_ms_);
+    if (tiers_.Enabled() || logs_.Enabled() || memory_.Enabled() ||
+        packs_.Enabled()) {
+      client_.AsyncStaging(
+          HSHM_MCTX,
+          chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
+                                          container_id_),
+          kStagingPeriodMs);
+    }
   }
   void MonitorCreate(MonitorModeId mode, CreateTask *task, RunContext &rctx) {}
   CHI_END(Create)
 
   /** Route a task to a lane */
   Lane *MapTaskToLane(const Task *task) override {
-    // Route tasks to lanes based on their properties
-    // E.g., a strongly consistent filesystem could map tasks to a lane
-    // by the hash of an absolute filename path.
+    // Every I/O task is mapped once as it is queued on this container
+    IoDesc io;
+    if (GetIoDesc(task, io)) {
+      queue_depth_ += 1;
+      inflight_bytes_ += io.size_;
+      ChargeClient(io.opts_.client_, io.size_, true);
+      qos_.Enqueue(task, io);
+      bool is_read =
+          task->method_ == Method::kRead || task->method_ == Method::kReadV;
+      return GetLaneByHash(kDefaultGroup, task->prio_,
+                           lanes_.Map(task, io.file_, is_read));
+    }
     return GetLaneByHash(kDefaultGroup, task->prio_, 0);
   }
 
+  /** Describe @task to the QoS gate, if it is an I/O task */
+  static bool GetIoDesc(const Task *task, IoDesc &io) {
+    switch (task->method_) {
+      case Method::kWrite:
+        return MakeIoDesc(static_cast<const WriteTask *>(task), io);
+      case Method::kRead:
+        return MakeIoDesc(static_cast<const ReadTask *>(task), io);
+      case Method::kWriteV:
+        return MakeIoDesc(static_cast<const WriteVTask *>(task), io);
+      case Method::kReadV:
+        return MakeIoDesc(static_cast<const ReadVTask *>(task), io);
+      default:
+        return false;
+    }
+  }
+  template <typename TaskT>
+  static bool MakeIoDesc(const TaskT *task, IoDesc &io) {
+    io.opts_ = task->opts_;
+    io.size_ = task->data_size_;
+    io.file_ = std::hash<std::string>{}(task->filename_.str());
+    io.offset_ = task->data_offset_;
+    return true;
+  }
+
+  /** Hold @task until the QoS gate lets it start */
+  template <typename TaskT>
+  void Admit(TaskT *task) {
+    IoDesc io;
+    MakeIoDesc(task, io);
+    while (!qos_.TryDispatch(task, io)) {
+      task->Yield();
+    }
+  }
+
+  /** Add or remove @size bytes in flight for @client */
+  void ChargeClient(u64 client, u64 size, bool add) {
+    std::lock_guard<std::mutex> guard(client_inflight_lock_);
+    u64 &bytes = client_inflight_[client];
+    if (add) {
+      bytes += size;
+    } else if ((bytes -= std::min(bytes, size)) == 0) {
+      client_inflight_.erase(client);
+    }
+  }
+
+  /** What the cost model sees of @task */
+  template <typename TaskT>
+  IoFeatures MakeFeatures(const TaskT *task) {
+    IoFeatures features;
+    features.size_ = task->data_size_;
+    features.is_read_ =
+        task->method_ == Method::kRead || task->method_ == Method::kReadV;
+    features.iface_ = task->iface_;
+    features.depth_ = std::max<i64>(queue_depth_.load(), 0);
+    features.sequential_ =
+        cost_.Sequential(std::hash<std::string>{}(task->filename_.str()),
+                         task->data_offset_, task->data_size_);
+    return features;
+  }
+
+  /**
+   * Charges an I/O task's service time to this container's load, and
+   * samples it for the cost model through the task's monitor hook.
+   * */
+  class IoScope {
+   public:
+    template <typename TaskT>
+    IoScope(Server *server, TaskT *task, RunContext &rctx)
+        : server_(server),
+          task_(task),
+          rctx_(rctx),
+          client_(task->opts_.client_),
+          size_(task->data_size_),
+          start_ns_(WorkerStatsTable::NowNs()) {
+      server_->cost_.Start(task, server_->MakeFeatures(task), start_ns_);
+    }
+
+    ~IoScope() {
+      server_->Monitor(MonitorMode::kSampleLoad, task_->method_, task_, rctx_);
+      server_->lanes_.Done(task_);
+      server_->ChargeClient(client_, size_, false);
+      server_->busy_ns_ += WorkerStatsTable::NowNs() - start_ns_;
+      server_->bytes_done_ += size_;
+      server_->queue_depth_ -= 1;
+      server_->inflight_bytes_ -= size_;
+    }
+
+   private:
+    Server *server_;
+    Task *task_;
+    RunContext &rctx_;
+    u64 client_;
+    size_t size_;
+    u64 start_ns_;
+  };
+
   CHI_BEGIN(Destroy)
   /** Destroy dtiomod */
-  void Destroy(DestroyTask *task, RunContext &rctx) {}
+  void Destroy(DestroyTask *task, RunContext &rctx) {
+    logs_.SyncAll();
+    memory_.PersistAll();
+    tiers_.FlushAll();
+  }
   void MonitorDestroy(MonitorModeId mode, DestroyTask *task, RunContext &rctx) {
   }
   CHI_END(Destroy)
 
   CHI_BEGIN(Write)
   void Write(WriteTask *task, RunContext &rctx) {
-    printf("DTIO chimod write\n");
+    Admit(task);
+    IoScope io_scope(this, task, rctx);
     // So, we should have multiple clients and pass to the appropriate one based
     // off of a DTIOMOD configuration. For now, let's simply assume POSIX. Add
     // more later.
@@ -68,6 +331,31 @@ class Server : public Module {
                                ? filepath_str.substr(7)
                                : filepath_str;
 
+    // A file kept in memory is served there, unless it was persisted
+    if (IsMemoryName(filepath)) {
+      filepath = MemoryPath(filepath);
+      if (memory_.Write(filepath, task->data_offset_, data_, task->data_size_,
+                        task->ret_)) {
+        return;
+      }
+    }
+    if (logs_.Enabled()) {
+      task->ret_ = logs_.Write(filepath, task->data_offset_, data_,
+                               task->data_size_);
+      return;
+    }
+    if (tiers_.Enabled()) {
+      task->ret_ = tiers_.Write(
+          filepath, task->data_offset_, data_, task->data_size_,
+          static_cast<dtio::LocationType>(task->opts_.tier_));
+      return;
+    }
+    if (chunks_.Enabled()) {
+      task->ret_ = chunks_.Write(filepath, task->data_offset_, data_,
+                                 task->data_size_);
+      return;
+    }
+
     switch (task->iface_) {
       case dtio::IoClientType::kPosix: {
         int fd;
@@ -80,12 +368,14 @@ class Server : public Module {
         // }
         if (fd < 0) {
           std::cerr << "File " << filepath << " didn't open" << std::endl;
+          task->ret_ = -1;
+          return;
         }
         lseek64(fd, task->data_offset_, SEEK_SET);
         auto count = write(fd, data_, task->data_size_);
-        if (count != task->data_size_)
-          std::cerr << "written less" << count << "\n";
-
+        task->ret_ = count;
+        close(fd);
+        RecordWritten(filepath_str, task->data_offset_, task->ret_);
       } break;
       case dtio::IoClientType::kStdio: {
         FILE *fp;
@@ -98,18 +388,24 @@ class Server : public Module {
         // }
         if (fp == nullptr) {
           std::cerr << "File " << filepath << " didn't open" << std::endl;
+          task->ret_ = -1;
+          return;
         }
         fseek(fp, task->data_offset_, SEEK_SET);
         auto count = fwrite(data_, sizeof(char), task->data_size_, fp);
-        if (count != task->data_size_)
-          std::cerr << "written less" << count << "\n";
-
+        task->ret_ = count;
+        fclose(fp);
+        RecordWritten(filepath_str, task->data_offset_, task->ret_);
       } break;
     }
   }
 
   void MonitorWrite(MonitorModeId mode, WriteTask *task, RunContext &rctx) {
     switch (mode) {
+      case MonitorMode::kSampleLoad: {
+        cost_.Finish(task, WorkerStatsTable::NowNs());
+        return;
+      }
       case MonitorMode::kReplicaAgg: {
         std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
       }
@@ -120,6 +416,8 @@ class Server : public Module {
   CHI_BEGIN(Read)
   /** The Read method */
   void Read(ReadTask *task, RunContext &rctx) {
+    Admit(task);
+    IoScope io_scope(this, task, rctx);
     // So, we should have multiple clients and pass to the appropriate one based
     // off of a DTIOMOD configuration. For now, let's simply assume POSIX. Add
     // more later.
@@ -132,6 +430,34 @@ class Server : public Module {
                                ? filepath_str.substr(7)
                                : filepath_str;
 
+    // A file kept in memory is served there, unless it was persisted
+    if (IsMemoryName(filepath)) {
+      filepath = MemoryPath(filepath);
+      if (memory_.Read(filepath, task->data_offset_, data_, task->data_size_,
+                       task->ret_)) {
+        return;
+      }
+    }
+    if (logs_.Enabled()) {
+      task->ret_ = logs_.Read(filepath, task->data_offset_, data_,
+                              task->data_size_, WorkerStatsTable::NowNs());
+      return;
+    }
+    if (tiers_.Enabled()) {
+      task->ret_ = tiers_.Read(filepath, task->data_offset_, data_,
+                               task->data_size_);
+      if (task->opts_.cacheable_) {
+        mover_.Record(filepath, task->data_offset_, task->data_size_,
+                      WorkerStatsTable::NowNs());
+      }
+      return;
+    }
+    if (chunks_.Enabled()) {
+      task->ret_ = chunks_.Read(filepath, task->data_offset_, data_,
+                                task->data_size_);
+      return;
+    }
+
     switch (task->iface_) {
       case dtio::IoClientType::kPosix: {
         int fd;
@@ -144,12 +470,12 @@ class Server : public Module {
         // }
         if (fd < 0) {
           std::cerr << "File " << filepath << " didn't open" << std::endl;
+          task->ret_ = -1;
+          return;
         }
-        lseek64(fd, task->data_offset_, SEEK_SET);
-        auto count = read(fd, data_, task->data_size_);
-        if (count != task->data_size_)
-          std::cerr << "read less" << count << "\n";
-
+        // Short reads are expected at EOF (e.g., client readahead)
+        task->ret_ = pread64(fd, data_, task->data_size_, task->data_offset_);
+        close(fd);
       } break;
       case dtio::IoClientType::kStdio: {
         FILE *fp;
@@ -162,18 +488,22 @@ class Server : public Module {
         // }
         if (fp == nullptr) {
           std::cerr << "File " << filepath << " didn't open" << std::endl;
+          task->ret_ = -1;
+          return;
         }
         fseek(fp, task->data_offset_, SEEK_SET);
-        auto count = fread(data_, sizeof(char), task->data_size_, fp);
-        if (count != task->data_size_)
-          std::cerr << "read less" << count << "\n";
-
+        task->ret_ = fread(data_, sizeof(char), task->data_size_, fp);
+        fclose(fp);
       } break;
     }
   }
 
   void MonitorRead(MonitorModeId mode, ReadTask *task, RunContext &rctx) {
     switch (mode) {
+      case MonitorMode::kSampleLoad: {
+        cost_.Finish(task, WorkerStatsTable::NowNs());
+        return;
+      }
       case MonitorMode::kReplicaAgg: {
         std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
       }
@@ -254,7 +584,35 @@ class Server : public Module {
   CHI_BEGIN(Schedule)
   /** The Schedule method */
   void Schedule(ScheduleTask *task, RunContext &rctx) {
-    task->schedule_num_ = schedule_num++;
+    RefreshLoads();
+    std::vector<size_t> sizes(task->sizes_.begin(), task->sizes_.end());
+    std::vector<u32> placement(sizes.size());
+    std::vector<size_t> rest_sizes, rest_index;
+    bool located =
+        task->filename_.size() && task->offsets_.size() == sizes.size();
+    std::string filename = located ? task->filename_.str() : std::string();
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      if (located && PlaceNear(task->op_, filename, task->offsets_[i],
+                               sizes[i], placement[i])) {
+        loads_[placement[i]].Charge(sizes[i]);
+        continue;
+      }
+      rest_sizes.push_back(sizes[i]);
+      rest_index.push_back(i);
+    }
+    if (!rest_sizes.empty()) {
+      std::vector<u32> rest_placement;
+      scheduler_->Place(rest_sizes, loads_, rest_placement);
+      for (size_t k = 0; k < rest_index.size(); ++k) {
+        placement[rest_index[k]] = rest_placement[k];
+      }
+    }
+    task->placement_.reserve(placement.size());
+    for (size_t i = 0; i < placement.size(); ++i) {
+      task->placement_.emplace_back(placement[i]);
+      placed_[placement[i]] += sizes[i];
+    }
+    task->schedule_num_ = placement.empty() ? 0 : placement[0];
   }
   void MonitorSchedule(MonitorModeId mode, ScheduleTask *task,
                        RunContext &rctx) {
@@ -264,7 +622,969 @@ class Server : public Module {
       }
     }
   }
+
+  /**
+   * Place one I/O on a known file near its data, if its data has a place.
+   * When tiers are on, a stripe's reads and writes all go to its home, the
+   * one container that may hold it before it is drained. Otherwise a read
+   * goes to the container that wrote most of its range, unless that
+   * container is so loaded that another would finish well before it.
+   * Returns false for I/O the scheduler should place by load.
+   * */
+  bool PlaceNear(dtio::Operation op, const std::string &filename, size_t off,
+                 size_t size, u32 &container) {
+    if (tiers_.Enabled()) {
+      container = ExtentMap::Home(filename, off / stripe_size_, loads_.size());
+      return true;
+    }
+    if (op != dtio::Operation::kRead ||
+        !extents_.Owner(filename, off, size, container)) {
+      return false;
+    }
+    double fastest = loads_[0].FinishTime(size);
+    for (const ContainerLoad &load : loads_) {
+      fastest = std::min(fastest, load.FinishTime(size));
+    }
+    return loads_[container].FinishTime(size) <= kLocalitySlack * fastest;
+  }
+
+  /**
+   * Rebuild the scheduler's view of every container from the stats table.
+   * A container's queue is the bytes in flight at its last report plus what
+   * was placed on it since. Its capacity is the rate its cost model
+   * predicts, or its measured throughput until the model is warm. The
+   * model's fixed latency per I/O is charged to every task placed on it.
+   * Containers without a fresh report fall back to the bytes recently placed
+   * on them, aged with a fixed half-life, and the mean throughput.
+   * */
+  void RefreshLoads() {
+    auto now = std::chrono::steady_clock::now();
+    double ms =
+        std::chrono::duration<double, std::milli>(now - loads_time_).count();
+    loads_time_ = now;
+    double factor = std::exp2(-ms / kLoadHalfLifeMs);
+
+    u64 now_ns = WorkerStatsTable::NowNs();
+    u64 stale_ns = kStaleReports * stats_period_ms_ * 1000000ull;
+    std::vector<WorkerStats> stats(loads_.size());
+    std::vector<bool> fresh(loads_.size());
+    double throughput_sum = 0;
+    size_t throughput_count = 0;
+    for (u32 c = 0; c < loads_.size(); ++c) {
+      placed_[c] *= factor;
+      u64 stamp;
+      fresh[c] = stats_table_.Get(c, stats[c], stamp) &&
+                 now_ns - stamp <= stale_ns;
+      if (!fresh[c]) {
+        continue;
+      }
+      if (stamp != report_stamp_[c]) {
+        // The report already counts what was placed before it
+        placed_[c] = 0;
+        report_stamp_[c] = stamp;
+      }
+      if (stats[c].throughput_ > 0) {
+        throughput_sum += stats[c].throughput_;
+        ++throughput_count;
+      }
+    }
+
+    double mean_throughput =
+        throughput_count ? throughput_sum / throughput_count : 1;
+    for (u32 c = 0; c < loads_.size(); ++c) {
+      loads_[c].queued_ = placed_[c];
+      loads_[c].capacity_ = mean_throughput;
+      loads_[c].overhead_ = 0;
+      if (fresh[c]) {
+        loads_[c].queued_ += stats[c].inflight_bytes_;
+        if (stats[c].cost_ns_per_byte_ > 0) {
+          loads_[c].capacity_ = 1e9 / stats[c].cost_ns_per_byte_;
+          loads_[c].overhead_ =
+              stats[c].cost_fixed_ns_ / stats[c].cost_ns_per_byte_;
+        } else if (stats[c].throughput_ > 0) {
+          loads_[c].capacity_ = stats[c].throughput_;
+        }
+      }
+    }
+  }
   CHI_END(Schedule)
+
+  /** Point one iovec at each segment of a contiguous staging region */
+  static std::vector<struct iovec> MakeIovecs(
+      char *data, const chi::ipc::vector<size_t> &seg_sizes) {
+    std::vector<struct iovec> iov;
+    iov.reserve(seg_sizes.size());
+    size_t off = 0;
+    for (size_t seg_size : seg_sizes) {
+      iov.push_back({data + off, seg_size});
+      off += seg_size;
+    }
+    return iov;
+  }
+
+  /**
+   * Issue a vectored transfer over @iov starting at @offset. The iovecs are
+   * handed to the kernel in batches of at most IOV_MAX, so the common case is
+   * a single preadv/pwritev.
+   * */
+  template <bool IS_WRITE>
+  static ssize_t PosixIoV(int fd, std::vector<struct iovec> &iov,
+                          off64_t offset) {
+    ssize_t total = 0;
+    for (size_t i = 0; i < iov.size(); i += IOV_MAX) {
+      int cnt = static_cast<int>(std::min<size_t>(IOV_MAX, iov.size() - i));
+      size_t expected = 0;
+      for (int j = 0; j < cnt; ++j) {
+        expected += iov[i + j].iov_len;
+      }
+      ssize_t count = IS_WRITE ? pwritev64(fd, &iov[i], cnt, offset + total)
+                               : preadv64(fd, &iov[i], cnt, offset + total);
+      if (count < 0) {
+        return total ? total : count;
+      }
+      total += count;
+      if (static_cast<size_t>(count) != expected) {
+        break;
+      }
+    }
+    return total;
+  }
+
+  CHI_BEGIN(WriteV)
+  /** The WriteV method */
+  void WriteV(WriteVTask *task, RunContext &rctx) {
+    Admit(task);
+    IoScope io_scope(this, task, rctx);
+    hipc::FullPtr data_full(task->data_);
+    char *data_ = (char *)(data_full.ptr_);
+
+    std::string filepath_str = task->filename_.str();
+    std::string filepath = (filepath_str.compare(0, 7, "dtio://") == 0)
+                               ? filepath_str.substr(7)
+                               : filepath_str;
+
+    // A file kept in memory is served there, unless it was persisted
+    if (IsMemoryName(filepath)) {
+      filepath = MemoryPath(filepath);
+      if (memory_.Write(filepath, task->data_offset_, data_, task->data_size_,
+                        task->ret_)) {
+        return;
+      }
+    }
+    if (logs_.Enabled()) {
+      task->ret_ = logs_.Write(filepath, task->data_offset_, data_,
+                               task->data_size_);
+      return;
+    }
+    if (tiers_.Enabled()) {
+      task->ret_ = tiers_.Write(
+          filepath, task->data_offset_, data_, task->data_size_,
+          static_cast<dtio::LocationType>(task->opts_.tier_));
+      return;
+    }
+    if (chunks_.Enabled()) {
+      task->ret_ = chunks_.Write(filepath, task->data_offset_, data_,
+                                 task->data_size_);
+      return;
+    }
+
+    task->ret_ = -1;
+    switch (task->iface_) {
+      case dtio::IoClientType::kPosix: {
+        int fd = open64(filepath.c_str(), O_RDWR | O_CREAT, 0664);
+        if (fd < 0) {
+          std::cerr << "File " << filepath << " didn't open" << std::endl;
+          break;
+        }
+        std::vector<struct iovec> iov = MakeIovecs(data_, task->seg_sizes_);
+        task->ret_ = PosixIoV<true>(fd, iov, task->data_offset_);
+        close(fd);
+      } break;
+      case dtio::IoClientType::kStdio: {
+        // STDIO has no vectored call, so the segments go out back to back
+        FILE *fp = fopen(filepath.c_str(), "rw+");  // "w+"
+        if (fp == nullptr) {
+          std::cerr << "File " << filepath << " didn't open" << std::endl;
+          break;
+        }
+        fseek(fp, task->data_offset_, SEEK_SET);
+        auto count = fwrite(data_, sizeof(char), task->data_size_, fp);
+        task->ret_ = count;
+        fclose(fp);
+      } break;
+      default:
+        break;
+    }
+    RecordWritten(filepath_str, task->data_offset_, task->ret_);
+  }
+  void MonitorWriteV(MonitorModeId mode, WriteVTask *task, RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kSampleLoad: {
+        cost_.Finish(task, WorkerStatsTable::NowNs());
+        return;
+      }
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(WriteV)
+
+  CHI_BEGIN(ReadV)
+  /** The ReadV method */
+  void ReadV(ReadVTask *task, RunContext &rctx) {
+    Admit(task);
+    IoScope io_scope(this, task, rctx);
+    hipc::FullPtr data_full(task->data_);
+    char *data_ = (char *)(data_full.ptr_);
+
+    std::string filepath_str = task->filename_.str();
+    std::string filepath = (filepath_str.compare(0, 7, "dtio://") == 0)
+                               ? filepath_str.substr(7)
+                               : filepath_str;
+
+    // A file kept in memory is served there, unless it was persisted
+    if (IsMemoryName(filepath)) {
+      filepath = MemoryPath(filepath);
+      if (memory_.Read(filepath, task->data_offset_, data_, task->data_size_,
+                       task->ret_)) {
+        return;
+      }
+    }
+    if (logs_.Enabled()) {
+      task->ret_ = logs_.Read(filepath, task->data_offset_, data_,
+                              task->data_size_, WorkerStatsTable::NowNs());
+      return;
+    }
+    if (tiers_.Enabled()) {
+      task->ret_ = tiers_.Read(filepath, task->data_offset_, data_,
+                               task->data_size_);
+      if (task->opts_.cacheable_) {
+        mover_.Record(filepath, task->data_offset_, task->data_size_,
+                      WorkerStatsTable::NowNs());
+      }
+      return;
+    }
+    if (chunks_.Enabled()) {
+      task->ret_ = chunks_.Read(filepath, task->data_offset_, data_,
+                                task->data_size_);
+      return;
+    }
+
+    task->ret_ = -1;
+    switch (task->iface_) {
+      case dtio::IoClientType::kPosix: {
+        int fd = open64(filepath.c_str(), O_RDWR | O_CREAT, 0664);  // "w+"
+        if (fd < 0) {
+          std::cerr << "File " << filepath << " didn't open" << std::endl;
+          break;
+        }
+        std::vector<struct iovec> iov = MakeIovecs(data_, task->seg_sizes_);
+        task->ret_ = PosixIoV<false>(fd, iov, task->data_offset_);
+        close(fd);
+      } break;
+      case dtio::IoClientType::kStdio: {
+        FILE *fp = fopen(filepath.c_str(), "rw+");  // "w+"
+        if (fp == nullptr) {
+          std::cerr << "File " << filepath << " didn't open" << std::endl;
+          break;
+        }
+        fseek(fp, task->data_offset_, SEEK_SET);
+        task->ret_ = fread(data_, sizeof(char), task->data_size_, fp);
+        fclose(fp);
+      } break;
+      default:
+        break;
+    }
+  }
+  void MonitorReadV(MonitorModeId mode, ReadVTask *task, RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kSampleLoad: {
+        cost_.Finish(task, WorkerStatsTable::NowNs());
+        return;
+      }
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(ReadV)
+
+  CHI_BEGIN(CollectStats)
+  /** Snapshot the load on this container and report it to container 0 */
+  void CollectStats(CollectStatsTask *task, RunContext &rctx) {
+    u64 bytes_done = bytes_done_.load();
+    u64 busy_ns = busy_ns_.load();
+    u64 now_ns = WorkerStatsTable::NowNs();
+    if (last_collect_ns_ && now_ns > last_collect_ns_) {
+      // Busy time is summed over lanes, so a period can be busier than 1
+      double util = static_cast<double>(busy_ns - last_busy_ns_) /
+                    (now_ns - last_collect_ns_) / lane_scaler_.Active();
+      lanes_.SetActive(lane_scaler_.Update(
+          util, std::max<i64>(queue_depth_.load(), 0)));
+    }
+    last_collect_ns_ = now_ns;
+    if (busy_ns > last_busy_ns_) {
+      double rate = (bytes_done - last_bytes_done_) * 1e9 /
+                    (busy_ns - last_busy_ns_);
+      throughput_ = throughput_ == 0 ? rate
+                                     : kThroughputAlpha * rate +
+                                           (1 - kThroughputAlpha) * throughput_;
+    }
+    last_bytes_done_ = bytes_done;
+    last_busy_ns_ = busy_ns;
+
+    WorkerStats stats;
+    stats.container_id_ = container_id_;
+    stats.queue_depth_ = std::max<i64>(queue_depth_.load(), 0);
+    stats.inflight_bytes_ = std::max<i64>(inflight_bytes_.load(), 0);
+    stats.throughput_ = throughput_;
+    stats.free_capacity_ = buffer_capacity_ > stats.inflight_bytes_
+                               ? buffer_capacity_ - stats.inflight_bytes_
+                               : 0;
+    CostSummary cost = cost_.Summarize(stats.queue_depth_);
+    stats.cost_fixed_ns_ = cost.fixed_ns_;
+    stats.cost_ns_per_byte_ = cost.ns_per_byte_;
+    qos_.SetElevatorWindow(
+        cost_.ElevatorWindow(elevator_window_, stats.queue_depth_));
+    if (container_id_ == 0) {
+      stats_table_.Publish(stats);
+    } else {
+      client_.PublishStats(HSHM_MCTX,
+                           chi::DomainQuery::GetDirectHash(
+                               chi::SubDomainId::kGlobalContainers, 0),
+                           stats);
+    }
+    ReportWritten();
+  }
+
+  /** Note that this container wrote @count bytes of @filename at @off */
+  void RecordWritten(const std::string &filename, size_t off, ssize_t count) {
+    if (count <= 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(written_lock_);
+    written_.Assign(filename, off, count, container_id_);
+  }
+
+  /** Send the extents written since the last report to container 0 */
+  void ReportWritten() {
+    ExtentMap::Files written;
+    {
+      std::lock_guard<std::mutex> lock(written_lock_);
+      written = written_.Take();
+    }
+    for (auto &file : written) {
+      std::vector<size_t> offsets, sizes;
+      for (auto &extent : file.second) {
+        offsets.push_back(extent.first);
+        sizes.push_back(extent.second.end_ - extent.first);
+      }
+      if (container_id_ == 0) {
+        for (size_t i = 0; i < offsets.size(); ++i) {
+          extents_.Assign(file.first, offsets[i], sizes[i], container_id_);
+        }
+      } else {
+        client_.RecordExtents(HSHM_MCTX, chi::string(file.first), offsets,
+                              sizes, container_id_);
+      }
+    }
+  }
+  void MonitorCollectStats(MonitorModeId mode, CollectStatsTask *task,
+                           RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(CollectStats)
+
+  CHI_BEGIN(PublishStats)
+  /** Store a container's load report in the worker stats table */
+  void PublishStats(PublishStatsTask *task, RunContext &rctx) {
+    stats_table_.Publish(task->stats_);
+  }
+  void MonitorPublishStats(MonitorModeId mode, PublishStatsTask *task,
+                           RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+      case MonitorMode::kSchedule: {
+        IoRoute<PublishStatsTask>(task);
+        return;
+      }
+    }
+  }
+  CHI_END(PublishStats)
+
+  CHI_BEGIN(QosStats)
+  /** Report what each QoS class has been served on this container */
+  void QosStats(QosStatsTask *task, RunContext &rctx) {
+    std::vector<QosClassStats> stats = qos_.Stats();
+    task->stats_.reserve(stats.size());
+    for (const QosClassStats &cls : stats) {
+      task->stats_.emplace_back(cls);
+    }
+  }
+  void MonitorQosStats(MonitorModeId mode, QosStatsTask *task,
+                       RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(QosStats)
+
+  CHI_BEGIN(LaneStats)
+  /** Report how I/O tasks have been spread over this container's lanes */
+  void LaneStats(LaneStatsTask *task, RunContext &rctx) {
+    task->stats_ = lanes_.Stats();
+  }
+  void MonitorLaneStats(MonitorModeId mode, LaneStatsTask *task,
+                        RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(LaneStats)
+
+  CHI_BEGIN(Inflight)
+  /** Report the bytes of I/O in flight on this container */
+  void Inflight(InflightTask *task, RunContext &rctx) {
+    task->stats_.node_bytes_ = std::max<i64>(inflight_bytes_.load(), 0);
+    std::lock_guard<std::mutex> guard(client_inflight_lock_);
+    auto it = client_inflight_.find(task->client_);
+    task->stats_.client_bytes_ = it == client_inflight_.end() ? 0 : it->second;
+  }
+  void MonitorInflight(MonitorModeId mode, InflightTask *task,
+                       RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(Inflight)
+
+  CHI_BEGIN(Staging)
+  /**
+   * Drain held data to the PFS, paced by the drain rate, then move blocks
+   * between the PFS and the tiers by heat, then tidy the logs. Foreground
+   * I/O goes first: while any is queued, only a tier filled past its high
+   * water mark is drained, cold blocks are dropped but no hot ones are
+   * copied up, and no log is compacted. Files kept in memory are persisted
+   * whenever memory is past its high water mark, so writes rarely have to
+   * wait for room. The buffer tier is relieved the same way: past its high
+   * water mark, clean blocks are evicted and dirty ones moved down until it
+   * is under its low water mark. This is not paced, since a write that
+   * finds memory full has to do it itself.
+   * */
+  void Staging(StagingTask *task, RunContext &rctx) {
+    u64 now = WorkerStatsTable::NowNs();
+    bool idle = queue_depth_.load() <= 0;
+    if (tiers_.Held() && (idle || tiers_.Pressured()) &&
+        drain_bucket_.Ready(now)) {
+      drain_bucket_.Take(tiers_.Drain(kDrainBatch));
+    }
+    tiers_.Relieve(kDrainBatch, now);
+    mover_.Run(tiers_, idle ? kDrainBatch : 0, now);
+    memory_.Relieve();
+    if (logs_.Enabled()) {
+      logs_.Trim();
+      if (idle) {
+        logs_.CompactDue(now);
+      }
+    }
+    if (packs_.Enabled() && idle) {
+      packs_.Compact(kDrainBatch);
+    }
+  }
+  void MonitorStaging(MonitorModeId mode, StagingTask *task,
+                      RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(Staging)
+
+  CHI_BEGIN(Flush)
+  /**
+   * Drain a file's held data to the PFS, yielding between writes, and
+   * report its progress. A log-structured file's log is synced first, so
+   * the other containers see its writes. An empty filename covers every
+   * file.
+   * */
+  void Flush(FlushTask *task, RunContext &rctx) {
+    std::string filepath_str = task->filename_.str();
+    std::string filepath = (filepath_str.compare(0, 7, "dtio://") == 0)
+                               ? filepath_str.substr(7)
+                               : filepath_str;
+    bool synced = true;
+    if (logs_.Enabled()) {
+      synced = filepath.empty() ? logs_.SyncAll() : logs_.Sync(filepath);
+    }
+    while (task->wait_ &&
+           (filepath.empty()
+                ? tiers_.Drain(TierManager::kDrainSize)
+                : tiers_.DrainFile(filepath, TierManager::kDrainSize))) {
+      task->Yield();
+    }
+    task->progress_ = tiers_.Progress(filepath);
+    task->progress_.sync_failed_ = !synced;
+  }
+  void MonitorFlush(MonitorModeId mode, FlushTask *task, RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        // Sum the progress of every container
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+        task->progress_ = StageProgress();
+        for (FullPtr<Task> &replica : replicas) {
+          auto *flush = reinterpret_cast<FlushTask *>(replica.ptr_);
+          task->progress_.held_bytes_ += flush->progress_.held_bytes_;
+          task->progress_.drained_bytes_ += flush->progress_.drained_bytes_;
+          task->progress_.held_end_ = std::max(task->progress_.held_end_,
+                                               flush->progress_.held_end_);
+          task->progress_.sync_failed_ |= flush->progress_.sync_failed_;
+        }
+        return;
+      }
+    }
+  }
+  CHI_END(Flush)
+
+  CHI_BEGIN(Compact)
+  /**
+   * Compact a log-structured file on its home container. Unless the client
+   * waits, the compaction runs in the background once requests for the file
+   * stop arriving, so the last of its writers to close it triggers it.
+   * */
+  void Compact(CompactTask *task, RunContext &rctx) {
+    std::string filepath_str = task->filename_.str();
+    std::string filepath = (filepath_str.compare(0, 7, "dtio://") == 0)
+                               ? filepath_str.substr(7)
+                               : filepath_str;
+    if (!logs_.Enabled()) {
+      return;
+    }
+    if (task->wait_) {
+      task->compacted_ = logs_.Compact(filepath);
+    } else {
+      logs_.RequestCompact(filepath, WorkerStatsTable::NowNs());
+    }
+  }
+  void MonitorCompact(MonitorModeId mode, CompactTask *task,
+                      RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(Compact)
+
+  CHI_BEGIN(PackGet)
+  /** Serve the open or stat of a packed file from the pack index */
+  void PackGet(PackGetTask *task, RunContext &rctx) {
+    std::string filepath_str = task->filename_.str();
+    std::string filepath = (filepath_str.compare(0, 7, "dtio://") == 0)
+                               ? filepath_str.substr(7)
+                               : filepath_str;
+    char *data_ = nullptr;
+    if (task->data_size_) {
+      hipc::FullPtr data_full(task->data_);
+      data_ = (char *)(data_full.ptr_);
+    }
+    task->ret_ = packs_.Get(filepath, data_, task->data_size_, task->info_);
+  }
+  void MonitorPackGet(MonitorModeId mode, PackGetTask *task,
+                      RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(PackGet)
+
+  CHI_BEGIN(PackPut)
+  /** The PackPut method */
+  void PackPut(PackPutTask *task, RunContext &rctx) {
+    std::string filepath_str = task->filename_.str();
+    std::string filepath = (filepath_str.compare(0, 7, "dtio://") == 0)
+                               ? filepath_str.substr(7)
+                               : filepath_str;
+    char *data_ = nullptr;
+    if (task->data_size_) {
+      hipc::FullPtr data_full(task->data_);
+      data_ = (char *)(data_full.ptr_);
+    }
+    task->ret_ = packs_.Put(filepath, data_, task->data_size_, task->mode_);
+  }
+  void MonitorPackPut(MonitorModeId mode, PackPutTask *task,
+                      RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(PackPut)
+
+  CHI_BEGIN(PackRemove)
+  /** The PackRemove method */
+  void PackRemove(PackRemoveTask *task, RunContext &rctx) {
+    std::string filepath_str = task->filename_.str();
+    std::string filepath = (filepath_str.compare(0, 7, "dtio://") == 0)
+                               ? filepath_str.substr(7)
+                               : filepath_str;
+    task->removed_ = packs_.Remove(filepath);
+  }
+  void MonitorPackRemove(MonitorModeId mode, PackRemoveTask *task,
+                         RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(PackRemove)
+
+  CHI_BEGIN(MemOpen)
+  /** Open or stat a file that may be kept in this container's memory */
+  void MemOpen(MemOpenTask *task, RunContext &rctx) {
+    task->info_ = memory_.Open(MemoryPath(task->filename_.str()),
+                               task->create_, task->truncate_, task->mode_);
+  }
+  void MonitorMemOpen(MonitorModeId mode, MemOpenTask *task,
+                      RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(MemOpen)
+
+  CHI_BEGIN(Discard)
+  /** The Discard method */
+  void Discard(DiscardTask *task, RunContext &rctx) {
+    task->discarded_ = memory_.Discard(MemoryPath(task->filename_.str()));
+  }
+  void MonitorDiscard(MonitorModeId mode, DiscardTask *task,
+                      RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(Discard)
+
+  CHI_BEGIN(Copy)
+  /**
+   * Copy a range of one file into another. Files only on the PFS are copied
+   * by the kernel, with copy_file_range, or with splice where the two
+   * filesystems can't share it. Otherwise the bytes are read and written
+   * the way I/O tasks on this container would, so data held in memory or
+   * on the tiers is moved there without reaching the PFS first.
+   * */
+  void Copy(CopyTask *task, RunContext &rctx) {
+    std::string src = StripScheme(task->src_.str());
+    std::string dst = StripScheme(task->dst_.str());
+    task->src_size_ = CopySourceSize(src);
+    task->ret_ = 0;
+    size_t end = std::min(task->src_size_, task->src_offset_ + task->size_);
+    if (task->size_ == 0 || task->src_offset_ >= end) {
+      return;
+    }
+    int in = -1, out = -1;
+    if (!IsMemoryName(src) && !IsMemoryName(dst) && !logs_.Enabled() &&
+        !tiers_.Enabled() && !chunks_.Enabled()) {
+      in = open64(src.c_str(), O_RDONLY);
+      out = open64(dst.c_str(), O_WRONLY | O_CREAT, 0664);
+    }
+    bool kernel = in >= 0 && out >= 0;
+    std::vector<char> buf;
+    size_t done = 0;
+    while (task->src_offset_ + done < end) {
+      size_t len = std::min(end - task->src_offset_ - done, kCopyStep);
+      size_t src_pos = task->src_offset_ + done;
+      size_t dst_pos = task->dst_offset_ + done;
+      ssize_t ret = -1;
+      if (kernel) {
+        ret = KernelCopy(in, src_pos, out, dst_pos, len);
+        // Anything short is left to a copy through memory
+        kernel = ret == static_cast<ssize_t>(len);
+      }
+      if (ret < static_cast<ssize_t>(len)) {
+        size_t moved = ret > 0 ? ret : 0;
+        ssize_t rest = BounceCopy(src, src_pos + moved, dst, dst_pos + moved,
+                                  len - moved, buf);
+        ret = moved + std::max<ssize_t>(rest, 0);
+      }
+      if (ret <= 0) {
+        task->ret_ = done ? done : -1;
+        break;
+      }
+      done += ret;
+      task->ret_ = done;
+      if (ret < static_cast<ssize_t>(len)) {
+        break;
+      }
+      task->Yield();
+    }
+    if (in >= 0) {
+      close(in);
+    }
+    if (out >= 0) {
+      close(out);
+    }
+  }
+  void MonitorCopy(MonitorModeId mode, CopyTask *task, RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+
+  static std::string StripScheme(const std::string &filename) {
+    return filename.compare(0, 7, "dtio://") == 0 ? filename.substr(7)
+                                                   : filename;
+  }
+
+  /** The size of @filename as I/O tasks on this container see it */
+  size_t CopySourceSize(const std::string &filename) {
+    if (IsMemoryName(filename)) {
+      return memory_.Open(MemoryPath(filename), false, false, 0).size_;
+    }
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 ? st.st_size : 0;
+  }
+
+  /**
+   * Copy @size bytes at @in_off of @in to @out at @out_off in the kernel.
+   * Returns the bytes copied, which are short if neither call works on
+   * these files, or -1 if none were.
+   * */
+  static ssize_t KernelCopy(int in, size_t in_off, int out, size_t out_off,
+                            size_t size) {
+    loff_t in_pos = in_off, out_pos = out_off;
+    size_t done = 0;
+    while (done < size) {
+      ssize_t ret =
+          copy_file_range(in, &in_pos, out, &out_pos, size - done, 0);
+      if (ret <= 0) {
+        break;
+      }
+      done += ret;
+    }
+    // Filesystems that can't copy between each other can still splice
+    int pipe_fds[2];
+    if (done < size && pipe(pipe_fds) == 0) {
+      while (done < size) {
+        ssize_t filled =
+            splice(in, &in_pos, pipe_fds[1], nullptr,
+                   std::min(size - done, kSpliceSize), SPLICE_F_MOVE);
+        if (filled <= 0) {
+          break;
+        }
+        ssize_t drained = 0;
+        while (drained < filled) {
+          ssize_t ret = splice(pipe_fds[0], nullptr, out, &out_pos,
+                               filled - drained, SPLICE_F_MOVE);
+          if (ret <= 0) {
+            break;
+          }
+          drained += ret;
+        }
+        done += drained;
+        if (drained < filled) {
+          break;
+        }
+      }
+      close(pipe_fds[0]);
+      close(pipe_fds[1]);
+    }
+    return done ? static_cast<ssize_t>(done) : -1;
+  }
+
+  /**
+   * Copy @size bytes at @src_off of @src to @dst at @dst_off through @buf,
+   * reading and writing as I/O tasks on this container would. Returns the
+   * bytes copied, or -1.
+   * */
+  ssize_t BounceCopy(const std::string &src, size_t src_off,
+                     const std::string &dst, size_t dst_off, size_t size,
+                     std::vector<char> &buf) {
+    buf.resize(size);
+    ssize_t got = CopyRead(src, src_off, buf.data(), size);
+    if (got <= 0) {
+      return got;
+    }
+    ssize_t put = CopyWrite(dst, dst_off, buf.data(), got);
+    return put == got ? got : -1;
+  }
+
+  ssize_t CopyRead(std::string filepath, size_t offset, char *data,
+                   size_t size) {
+    ssize_t ret;
+    if (IsMemoryName(filepath)) {
+      filepath = MemoryPath(filepath);
+      if (memory_.Read(filepath, offset, data, size, ret)) {
+        return ret;
+      }
+    }
+    if (logs_.Enabled()) {
+      return logs_.Read(filepath, offset, data, size,
+                        WorkerStatsTable::NowNs());
+    }
+    if (tiers_.Enabled()) {
+      return tiers_.Read(filepath, offset, data, size);
+    }
+    if (chunks_.Enabled()) {
+      return chunks_.Read(filepath, offset, data, size);
+    }
+    int fd = open64(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return -1;
+    }
+    ret = pread64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+
+  ssize_t CopyWrite(std::string filepath, size_t offset, const char *data,
+                    size_t size) {
+    ssize_t ret;
+    if (IsMemoryName(filepath)) {
+      filepath = MemoryPath(filepath);
+      if (memory_.Write(filepath, offset, data, size, ret)) {
+        return ret;
+      }
+    }
+    if (logs_.Enabled()) {
+      return logs_.Write(filepath, offset, data, size);
+    }
+    if (tiers_.Enabled()) {
+      return tiers_.Write(filepath, offset, data, size);
+    }
+    if (chunks_.Enabled()) {
+      return chunks_.Write(filepath, offset, data, size);
+    }
+    int fd = open64(filepath.c_str(), O_WRONLY | O_CREAT, 0664);
+    if (fd < 0) {
+      return -1;
+    }
+    ret = pwrite64(fd, data, size, offset);
+    close(fd);
+    return ret;
+  }
+  CHI_END(Copy)
+
+  CHI_BEGIN(TierStats)
+  /** Report how full this container's tiers are */
+  void TierStats(TierStatsTask *task, RunContext &rctx) {
+    task->stats_ = tiers_.Stats();
+  }
+  void MonitorTierStats(MonitorModeId mode, TierStatsTask *task,
+                        RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        // Sum the stats of every container
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+        chi::dtiomod::TierStats &stats = task->stats_;
+        stats = chi::dtiomod::TierStats();
+        for (FullPtr<Task> &replica : replicas) {
+          auto *tier = reinterpret_cast<TierStatsTask *>(replica.ptr_);
+          const chi::dtiomod::TierStats &other = tier->stats_;
+          stats.buffers_capacity_ += other.buffers_capacity_;
+          stats.buffers_used_ += other.buffers_used_;
+          stats.buffers_dirty_ += other.buffers_dirty_;
+          stats.cache_capacity_ += other.cache_capacity_;
+          stats.cache_used_ += other.cache_used_;
+          stats.cache_dirty_ += other.cache_dirty_;
+          stats.evicted_bytes_ += other.evicted_bytes_;
+          stats.demoted_bytes_ += other.demoted_bytes_;
+          stats.written_back_bytes_ += other.written_back_bytes_;
+          stats.stalls_ += other.stalls_;
+          stats.evict_rate_ += other.evict_rate_;
+          stats.writeback_rate_ += other.writeback_rate_;
+        }
+        return;
+      }
+    }
+  }
+  CHI_END(TierStats)
+
+  CHI_BEGIN(RecordExtents)
+  /** Record the extents another container wrote */
+  void RecordExtents(RecordExtentsTask *task, RunContext &rctx) {
+    std::string filename = task->filename_.str();
+    for (size_t i = 0; i < task->offsets_.size(); ++i) {
+      extents_.Assign(filename, task->offsets_[i], task->sizes_[i],
+                      task->owner_);
+    }
+  }
+  void MonitorRecordExtents(MonitorModeId mode, RecordExtentsTask *task,
+                            RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(RecordExtents)
+
+  CHI_BEGIN(Truncate)
+  /**
+   * Drop what this container keeps of a file past its new size. Held data
+   * is discarded rather than drained, and the PFS file is cut again in case
+   * a drain wrote to it since it was truncated. Chunk objects are trimmed
+   * by the home of the file's first chunk, and each container clips its
+   * own logs of the file. Extent reports already on
+   * their way from other containers may record some extents again, which
+   * only steers later reads of the file.
+   * */
+  void Truncate(TruncateTask *task, RunContext &rctx) {
+    std::string filename = task->filename_.str();
+    std::string filepath = (filename.compare(0, 7, "dtio://") == 0)
+                               ? filename.substr(7)
+                               : filename;
+    size_t size = task->unlink_ ? 0 : task->size_;
+    if (tiers_.Discard(filepath, size) && !task->unlink_) {
+      truncate64(filepath.c_str(), size);
+    }
+    if (chunks_.Enabled()) {
+      chunks_.Truncate(
+          filepath, size, task->unlink_,
+          ExtentMap::Home(filepath, 0, loads_.size()) == container_id_);
+    }
+    if (logs_.Enabled()) {
+      logs_.Truncate(filepath, size, task->unlink_);
+    }
+    if (container_id_ == 0) {
+      extents_.Truncate(filename, size);
+    }
+    std::lock_guard<std::mutex> lock(written_lock_);
+    written_.Truncate(filename, size);
+  }
+  void MonitorTruncate(MonitorModeId mode, TruncateTask *task,
+                       RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(Truncate)
   CHI_AUTOGEN_METHODS  // keep at class bottom
       public:
 #include "dtiomod/dtiomod_lib_exec.h"
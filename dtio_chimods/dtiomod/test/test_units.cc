@@ -0,0 +1,411 @@
+/*
+ * Checks of the runtime's placement, QoS and staging policies, and of
+ * client calls that fail before reaching it, run without a runtime. Each
+ * check prints what failed, and the exit status is the number of failures.
+ */
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dtiomod/dtiomod_chunks.h"
+#include "dtiomod/dtiomod_client.h"
+#include "dtiomod/dtiomod_locality.h"
+#include "dtiomod/dtiomod_logs.h"
+#include "dtiomod/dtiomod_qos.h"
+#include "dtiomod/dtiomod_scheduler.h"
+#include "dtiomod/dtiomod_tiers.h"
+
+using namespace chi::dtiomod;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+              #cond);                                                 \
+      failures += 1;                                                  \
+    }                                                                 \
+  } while (0)
+
+/** The latest time any container in @loads finishes its queue */
+static double Makespan(const std::vector<ContainerLoad> &loads) {
+  double span = 0;
+  for (const ContainerLoad &load : loads) {
+    span = std::max(span, load.queued_ / load.capacity_);
+  }
+  return span;
+}
+
+/** DpScheduler finds the best makespan, as trying every placement does */
+static void TestDpScheduler() {
+  std::mt19937 rng(1);
+  for (int round = 0; round < 200; ++round) {
+    size_t num_ios = 1 + rng() % 7;
+    size_t num_containers = 1 + rng() % 4;
+    std::vector<size_t> sizes(num_ios);
+    for (size_t &size : sizes) {
+      size = 1 + rng() % 100;
+    }
+    std::vector<ContainerLoad> loads(num_containers);
+    for (ContainerLoad &load : loads) {
+      load.capacity_ = 1 + rng() % 3;
+      load.queued_ = rng() % 50;
+    }
+
+    std::vector<ContainerLoad> placed = loads;
+    std::vector<u32> placement;
+    DpScheduler().Place(sizes, placed, placement);
+    CHECK(placement.size() == num_ios);
+
+    double best = 1e18;
+    size_t combos = 1;
+    for (size_t i = 0; i < num_ios; ++i) {
+      combos *= num_containers;
+    }
+    for (size_t combo = 0; combo < combos; ++combo) {
+      std::vector<ContainerLoad> trial = loads;
+      for (size_t i = 0, c = combo; i < num_ios; ++i, c /= num_containers) {
+        trial[c % num_containers].queued_ += sizes[i];
+      }
+      best = std::min(best, Makespan(trial));
+    }
+    CHECK(std::abs(Makespan(placed) - best) < 1e-9);
+  }
+}
+
+/** ExtentMap merges same-owner neighbours and trims what a write covers */
+static void TestExtentMap() {
+  ExtentMap map;
+  u32 owner = 99;
+  CHECK(!map.Owner("f", 0, 10, owner));
+
+  // Adjacent ranges on one container become one extent
+  map.Assign("f", 0, 100, 1);
+  map.Assign("f", 100, 100, 1);
+  CHECK(map.Count("f") == 1);
+  CHECK(map.Owner("f", 150, 10, owner) && owner == 1);
+
+  // A write inside an extent splits it around the new owner
+  map.Assign("f", 50, 20, 2);
+  CHECK(map.Count("f") == 3);
+  CHECK(map.Owner("f", 55, 5, owner) && owner == 2);
+  CHECK(map.Owner("f", 40, 5, owner) && owner == 1);
+  CHECK(map.Owner("f", 70, 5, owner) && owner == 1);
+
+  // The owner of a range is the container holding most of it
+  CHECK(map.Owner("f", 45, 30, owner) && owner == 2);
+  CHECK(map.Owner("f", 0, 200, owner) && owner == 1);
+
+  // Rewriting the middle with the old owner merges it back
+  map.Assign("f", 50, 20, 1);
+  CHECK(map.Count("f") == 1);
+
+  // Against a byte-level model under random writes
+  std::vector<int> model(1000, -1);
+  std::mt19937 rng(1);
+  for (int i = 0; i < 20000; ++i) {
+    size_t off = rng() % 900, size = 1 + rng() % 100;
+    u32 who = rng() % 4;
+    map.Assign("g", off, size, who);
+    std::fill(model.begin() + off, model.begin() + off + size, who);
+    size_t qoff = rng() % 990, qsize = 1 + rng() % 10;
+    size_t held[4] = {0};
+    bool any = false;
+    for (size_t k = qoff; k < qoff + qsize; ++k) {
+      if (model[k] >= 0) {
+        held[model[k]] += 1;
+        any = true;
+      }
+    }
+    bool found = map.Owner("g", qoff, qsize, owner);
+    CHECK(found == any);
+    if (found && any) {
+      CHECK(held[owner] == *std::max_element(held, held + 4));
+    }
+  }
+
+  // Truncating trims the extent it cuts and forgets the ones past it
+  map.Assign("f", 200, 100, 2);
+  map.Truncate("f", 150);
+  CHECK(map.Count("f") == 1);
+  CHECK(map.Owner("f", 140, 20, owner) && owner == 1);
+  CHECK(!map.Owner("f", 150, 100, owner));
+  map.Truncate("f", 0);
+  CHECK(map.Count("f") == 0);
+
+  // Taking the extents empties the map
+  ExtentMap::Files files = map.Take();
+  CHECK(files.count("g") == 1);
+  CHECK(map.Count("g") == 0);
+
+  map.Assign("f", 0, 10, 1);
+  map.Erase("f");
+  CHECK(!map.Owner("f", 0, 10, owner));
+}
+
+/** QosGate serves backlogged classes in proportion to their weights */
+static void TestQosGate() {
+  std::vector<QosClass> classes(2);
+  classes[0].weight_ = 4;
+  classes[1].weight_ = 1;
+  QosGate gate;
+  gate.Configure(classes, 0);
+
+  const int kTasks = 200;
+  std::vector<chi::Task> tasks(kTasks);
+  std::vector<IoDesc> ios(kTasks);
+  for (int i = 0; i < kTasks; ++i) {
+    ios[i].opts_.client_ = i % 2 + 1;
+    ios[i].opts_.class_ = i % 2;
+    ios[i].size_ = KILOBYTES(4);
+    gate.Enqueue(&tasks[i], ios[i]);
+  }
+
+  // Poll every waiting task in turn, as a worker does
+  std::vector<int> order;
+  std::vector<bool> done(kTasks);
+  while (order.size() < static_cast<size_t>(kTasks)) {
+    for (int i = 0; i < kTasks; ++i) {
+      if (!done[i] && gate.TryDispatch(&tasks[i], ios[i])) {
+        done[i] = true;
+        order.push_back(i);
+      }
+    }
+  }
+  int served[2] = {0, 0};
+  for (int k = 0; k < 50; ++k) {
+    served[ios[order[k]].opts_.class_] += 1;
+  }
+  CHECK(served[0] >= 38 && served[0] <= 42);
+  CHECK(served[0] + served[1] == 50);
+  std::vector<QosClassStats> stats = gate.Stats();
+  CHECK(stats[0].ops_ == kTasks / 2 && stats[1].ops_ == kTasks / 2);
+  CHECK(stats[0].waiting_ == 0 && stats[1].waiting_ == 0);
+}
+
+/** TierManager keeps its byte counts straight as data moves to the PFS */
+static void TestTierManager() {
+  std::map<std::string, std::vector<char>> pfs;
+  TierManager tiers;
+  TierConfig config;
+  config.buffers_capacity_ = KILOBYTES(64);
+  config.drain_align_ = KILOBYTES(4);
+  tiers.Configure(config);
+  tiers.SetPfs(
+      [&pfs](const std::string &path, const char *data, size_t size,
+             size_t off) -> ssize_t {
+        std::vector<char> &file = pfs[path];
+        file.resize(std::max(file.size(), off + size));
+        memcpy(file.data() + off, data, size);
+        return size;
+      },
+      [&pfs](const std::string &path, char *data, size_t size,
+             size_t off) -> ssize_t {
+        std::vector<char> &file = pfs[path];
+        if (off >= file.size()) {
+          return 0;
+        }
+        size = std::min(size, file.size() - off);
+        memcpy(data, file.data() + off, size);
+        return size;
+      });
+
+  // Fill memory past its capacity, so older data is evicted to the PFS
+  std::vector<char> model(KILOBYTES(96));
+  std::mt19937 rng(2);
+  for (size_t off = 0; off < model.size(); off += KILOBYTES(8)) {
+    std::vector<char> data(KILOBYTES(8));
+    for (char &c : data) {
+      c = 'a' + rng() % 26;
+    }
+    CHECK(tiers.Write("/f", off, data.data(), data.size()) ==
+          static_cast<ssize_t>(data.size()));
+    memcpy(model.data() + off, data.data(), data.size());
+  }
+  TierStats stats = tiers.Stats();
+  CHECK(stats.buffers_used_ <= config.buffers_capacity_);
+  CHECK(stats.buffers_used_ == tiers.Used(dtio::LocationType::kBuffers));
+  CHECK(stats.buffers_dirty_ == tiers.Held());
+  CHECK(tiers.Held() + stats.written_back_bytes_ == model.size());
+  StageProgress progress = tiers.Progress("/f");
+  CHECK(progress.held_bytes_ == tiers.Held());
+
+  // Reads see the newest data wherever it is
+  std::vector<char> out(model.size());
+  CHECK(tiers.Read("/f", 0, out.data(), out.size()) ==
+        static_cast<ssize_t>(out.size()));
+  CHECK(out == model);
+
+  // Draining empties the tiers and puts everything on the PFS
+  tiers.FlushAll();
+  progress = tiers.Progress("/f");
+  CHECK(progress.held_bytes_ == 0);
+  CHECK(tiers.Held() == 0);
+  CHECK(tiers.Stats().buffers_dirty_ == 0);
+  CHECK(pfs["/f"] == model);
+
+  // Held data past a truncation is dropped, never drained
+  std::vector<char> tail(KILOBYTES(8), 'z');
+  tiers.Write("/f", model.size(), tail.data(), tail.size());
+  CHECK(tiers.Progress("/f").held_end_ == model.size() + tail.size());
+  CHECK(tiers.Discard("/f", model.size()));
+  CHECK(tiers.Held() == 0);
+  CHECK(tiers.Progress("/f").held_end_ == 0);
+  tiers.FlushAll();
+  CHECK(pfs["/f"] == model);
+  CHECK(!tiers.Discard("/f", 0));
+}
+
+/** ChunkStore drops the chunks past a truncation, and all of them on unlink */
+static void TestChunkStore() {
+  char dir_template[] = "/tmp/dtiomod_units_XXXXXX";
+  char *dir = mkdtemp(dir_template);
+  CHECK(dir != nullptr);
+  if (!dir) {
+    return;
+  }
+  std::string path = std::string(dir) + "/f";
+  ChunkStore chunks;
+  chunks.Configure(16);
+  std::string data(40, 'c');
+  CHECK(chunks.Write(path, 0, data.data(), data.size()) == 40);
+
+  chunks.Truncate(path, 20, false, true);
+  struct stat st;
+  CHECK(stat((path + ".chunks/2").c_str(), &st) != 0);
+  CHECK(stat((path + ".chunks/1").c_str(), &st) == 0 && st.st_size == 4);
+  CHECK(chunks.Chunks(path).empty());
+  std::string out(40, '\0');
+  CHECK(chunks.Read(path, 0, &out[0], out.size()) == 20);
+  CHECK(out.compare(0, 20, data, 0, 20) == 0);
+
+  chunks.Truncate(path, 0, true, true);
+  CHECK(stat((path + ".chunks").c_str(), &st) != 0);
+
+  std::string cmd = std::string("rm -rf ") + dir;
+  CHECK(system(cmd.c_str()) == 0);
+}
+
+/** LogStore reads see the newest of overlapping writes from any container */
+static void TestLogStore() {
+  char dir_template[] = "/tmp/dtiomod_units_XXXXXX";
+  char *dir = mkdtemp(dir_template);
+  CHECK(dir != nullptr);
+  if (!dir) {
+    return;
+  }
+  std::string path = std::string(dir) + "/f";
+  TierManager tiers[2];
+  LogStore logs[2];
+  for (u32 c = 0; c < 2; ++c) {
+    logs[c].Configure(true, c, &tiers[c]);
+  }
+
+  // Container 1 overwrites the middle of what container 0 wrote
+  std::string first(100, 'a'), second(20, 'b');
+  CHECK(logs[0].Write(path, 0, first.data(), first.size()) == 100);
+  CHECK(logs[1].Write(path, 40, second.data(), second.size()) == 20);
+  CHECK(logs[0].Sync(path) && logs[1].Sync(path));
+
+  std::string expect = first;
+  expect.replace(40, 20, second);
+  for (u32 c = 0; c < 2; ++c) {
+    std::string out(100, '\0');
+    CHECK(logs[c].Read(path, 0, &out[0], out.size(), 3) == 100);
+    CHECK(out == expect);
+  }
+
+  // Compaction puts the same bytes in the file
+  logs[0].Compact(path);
+  std::string out(100, '\0');
+  FILE *fp = fopen(path.c_str(), "r");
+  CHECK(fp && fread(&out[0], 1, out.size(), fp) == out.size());
+  if (fp) {
+    fclose(fp);
+  }
+  CHECK(out == expect);
+
+  // A truncate drops logged data past the new size, compacted or not
+  std::string third(40, 'c');
+  CHECK(logs[1].Write(path, 80, third.data(), third.size()) == 40);
+  CHECK(logs[1].Sync(path));
+  CHECK(truncate(path.c_str(), 50) == 0);
+  for (u32 c = 0; c < 2; ++c) {
+    CHECK(logs[c].Truncate(path, 50, false));
+  }
+  for (u32 c = 0; c < 2; ++c) {
+    std::string cut(120, '\0');
+    CHECK(logs[c].Read(path, 0, &cut[0], cut.size(), 4) == 50);
+    CHECK(cut.compare(0, 50, expect, 0, 50) == 0);
+  }
+  logs[1].Compact(path);
+  struct stat st;
+  CHECK(stat(path.c_str(), &st) == 0 && st.st_size == 50);
+
+  // Unlinking removes the logs
+  for (u32 c = 0; c < 2; ++c) {
+    CHECK(logs[c].Truncate(path, 0, true));
+  }
+  CHECK(stat((path + ".logs").c_str(), &st) != 0);
+
+  std::string cmd = std::string("rm -rf ") + dir;
+  CHECK(system(cmd.c_str()) == 0);
+}
+
+/** Copies the client would run wrong fail before reaching the runtime */
+static void TestCopyArgs() {
+  char dir_template[] = "/tmp/dtiomod_units_XXXXXX";
+  char *dir = mkdtemp(dir_template);
+  CHECK(dir != nullptr);
+  if (!dir) {
+    return;
+  }
+  std::string a = std::string(dir) + "/a", b = std::string(dir) + "/b";
+  FILE *fp = fopen(a.c_str(), "w");
+  CHECK(fp && fwrite("data", 1, 4, fp) == 4);
+  if (fp) {
+    fclose(fp);
+  }
+  Client client;
+
+  // Merge offsets must pair up with the sources
+  errno = 0;
+  CHECK(client.Merge(HSHM_MCTX, {chi::string(a), chi::string(b)}, {0},
+                     chi::string(b + ".out")) == -1);
+  CHECK(errno == EINVAL);
+
+  // Concat into one of its sources would empty it before it is read
+  errno = 0;
+  CHECK(client.Concat(HSHM_MCTX, {chi::string(a), chi::string(b)},
+                      chi::string("dtio://" + a)) == -1);
+  CHECK(errno == EINVAL);
+  struct stat st;
+  CHECK(stat(a.c_str(), &st) == 0 && st.st_size == 4);
+
+  std::string cmd = std::string("rm -rf ") + dir;
+  CHECK(system(cmd.c_str()) == 0);
+}
+
+int main() {
+  TestDpScheduler();
+  TestExtentMap();
+  TestQosGate();
+  TestTierManager();
+  TestChunkStore();
+  TestLogStore();
+  TestCopyArgs();
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+  }
+  return failures;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 Gnosis Research Center <grc@iit.edu>,
+ * Keith Bateman <kbateman@hawk.iit.edu>, Neeraj Rajesh
+ * <nrajesh@hawk.iit.edu> Hariharan Devarajan
+ * <hdevarajan@hawk.iit.edu>, Anthony Kougkas <akougkas@iit.edu>,
+ * Xian-He Sun <sun@iit.edu>
+ *
+ * This file is part of DTIO
+ *
+ * DTIO is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DTIO_INCLUDE_DTIO_ADMISSION_H_
+#define DTIO_INCLUDE_DTIO_ADMISSION_H_
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#include "chimaera/api/chimaera_client.h"
+#include "hermes_shm/util/singleton.h"
+
+namespace dtio {
+
+/**
+ * Bounds the shm buffer bytes a client has in flight to the runtime. Each
+ * I/O acquires its size before its buffer is allocated and releases it
+ * once the buffer is freed. A client may hold at most client_limit bytes.
+ * The runtime container on this node may hold at most node_limit bytes
+ * across all clients. Its count is polled at most every kRefreshMs. A limit
+ * of 0 is unlimited.
+ * */
+class AdmissionControl {
+ public:
+  /** How stale the node's in-flight count may be */
+  static constexpr int kRefreshMs = 10;
+
+ public:
+  /** Read the limits from DTIO_CONF */
+  AdmissionControl();
+
+  /** Acquire @size bytes if that stays within the limits */
+  bool TryAcquire(size_t size);
+
+  /**
+   * Acquire @size bytes, waiting for in-flight I/O to drain if needed. A
+   * request is always admitted once nothing it waits on is in flight, so
+   * requests larger than a limit still make progress.
+   * */
+  void Acquire(size_t size);
+
+  void Release(size_t size);
+
+  /**
+   * Track the acquired bytes of an async task under @key. They are released
+   * as soon as @task completes, so completed tasks that the app has not
+   * waited for yet do not hold up other I/O.
+   * */
+  void Track(const void *key, chi::Task *task, size_t size);
+
+  /** Stop tracking @key, releasing its bytes if they still are held */
+  void Untrack(const void *key);
+
+ private:
+  /** Whether @size more bytes fit. Requires lock_ */
+  bool Fits(size_t size);
+
+  /** Release the bytes of completed async tasks. Requires lock_ */
+  void Reap();
+
+  /**
+   * Refresh node_inflight_ if it is stale. Requires lock_, held by @guard,
+   * which is released while the runtime is asked.
+   * */
+  void RefreshNode(std::unique_lock<std::mutex> &guard, bool force);
+
+  struct Tracked {
+    chi::Task *task_;
+    size_t size_;
+  };
+
+  std::mutex lock_;
+  size_t client_limit_ = 0;
+  size_t node_limit_ = 0;
+  size_t inflight_ = 0;
+  size_t node_inflight_ = 0;
+  std::chrono::steady_clock::time_point node_time_;
+  std::unordered_map<const void *, Tracked> tracked_;
+};
+
+/** Holds an admission for the lifetime of a blocking I/O */
+class AdmissionScope {
+ public:
+  explicit AdmissionScope(size_t size);
+  ~AdmissionScope();
+
+  AdmissionScope(const AdmissionScope &) = delete;
+  AdmissionScope &operator=(const AdmissionScope &) = delete;
+
+ private:
+  size_t size_;
+};
+
+}  // namespace dtio
+
+// Global singleton macros
+HSHM_DEFINE_GLOBAL_PTR_VAR_H(dtio::AdmissionControl, kDtioAdmission);
+
+// Convenience macro
+#define DTIO_ADMISSION \
+  HSHM_GET_GLOBAL_PTR_VAR(dtio::AdmissionControl, kDtioAdmission)
+
+#endif  // DTIO_INCLUDE_DTIO_ADMISSION_H_
@@ -25,11 +25,16 @@
 #ifndef DTIO_INCLUDE_DTIO_CLIENT_METADATA_MANAGER_H_
 #define DTIO_INCLUDE_DTIO_CLIENT_METADATA_MANAGER_H_
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "dtio/io_buffer.h"
+#include "dtio/io_policy.h"
 #include "hermes_shm/util/singleton.h"
 
 namespace dtio {
@@ -38,10 +43,70 @@ struct FileInfo {
   std::string absolute_path;
   int flags;
   off_t current_offset;
+  bool eof;
+  WriteBuffer write_buffer;
+  ReadaheadBuffer readahead;
+  PackedFile packed;
+  /** Kept in runtime memory, and named by MemoryName in absolute_path */
+  bool in_memory;
+  /** How the file's I/O is done, resolved when it was opened */
+  IoPolicy policy;
+  /** The errno of the first buffered write that failed, or 0 */
+  int error;
+  /**
+   * End of what this open file wrote through the runtime, whose tiers may
+   * still hold it ahead of the PFS
+   * */
+  off_t written_end;
+
+  FileInfo()
+      : flags(0),
+        current_offset(0),
+        eof(false),
+        in_memory(false),
+        error(0),
+        written_end(0) {}
+  FileInfo(const std::string& path, int f, const IoPolicy& p)
+      : absolute_path(path),
+        flags(f),
+        current_offset(0),
+        eof(false),
+        in_memory(false),
+        policy(p),
+        error(0),
+        written_end(0) {}
+
+  /** Note that the runtime was sent data of the file up to @end */
+  void Wrote(off_t end) { written_end = std::max(written_end, end); }
+
+  /**
+   * Submit the buffered writes. A failure is kept, since the write that
+   * buffered the bytes already returned, and is reported by the next sync
+   * or close.
+   * */
+  void FlushWrites() {
+    off_t end = write_buffer.Empty() ? 0 : write_buffer.End();
+    if (write_buffer.Flush(absolute_path, policy) < 0) {
+      if (error == 0) {
+        error = errno;
+      }
+    } else {
+      Wrote(end);
+    }
+  }
 
-  FileInfo() : flags(0), current_offset(0) {}
-  FileInfo(const std::string& path, int f)
-      : absolute_path(path), flags(f), current_offset(0) {}
+  /**
+   * Report a failure kept by FlushWrites once. Returns -1 with errno set if
+   * there was one, or 0.
+   * */
+  int TakeError() {
+    if (error == 0) {
+      return 0;
+    }
+    errno = error;
+    error = 0;
+    return -1;
+  }
 };
 
 class ClientMetadataManager {
@@ -50,9 +115,10 @@ class ClientMetadataManager {
   ~ClientMetadataManager() = default;
 
   // POSIX file descriptor management
-  void RegisterPosixFd(int fd, const std::string& absolute_path, int flags) {
+  void RegisterPosixFd(int fd, const std::string& absolute_path, int flags,
+                       const IoPolicy& policy) {
     std::lock_guard<std::mutex> lock(posix_mutex_);
-    posix_files_[fd] = FileInfo(absolute_path, flags);
+    posix_files_[fd] = FileInfo(absolute_path, flags, policy);
   }
 
   bool IsPosixFdRegistered(int fd) const {
@@ -80,9 +146,10 @@ class ClientMetadataManager {
   }
 
   // STDIO file pointer management
-  void RegisterStdioFp(FILE* fp, const std::string& absolute_path, int flags) {
+  void RegisterStdioFp(FILE* fp, const std::string& absolute_path, int flags,
+                       const IoPolicy& policy) {
     std::lock_guard<std::mutex> lock(stdio_mutex_);
-    stdio_files_[fp] = FileInfo(absolute_path, flags);
+    stdio_files_[fp] = FileInfo(absolute_path, flags, policy);
   }
 
   bool IsStdioFpRegistered(FILE* fp) const {
@@ -96,6 +163,16 @@ class ClientMetadataManager {
     return (it != stdio_files_.end()) ? &it->second : nullptr;
   }
 
+  std::vector<FILE*> GetStdioFps() const {
+    std::lock_guard<std::mutex> lock(stdio_mutex_);
+    std::vector<FILE*> fps;
+    fps.reserve(stdio_files_.size());
+    for (const auto& entry : stdio_files_) {
+      fps.push_back(entry.first);
+    }
+    return fps;
+  }
+
   void UnregisterStdioFp(FILE* fp) {
     std::lock_guard<std::mutex> lock(stdio_mutex_);
     stdio_files_.erase(fp);
@@ -109,6 +186,44 @@ class ClientMetadataManager {
     }
   }
 
+  /** The largest written_end of the open files of @absolute_path */
+  off_t WrittenEnd(const std::string& absolute_path) const {
+    off_t end = 0;
+    {
+      std::lock_guard<std::mutex> lock(posix_mutex_);
+      for (const auto& entry : posix_files_) {
+        if (entry.second.absolute_path == absolute_path) {
+          end = std::max(end, entry.second.written_end);
+        }
+      }
+    }
+    std::lock_guard<std::mutex> lock(stdio_mutex_);
+    for (const auto& entry : stdio_files_) {
+      if (entry.second.absolute_path == absolute_path) {
+        end = std::max(end, entry.second.written_end);
+      }
+    }
+    return end;
+  }
+
+  /** Clip the written_end of the open files of @absolute_path to @size */
+  void ClipWrittenEnd(const std::string& absolute_path, off_t size) {
+    {
+      std::lock_guard<std::mutex> lock(posix_mutex_);
+      for (auto& entry : posix_files_) {
+        if (entry.second.absolute_path == absolute_path) {
+          entry.second.written_end = std::min(entry.second.written_end, size);
+        }
+      }
+    }
+    std::lock_guard<std::mutex> lock(stdio_mutex_);
+    for (auto& entry : stdio_files_) {
+      if (entry.second.absolute_path == absolute_path) {
+        entry.second.written_end = std::min(entry.second.written_end, size);
+      }
+    }
+  }
+
  private:
   mutable std::mutex posix_mutex_;
   mutable std::mutex stdio_mutex_;
@@ -25,31 +25,124 @@
 #ifndef DTIO_INCLUDE_DTIO_CONFIG_MANAGER_H_
 #define DTIO_INCLUDE_DTIO_CONFIG_MANAGER_H_
 
+#include <unistd.h>
+
 #include <algorithm>
+#include <cstdlib>
 #include <filesystem>
+#include <functional>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "chimaera/api/chimaera_client.h"
+#include "dtio/client_metadata_manager.h"
+#include "dtio/io_policy.h"
+#include "dtio/logger.h"
 #include "dtiomod/dtiomod_client.h"
 #include "hermes_shm/util/config_parse.h"
 #include "hermes_shm/util/singleton.h"
 
 namespace dtio {
 
+/**
+ * The parts of an IoPolicy an include rule sets. The rest come from the
+ * global keys of the adapter the file is opened through.
+ * */
+struct PolicyRule {
+  std::optional<bool> sync;
+  std::optional<size_t> aggregation;
+  std::optional<size_t> readahead_min;
+  std::optional<size_t> readahead_max;
+  std::optional<LocationType> tier;
+  std::optional<bool> cacheable;
+  std::optional<IoClientType> backend;
+};
+
 struct PathEntry {
   std::string path;
   bool do_include;
+  bool in_memory; /**< Files are kept in runtime memory, not on the PFS */
+  PolicyRule policy;
 
-  PathEntry(const std::string& p, bool include)
-      : path(p), do_include(include) {}
+  PathEntry(const std::string& p, bool include, bool memory = false,
+            const PolicyRule& rule = PolicyRule())
+      : path(p), do_include(include), in_memory(memory), policy(rule) {}
 };
 
 class ConfigurationManager : public hshm::BaseConfig {
  public:
   chi::dtiomod::Client dtio_mod_;
   std::vector<PathEntry> path_entries_;
+  /** Capacity of the per-fd write-combining buffer (0 disables it) */
+  size_t write_buffer_size_ = 0;
+  /** Initial and maximum readahead window (a maximum of 0 disables it) */
+  size_t readahead_min_ = hshm::Unit<size_t>::Kilobytes(128);
+  size_t readahead_max_ = hshm::Unit<size_t>::Megabytes(8);
+  /** Capacity of the per-FILE* stdio buffer (0 disables it) */
+  size_t stdio_buffer_size_ = hshm::Unit<size_t>::Megabytes(1);
+  /** Policy the runtime uses to place I/O tasks on containers */
+  SolverImplType solver_ = SolverImplType::kDefault;
+  /** How often runtime containers report their load to the scheduler */
+  uint32_t stats_period_ms_ = 100;
+  /** Staging buffer bytes per runtime container */
+  size_t buffer_capacity_ = hshm::Unit<size_t>::Gigabytes(1);
+  /** Granularity at which the runtime homes written data on containers */
+  size_t stripe_size_ = hshm::Unit<size_t>::Megabytes(1);
+  /** I/O classes the runtime shares bandwidth between */
+  std::vector<chi::dtiomod::QosClass> qos_classes_;
+  /** The class of this client, and whether it is identified by job or pid */
+  std::string qos_class_;
+  bool qos_per_job_ = true;
+  /** Deadlines of I/O the app blocks on, and of I/O issued behind it */
+  uint32_t deadline_blocking_us_ = 1000;
+  uint32_t deadline_background_us_ = 100000;
+  /** Queued tasks per file the runtime sorts by offset (0 disables it) */
+  uint32_t elevator_window_ = 0;
+  /**
+   * Most lanes each runtime container spreads I/O tasks over, and the
+   * fewest it keeps active. It grows and shrinks between them with load.
+   * */
+  uint32_t lanes_ = 1;
+  uint32_t min_lanes_ = 1;
+  /**
+   * Tiers the runtime holds written data on ahead of the PFS: bytes of
+   * memory, and a node-local directory with its capacity (0 disables each)
+   * */
+  size_t tier_buffers_capacity_ = 0;
+  std::string tier_cache_dir_;
+  size_t tier_cache_capacity_ = 0;
+  /** Bytes per second drained from the tiers to the PFS (0 is unpaced) */
+  size_t drain_rate_ = 0;
+  /** Which read-hot blocks are copied up from the PFS onto the tiers */
+  TierPolicyType tier_policy_ = TierPolicyType::kNone;
+  /**
+   * Bytes per chunk when files are stored in chunks spread over every
+   * runtime (0 keeps each file whole)
+   * */
+  size_t chunk_size_ = 0;
+  /**
+   * Each node appends its writes to a log of its own, compacted into the
+   * file once its writers close it
+   * */
+  bool log_structured_ = false;
+  /**
+   * New files are packed into large shared pack files in pack_dir_ until
+   * they outgrow pack_threshold_ bytes, so they take no inode on the PFS
+   * (a threshold of 0 disables it)
+   * */
+  size_t pack_threshold_ = 0;
+  std::string pack_dir_;
+  /**
+   * Bytes of runtime memory per container for files under include rules
+   * marked memory, which only reach the PFS if memory runs short or they
+   * outlive the runtime (0 disables it)
+   * */
+  size_t memory_capacity_ = 0;
+  /** Shm buffer bytes in flight allowed per client and per node (0 is off) */
+  size_t client_inflight_limit_ = hshm::Unit<size_t>::Megabytes(512);
+  size_t node_inflight_limit_ = 0;
 
   ConfigurationManager() {
     // Read DTIO configuration
@@ -66,17 +159,115 @@ class ConfigurationManager : public hshm::BaseConfig {
     dtio_mod_.Create(
         HSHM_MCTX,
         chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers, 0),
-        chi::DomainQuery::GetGlobalBcast(), "dtio_runtime");
+        chi::DomainQuery::GetGlobalBcast(), "dtio_runtime",
+        chi::CreateContext(), 0, solver_, stats_period_ms_, buffer_capacity_,
+        stripe_size_, qos_classes_, elevator_window_, lanes_, min_lanes_,
+        tier_buffers_capacity_, tier_cache_dir_, tier_cache_capacity_,
+        drain_rate_, tier_policy_, chunk_size_, log_structured_,
+        PackingEnabled() ? pack_dir_ : std::string(), memory_capacity_);
+    dtio_mod_.io_opts_.client_ = QosClientId();
+    dtio_mod_.io_opts_.class_ = QosClassId();
+    dtio_mod_.io_opts_.deadline_us_ = deadline_blocking_us_;
+    if (log_structured_) {
+      dtio_mod_.logged_ = true;
+    } else if (chunk_size_) {
+      dtio_mod_.split_size_ = chunk_size_;
+      dtio_mod_.chunked_ = true;
+    } else if (TiersEnabled()) {
+      dtio_mod_.split_size_ = stripe_size_;
+    }
   }
 
   bool ShouldIntercept(const std::string& absolute_path) const {
-    // Check against path entries (already sorted by descending length)
-    for (const auto& entry : path_entries_) {
-      if (absolute_path.find(entry.path) == 0) {  // Path starts with entry.path
-        return entry.do_include;
-      }
+    const PathEntry* entry = MatchPath(absolute_path);
+    return entry && entry->do_include;  // Default to not intercept
+  }
+
+  /** Whether files at @absolute_path are kept in runtime memory */
+  bool InMemory(const std::string& absolute_path) const {
+    const PathEntry* entry = MatchPath(absolute_path);
+    return memory_capacity_ && entry && entry->do_include && entry->in_memory;
+  }
+
+  /**
+   * The I/O policy of a file at @absolute_path opened through @adapter:
+   * that adapter's defaults, with what the rule the path falls under sets
+   * on top. Adapters resolve it once at open and keep it in FileInfo.
+   * */
+  IoPolicy Policy(const std::string& absolute_path,
+                  IoClientType adapter) const {
+    IoPolicy policy;
+    if (adapter == IoClientType::kStdio) {
+      // The stream buffer both combines writes and reads ahead
+      policy.aggregation = stdio_buffer_size_;
+      policy.readahead_min = stdio_buffer_size_;
+      policy.readahead_max = stdio_buffer_size_;
+    } else {
+      policy.aggregation = write_buffer_size_;
+      policy.readahead_min = readahead_min_;
+      policy.readahead_max = readahead_max_;
+    }
+    policy.backend = adapter;
+    policy.opts = dtio_mod_.io_opts_;
+    const PathEntry* entry = MatchPath(absolute_path);
+    if (entry && entry->do_include) {
+      const PolicyRule& rule = entry->policy;
+      policy.sync = rule.sync.value_or(policy.sync);
+      policy.aggregation = rule.aggregation.value_or(policy.aggregation);
+      policy.readahead_min = rule.readahead_min.value_or(policy.readahead_min);
+      policy.readahead_max = rule.readahead_max.value_or(policy.readahead_max);
+      policy.backend = rule.backend.value_or(policy.backend);
+      policy.opts.tier_ = static_cast<uint32_t>(
+          rule.tier.value_or(LocationType::kBuffers));
+      policy.opts.cacheable_ = rule.cacheable.value_or(true);
     }
-    return false;  // Default to not intercept
+    if (policy.sync) {
+      policy.aggregation = 0;
+      policy.opts.tier_ = static_cast<uint32_t>(LocationType::kPfs);
+    }
+    return policy;
+  }
+
+  /** Whether the runtime holds written data in tiers above the PFS */
+  bool TiersEnabled() const {
+    return tier_buffers_capacity_ ||
+           (!tier_cache_dir_.empty() && tier_cache_capacity_);
+  }
+
+  /**
+   * End of the data the runtime's tiers may hold for @absolute_path ahead
+   * of the PFS, or 0 if none. The file is as long as the larger of this and
+   * its size on the PFS. It is what this process wrote through its open
+   * files, so metadata calls need not ask the runtime.
+   * */
+  size_t HeldEnd(const std::string& absolute_path) {
+    if (!TiersEnabled() || log_structured_) {
+      return 0;
+    }
+    return DTIO_CLIENT_META->WrittenEnd(absolute_path);
+  }
+
+  /**
+   * Put what the runtime holds of @absolute_path on the PFS: drain it from
+   * the tiers, or sync this node's log of it, as other nodes' logs are
+   * their own. Returns false if some of it is still not there.
+   * */
+  bool Persist(const std::string& absolute_path) {
+    chi::dtiomod::StageProgress progress;
+    if (log_structured_) {
+      progress = dtio_mod_.Flush(HSHM_MCTX, chi::DomainQuery::GetLocalHash(0),
+                                 chi::string(absolute_path), true);
+    } else if (TiersEnabled()) {
+      progress = dtio_mod_.Flush(HSHM_MCTX, chi::string(absolute_path));
+    } else {
+      return true;
+    }
+    return progress.held_bytes_ == 0 && !progress.sync_failed_;
+  }
+
+  /** Whether small files are packed instead of created on the PFS */
+  bool PackingEnabled() const {
+    return pack_threshold_ && !pack_dir_.empty();
   }
 
   void LoadDefault() override {
@@ -84,28 +275,340 @@ class ConfigurationManager : public hshm::BaseConfig {
     path_entries_.clear();
     path_entries_.emplace_back("/tmp", true);
     path_entries_.emplace_back("/", false);
+    write_buffer_size_ = 0;
+    readahead_min_ = hshm::Unit<size_t>::Kilobytes(128);
+    readahead_max_ = hshm::Unit<size_t>::Megabytes(8);
+    stdio_buffer_size_ = hshm::Unit<size_t>::Megabytes(1);
+    solver_ = SolverImplType::kDefault;
+    stats_period_ms_ = 100;
+    buffer_capacity_ = hshm::Unit<size_t>::Gigabytes(1);
+    stripe_size_ = hshm::Unit<size_t>::Megabytes(1);
+    qos_classes_.clear();
+    qos_class_.clear();
+    qos_per_job_ = true;
+    deadline_blocking_us_ = 1000;
+    deadline_background_us_ = 100000;
+    elevator_window_ = 0;
+    lanes_ = 1;
+    min_lanes_ = 1;
+    tier_buffers_capacity_ = 0;
+    tier_cache_dir_.clear();
+    tier_cache_capacity_ = 0;
+    drain_rate_ = 0;
+    tier_policy_ = TierPolicyType::kNone;
+    chunk_size_ = 0;
+    log_structured_ = false;
+    pack_threshold_ = 0;
+    pack_dir_.clear();
+    memory_capacity_ = 0;
+    client_inflight_limit_ = hshm::Unit<size_t>::Megabytes(512);
+    node_inflight_limit_ = 0;
   }
 
  private:
+  /** The longest path entry @absolute_path is under, if any */
+  const PathEntry* MatchPath(const std::string& absolute_path) const {
+    // Check against path entries (already sorted by descending length)
+    for (const auto& entry : path_entries_) {
+      if (absolute_path.find(entry.path) == 0) {  // Path starts with entry.path
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  static SolverImplType ParseSolver(const std::string& name) {
+    if (name == "dp") {
+      return SolverImplType::kDp;
+    } else if (name == "greedy") {
+      return SolverImplType::kGreedy;
+    } else if (name == "round_robin") {
+      return SolverImplType::kRoundRobin;
+    } else if (name == "random") {
+      return SolverImplType::kRandomSelect;
+    } else if (name != "default") {
+      DTIO_LOG_WARNING("Unknown scheduler {}, using the default", name);
+    }
+    return SolverImplType::kDefault;
+  }
+
+  static TierPolicyType ParseTierPolicy(const std::string& name) {
+    if (name == "lru") {
+      return TierPolicyType::kLru;
+    } else if (name == "arc") {
+      return TierPolicyType::kArc;
+    } else if (name == "lfu") {
+      return TierPolicyType::kLfu;
+    } else if (name != "none") {
+      DTIO_LOG_WARNING("Unknown tier policy {}, using none", name);
+    }
+    return TierPolicyType::kNone;
+  }
+
+  static std::optional<LocationType> ParseTier(const std::string& name) {
+    if (name == "memory") {
+      return LocationType::kBuffers;
+    } else if (name == "cache") {
+      return LocationType::kCache;
+    } else if (name == "pfs") {
+      return LocationType::kPfs;
+    }
+    DTIO_LOG_WARNING("Unknown tier {}, using the default", name);
+    return std::nullopt;
+  }
+
+  /**
+   * The runtime only moves data with the posix and stdio clients. Files
+   * asking for another backend keep the one of the adapter they are opened
+   * through.
+   * */
+  static std::optional<IoClientType> ParseBackend(const std::string& name) {
+    if (name == "posix") {
+      return IoClientType::kPosix;
+    } else if (name == "stdio") {
+      return IoClientType::kStdio;
+    } else if (name == "uring" || name == "hdf5") {
+      DTIO_LOG_WARNING("The runtime has no {} backend, using the default",
+                       name);
+    } else {
+      DTIO_LOG_WARNING("Unknown backend {}, using the default", name);
+    }
+    return std::nullopt;
+  }
+
+  /** The policy keys of an include rule given as a map */
+  static PolicyRule ParsePolicyRule(YAML::Node& entry) {
+    PolicyRule rule;
+    if (entry["sync"]) {
+      rule.sync = entry["sync"].as<bool>();
+    }
+    if (entry["aggregation"]) {
+      rule.aggregation = hshm::ConfigParse::ParseSize(
+          entry["aggregation"].as<std::string>());
+    }
+    if (entry["readahead_min"]) {
+      rule.readahead_min = hshm::ConfigParse::ParseSize(
+          entry["readahead_min"].as<std::string>());
+    }
+    if (entry["readahead_max"]) {
+      rule.readahead_max = hshm::ConfigParse::ParseSize(
+          entry["readahead_max"].as<std::string>());
+    }
+    if (entry["tier"]) {
+      rule.tier = ParseTier(entry["tier"].as<std::string>());
+    }
+    if (entry["cacheable"]) {
+      rule.cacheable = entry["cacheable"].as<bool>();
+    }
+    if (entry["backend"]) {
+      rule.backend = ParseBackend(entry["backend"].as<std::string>());
+    }
+    return rule;
+  }
+
+  /** The job this process belongs to, or the process itself */
+  uint64_t QosClientId() const {
+    if (qos_per_job_) {
+      for (const char* var :
+           {"SLURM_JOB_ID", "PBS_JOBID", "LSB_JOBID", "COBALT_JOBID"}) {
+        const char* job = std::getenv(var);
+        if (job && *job) {
+          return std::hash<std::string>{}(job);
+        }
+      }
+    }
+    return static_cast<uint64_t>(getpid());
+  }
+
+  /** Index of this client's class in qos_classes_ */
+  uint32_t QosClassId() const {
+    for (size_t i = 0; i < qos_classes_.size(); ++i) {
+      if (qos_classes_[i].name_ == qos_class_) {
+        return i;
+      }
+    }
+    if (!qos_class_.empty()) {
+      DTIO_LOG_WARNING("Unknown QoS class {}, using the first class",
+                       qos_class_);
+    }
+    return 0;
+  }
+
   void ParseYAML(YAML::Node& yaml_conf) override {
-    std::vector<std::string> include_paths;
+    std::vector<PathEntry> include_paths;
     std::vector<std::string> exclude_paths;
 
     if (yaml_conf["include"]) {
-      BaseConfig::ParseVector<std::string>(yaml_conf["include"], include_paths);
+      // An include is a path, or a map of a path, whether its files are kept
+      // in memory, and the I/O policy of its files
+      for (YAML::Node entry : yaml_conf["include"]) {
+        if (entry.IsMap()) {
+          include_paths.emplace_back(
+              entry["path"].as<std::string>(), true,
+              entry["memory"] && entry["memory"].as<bool>(),
+              ParsePolicyRule(entry));
+        } else {
+          include_paths.emplace_back(entry.as<std::string>(), true);
+        }
+      }
     }
 
     if (yaml_conf["exclude"]) {
       BaseConfig::ParseVector<std::string>(yaml_conf["exclude"], exclude_paths);
     }
 
+    if (yaml_conf["write_buffer_size"]) {
+      write_buffer_size_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["write_buffer_size"].as<std::string>());
+    }
+
+    if (yaml_conf["readahead_min"]) {
+      readahead_min_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["readahead_min"].as<std::string>());
+    }
+
+    if (yaml_conf["readahead_max"]) {
+      readahead_max_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["readahead_max"].as<std::string>());
+    }
+
+    if (yaml_conf["stdio_buffer_size"]) {
+      stdio_buffer_size_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["stdio_buffer_size"].as<std::string>());
+    }
+
+    if (yaml_conf["scheduler"]) {
+      solver_ = ParseSolver(yaml_conf["scheduler"].as<std::string>());
+    }
+
+    if (yaml_conf["stats_period_ms"]) {
+      stats_period_ms_ = yaml_conf["stats_period_ms"].as<uint32_t>();
+    }
+
+    if (yaml_conf["buffer_capacity"]) {
+      buffer_capacity_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["buffer_capacity"].as<std::string>());
+    }
+
+    if (yaml_conf["stripe_size"]) {
+      stripe_size_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["stripe_size"].as<std::string>());
+    }
+
+    if (yaml_conf["qos_classes"]) {
+      qos_classes_.clear();
+      for (const auto& node : yaml_conf["qos_classes"]) {
+        chi::dtiomod::QosClass qos;
+        qos.name_ = node["name"].as<std::string>();
+        if (node["weight"]) {
+          qos.weight_ = node["weight"].as<uint32_t>();
+        }
+        if (node["bytes_per_sec"]) {
+          qos.bytes_per_sec_ = hshm::ConfigParse::ParseSize(
+              node["bytes_per_sec"].as<std::string>());
+        }
+        if (node["ops_per_sec"]) {
+          qos.ops_per_sec_ = node["ops_per_sec"].as<size_t>();
+        }
+        qos_classes_.emplace_back(qos);
+      }
+    }
+
+    if (yaml_conf["qos_class"]) {
+      qos_class_ = yaml_conf["qos_class"].as<std::string>();
+    }
+
+    if (yaml_conf["qos_client"]) {
+      qos_per_job_ = yaml_conf["qos_client"].as<std::string>() != "pid";
+    }
+
+    if (yaml_conf["deadline_blocking_us"]) {
+      deadline_blocking_us_ = yaml_conf["deadline_blocking_us"].as<uint32_t>();
+    }
+
+    if (yaml_conf["deadline_background_us"]) {
+      deadline_background_us_ =
+          yaml_conf["deadline_background_us"].as<uint32_t>();
+    }
+
+    if (yaml_conf["elevator_window"]) {
+      elevator_window_ = yaml_conf["elevator_window"].as<uint32_t>();
+    }
+
+    if (yaml_conf["lanes"]) {
+      lanes_ = yaml_conf["lanes"].as<uint32_t>();
+    }
+
+    if (yaml_conf["min_lanes"]) {
+      min_lanes_ = yaml_conf["min_lanes"].as<uint32_t>();
+    }
+
+    if (yaml_conf["tier_buffers_capacity"]) {
+      tier_buffers_capacity_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["tier_buffers_capacity"].as<std::string>());
+    }
+
+    if (yaml_conf["tier_cache_dir"]) {
+      tier_cache_dir_ = hshm::ConfigParse::ExpandPath(
+          yaml_conf["tier_cache_dir"].as<std::string>());
+    }
+
+    if (yaml_conf["tier_cache_capacity"]) {
+      tier_cache_capacity_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["tier_cache_capacity"].as<std::string>());
+    }
+
+    if (yaml_conf["drain_rate"]) {
+      drain_rate_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["drain_rate"].as<std::string>());
+    }
+
+    if (yaml_conf["tier_policy"]) {
+      tier_policy_ =
+          ParseTierPolicy(yaml_conf["tier_policy"].as<std::string>());
+    }
+
+    if (yaml_conf["chunk_size"]) {
+      chunk_size_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["chunk_size"].as<std::string>());
+    }
+
+    if (yaml_conf["log_structured"]) {
+      log_structured_ = yaml_conf["log_structured"].as<bool>();
+    }
+
+    if (yaml_conf["pack_threshold"]) {
+      pack_threshold_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["pack_threshold"].as<std::string>());
+    }
+
+    if (yaml_conf["pack_dir"]) {
+      pack_dir_ = hshm::ConfigParse::ExpandPath(
+          yaml_conf["pack_dir"].as<std::string>());
+    }
+
+    if (yaml_conf["memory_capacity"]) {
+      memory_capacity_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["memory_capacity"].as<std::string>());
+    }
+
+    if (yaml_conf["client_inflight_limit"]) {
+      client_inflight_limit_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["client_inflight_limit"].as<std::string>());
+    }
+
+    if (yaml_conf["node_inflight_limit"]) {
+      node_inflight_limit_ = hshm::ConfigParse::ParseSize(
+          yaml_conf["node_inflight_limit"].as<std::string>());
+    }
+
     // Convert to expanded, absolute paths and combine
     path_entries_.clear();
 
-    for (const auto& path : include_paths) {
-      std::string expanded = hshm::ConfigParse::ExpandPath(path);
-      std::string abs_path = std::filesystem::absolute(expanded).string();
-      path_entries_.emplace_back(abs_path, true);
+    for (PathEntry& entry : include_paths) {
+      std::string expanded = hshm::ConfigParse::ExpandPath(entry.path);
+      entry.path = std::filesystem::absolute(expanded).string();
+      path_entries_.emplace_back(std::move(entry));
     }
 
     for (const auto& path : exclude_paths) {
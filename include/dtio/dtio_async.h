@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 Gnosis Research Center <grc@iit.edu>,
+ * Keith Bateman <kbateman@hawk.iit.edu>, Neeraj Rajesh
+ * <nrajesh@hawk.iit.edu> Hariharan Devarajan
+ * <hdevarajan@hawk.iit.edu>, Anthony Kougkas <akougkas@iit.edu>,
+ * Xian-He Sun <sun@iit.edu>
+ *
+ * This file is part of DTIO
+ *
+ * DTIO is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DTIO_INCLUDE_DTIO_DTIO_ASYNC_H_
+#define DTIO_INCLUDE_DTIO_DTIO_ASYNC_H_
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * Asynchronous I/O on files opened through the DTIO adapters. Each call
+ * reserves the range at the current file offset, advances the offset, and
+ * submits the transfer to the DTIO runtime without waiting for it. Write
+ * data is staged at submission, so the buffer can be reused right away; a
+ * read buffer must stay valid until its handle completes.
+ *
+ * A handle is released once wait, wait_any, wait_all, or a successful test
+ * reports its result. Files that DTIO does not intercept are transferred
+ * synchronously and return an already completed handle.
+ * */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** An outstanding asynchronous operation */
+typedef struct dtio_io_handle dtio_io_handle_t;
+
+dtio_io_handle_t *dtio_fwrite_async(const void *ptr, size_t size, size_t count,
+                                    FILE *stream);
+dtio_io_handle_t *dtio_fread_async(void *ptr, size_t size, size_t count,
+                                   FILE *stream);
+dtio_io_handle_t *dtio_write_async(int fd, const void *buf, size_t count);
+dtio_io_handle_t *dtio_read_async(int fd, void *buf, size_t count);
+
+/** Block until @handle completes. Returns the bytes transferred or -1. */
+ssize_t dtio_wait(dtio_io_handle_t *handle);
+
+/**
+ * Check whether @handle completed without blocking. If so, stores the bytes
+ * transferred (or -1) in @bytes, releases the handle, and returns 1.
+ * */
+int dtio_test(dtio_io_handle_t *handle, ssize_t *bytes);
+
+/**
+ * Block until any handle in @handles completes. Its slot is set to NULL and
+ * its index is returned; the bytes transferred are stored in @bytes. NULL
+ * slots are skipped. Returns -1 if there is nothing to wait for.
+ * */
+ssize_t dtio_wait_any(dtio_io_handle_t **handles, size_t count,
+                      ssize_t *bytes);
+
+/**
+ * Block until every handle in @handles completes and set the slots to NULL.
+ * Returns the total bytes transferred, or -1 if any operation failed.
+ * */
+ssize_t dtio_wait_all(dtio_io_handle_t **handles, size_t count);
+
+#ifdef __cplusplus
+}
+
+namespace dtio {
+
+typedef dtio_io_handle_t IoHandle;
+
+inline IoHandle *fwrite_async(const void *ptr, size_t size, size_t count,
+                              FILE *stream) {
+  return dtio_fwrite_async(ptr, size, count, stream);
+}
+
+inline IoHandle *fread_async(void *ptr, size_t size, size_t count,
+                             FILE *stream) {
+  return dtio_fread_async(ptr, size, count, stream);
+}
+
+inline IoHandle *write_async(int fd, const void *buf, size_t count) {
+  return dtio_write_async(fd, buf, count);
+}
+
+inline IoHandle *read_async(int fd, void *buf, size_t count) {
+  return dtio_read_async(fd, buf, count);
+}
+
+inline ssize_t wait(IoHandle *handle) { return dtio_wait(handle); }
+
+inline bool test(IoHandle *handle, ssize_t *bytes) {
+  return dtio_test(handle, bytes) != 0;
+}
+
+inline ssize_t wait_any(IoHandle **handles, size_t count, ssize_t *bytes) {
+  return dtio_wait_any(handles, count, bytes);
+}
+
+inline ssize_t wait_all(IoHandle **handles, size_t count) {
+  return dtio_wait_all(handles, count);
+}
+
+}  // namespace dtio
+#endif
+
+#endif  // DTIO_INCLUDE_DTIO_DTIO_ASYNC_H_
@@ -96,6 +96,8 @@ enum class SolverImplType {
   kDefault = 4
 };
 
+enum class TierPolicyType { kNone = 0, kLru = 1, kArc = 2, kLfu = 3 };
+
 // NOTE: kMulti should always be the last interface type, and should not be
 // used in tasks. It's used to get the number of interfaces for the purpose of
 // the worker-side multi client
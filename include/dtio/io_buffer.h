@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2024 Gnosis Research Center <grc@iit.edu>,
+ * Keith Bateman <kbateman@hawk.iit.edu>, Neeraj Rajesh
+ * <nrajesh@hawk.iit.edu> Hariharan Devarajan
+ * <hdevarajan@hawk.iit.edu>, Anthony Kougkas <akougkas@iit.edu>,
+ * Xian-He Sun <sun@iit.edu>
+ *
+ * This file is part of DTIO
+ *
+ * DTIO is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DTIO_INCLUDE_DTIO_IO_BUFFER_H_
+#define DTIO_INCLUDE_DTIO_IO_BUFFER_H_
+
+#include <sys/types.h>
+
+#include <functional>
+#include <string>
+
+#include "chimaera/api/chimaera_client.h"
+#include "dtio/dtio_enumerations.h"
+#include "dtio/io_policy.h"
+#include "dtiomod/dtiomod_client.h"
+
+namespace dtio {
+
+/**
+ * A client-side write-combining buffer for one open file. Small sequential
+ * writes are appended to a shm staging region and submitted to the runtime
+ * as a single Write task once the region fills up or the access pattern
+ * breaks.
+ * */
+class WriteBuffer {
+ public:
+  WriteBuffer() = default;
+
+  /** Whether any bytes are waiting to be written */
+  bool Empty() const { return size_ == 0; }
+
+  /** The file offset one past the last buffered byte */
+  off_t End() const { return offset_ + static_cast<off_t>(size_); }
+
+  /** Whether the buffered range intersects [off, off + size) */
+  bool Overlaps(off_t off, size_t size) const {
+    return !Empty() && off < End() && offset_ < off + static_cast<off_t>(size);
+  }
+
+  /** Whether a write of @size bytes at @off can be appended without a flush */
+  bool CanAppend(off_t off, size_t size) const {
+    return Empty() || (off == End() && size_ + size <= capacity_);
+  }
+
+  /** Whether the buffer has no room left */
+  bool Full() const { return capacity_ > 0 && size_ == capacity_; }
+
+  /**
+   * Append @size bytes at file offset @off. The staging region is allocated
+   * with @capacity bytes on first use. The caller must check CanAppend.
+   * */
+  void Append(off_t off, const void *data, size_t size, size_t capacity);
+
+  /**
+   * Submit the buffered bytes as one Write task for @path. The buffer is
+   * emptied either way. Returns the bytes written, or -1 with errno if they
+   * were not all written.
+   * */
+  ssize_t Flush(const std::string &path, const IoPolicy &policy);
+
+  /** Drop the staging region. Buffered bytes must be flushed first. */
+  void Release();
+
+ private:
+  hipc::FullPtr<char> data_;
+  size_t capacity_ = 0;
+  off_t offset_ = 0;
+  size_t size_ = 0;
+};
+
+/**
+ * Client-side adaptive readahead for one open file. Reads that continue the
+ * previous one are served from a shm window that is refilled by asynchronous
+ * Read tasks. The window doubles with every sequential refill (up to a
+ * configured maximum) and collapses back to nothing on random access.
+ * */
+class ReadaheadBuffer {
+ public:
+  /**
+   * Called with the file range a window is about to be filled from, e.g.,
+   * to flush buffered writes to it first
+   * */
+  using FetchHook = std::function<void(off_t off, size_t size)>;
+
+  ReadaheadBuffer() = default;
+
+  /**
+   * Serve a read of @size bytes at @off into @buf. The window grows between
+   * the readahead bounds of @policy, and @before_fetch sees every range it
+   * is filled from. Returns the number of bytes served (short only at EOF),
+   * or -1 if the read is not sequential and missed the window, in which
+   * case it must go to the runtime directly.
+   * */
+  ssize_t Read(const std::string &path, const IoPolicy &policy, off_t off,
+               void *buf, size_t size, const FetchHook &before_fetch);
+
+  /**
+   * Make @off the next sequential offset, e.g., when the caller consumed
+   * fewer bytes than Read returned.
+   * */
+  void Rewind(off_t off) { expected_ = off; }
+
+  /** Drop prefetched data, e.g., after the file was written */
+  void Invalidate();
+
+  /** Drop the windows and their shm regions */
+  void Release();
+
+ private:
+  /** A contiguous range of the file held in shm */
+  struct Window {
+    hipc::FullPtr<char> data_;
+    hipc::FullPtr<chi::dtiomod::ReadTask> task_;
+    size_t capacity_ = 0;
+    off_t offset_ = 0;
+    size_t length_ = 0; /**< Bytes requested from the runtime */
+    size_t size_ = 0;   /**< Bytes actually read (short at EOF) */
+    bool pending_ = false;
+
+    /** Whether @off lies in the range this window holds (or will hold) */
+    bool Contains(off_t off) const {
+      size_t len = pending_ ? length_ : size_;
+      return offset_ <= off && off < offset_ + static_cast<off_t>(len);
+    }
+  };
+
+  /** Fill @win with @size bytes at @off, asynchronously if @async */
+  void Fetch(Window &win, const std::string &path, const IoPolicy &policy,
+             off_t off, size_t size, bool async, const FetchHook &before_fetch);
+
+  /**
+   * Fill cur_ with @size bytes at @off, and start filling next_ with the
+   * @next_size bytes after them. Both reads are placed by one Schedule
+   * task.
+   * */
+  void FetchAhead(const std::string &path, const IoPolicy &policy, off_t off,
+                  size_t size, size_t next_size, const FetchHook &before_fetch);
+
+  /** Make @win hold @size bytes at @off once its read is issued */
+  void Prepare(Window &win, off_t off, size_t size,
+               const FetchHook &before_fetch);
+
+  /** Issue the read that fills @win on the container @dom */
+  void Issue(Window &win, const chi::DomainQuery &dom, const std::string &path,
+             const IoPolicy &policy, bool async);
+
+  /** Wait for an outstanding fetch into @win */
+  void Complete(Window &win);
+
+  /** Drop the contents of @win, keeping its shm region */
+  void Drop(Window &win);
+
+  /** Free the shm region of @win */
+  void Free(Window &win);
+
+  Window cur_;
+  Window next_;
+  off_t expected_ = 0;
+  size_t window_ = 0;
+};
+
+/**
+ * A small file held whole by the client while it is open, when small files
+ * are packed. It is loaded from its pack on open and packed again on close
+ * if it was written, so it never costs a create or an inode on the PFS. A
+ * file written past the pack threshold is spilled onto the PFS instead.
+ * */
+class PackedFile {
+ public:
+  PackedFile() = default;
+
+  /** Whether the file is held here rather than on the PFS */
+  bool Active() const { return active_; }
+
+  size_t Size() const { return data_.size(); }
+
+  mode_t Mode() const { return mode_; }
+
+  /**
+   * Open @path with @flags and @mode as a packed file. Returns 1 if it is
+   * packed or was created packed, 0 if it is on the PFS, or -1 with errno.
+   * */
+  int Open(const std::string &path, int flags, mode_t mode);
+
+  /** Copy up to @size bytes at @off into @buf. Returns the bytes copied. */
+  ssize_t Read(off_t off, void *buf, size_t size) const;
+
+  /**
+   * Write @size bytes at @off. Returns false, writing nothing, if the file
+   * would outgrow the pack threshold.
+   * */
+  bool Write(off_t off, const void *buf, size_t size);
+
+  /** Pack the file if it was written since it was last packed */
+  int Store(const std::string &path);
+
+  /**
+   * Write the file to @path on the PFS through the runtime, and drop it
+   * from its pack. The file is no longer held here after this. If not all
+   * of it was written, returns -1 with errno EIO, and the file stays
+   * packed.
+   * */
+  ssize_t Spill(const std::string &path, const IoPolicy &policy);
+
+  /** What stat reports of @path, if it is packed */
+  static bool Stat(const std::string &path, chi::dtiomod::PackInfo &info);
+
+  /** Drop @path from its pack. Returns false if it is not packed. */
+  static bool Remove(const std::string &path);
+
+ private:
+  std::string data_;
+  mode_t mode_ = 0;
+  bool active_ = false;
+  bool dirty_ = false; /**< Written since it was last packed */
+};
+
+}  // namespace dtio
+
+#endif  // DTIO_INCLUDE_DTIO_IO_BUFFER_H_
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Gnosis Research Center <grc@iit.edu>,
+ * Keith Bateman <kbateman@hawk.iit.edu>, Neeraj Rajesh
+ * <nrajesh@hawk.iit.edu> Hariharan Devarajan
+ * <hdevarajan@hawk.iit.edu>, Anthony Kougkas <akougkas@iit.edu>,
+ * Xian-He Sun <sun@iit.edu>
+ *
+ * This file is part of DTIO
+ *
+ * DTIO is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DTIO_INCLUDE_DTIO_IO_POLICY_H_
+#define DTIO_INCLUDE_DTIO_IO_POLICY_H_
+
+#include <cstddef>
+
+#include "dtio/dtio_enumerations.h"
+#include "dtiomod/dtiomod_client.h"
+
+namespace dtio {
+
+/**
+ * How the I/O of one open file is done. It is resolved from the defaults
+ * and the path rule the file falls under when it is opened, and kept in
+ * its FileInfo, so the I/O path never matches rules.
+ * */
+struct IoPolicy {
+  /**
+   * Writes go straight to the PFS: none are combined, and the runtime holds
+   * none on its tiers. Otherwise they are written behind.
+   * */
+  bool sync = false;
+  /** Capacity of the write-combining buffer (0 disables it) */
+  size_t aggregation = 0;
+  /** Initial and maximum readahead window (a maximum of 0 disables it) */
+  size_t readahead_min = 0;
+  size_t readahead_max = 0;
+  /** The runtime I/O client the file's data is moved with */
+  IoClientType backend = IoClientType::kPosix;
+  /**
+   * Options of the file's I/O tasks, including the fastest tier the runtime
+   * may hold its data on and whether its hot blocks may be copied up
+   * */
+  chi::dtiomod::IoOpts opts;
+};
+
+}  // namespace dtio
+
+#endif  // DTIO_INCLUDE_DTIO_IO_POLICY_H_
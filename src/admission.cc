@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 Gnosis Research Center <grc@iit.edu>,
+ * Keith Bateman <kbateman@hawk.iit.edu>, Neeraj Rajesh
+ * <nrajesh@hawk.iit.edu> Hariharan Devarajan
+ * <hdevarajan@hawk.iit.edu>, Anthony Kougkas <akougkas@iit.edu>,
+ * Xian-He Sun <sun@iit.edu>
+ *
+ * This file is part of DTIO
+ *
+ * DTIO is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "dtio/admission.h"
+
+#include <thread>
+
+#include "dtio/config_manager.h"
+
+// Define the global singleton variable
+HSHM_DEFINE_GLOBAL_PTR_VAR_CC(dtio::AdmissionControl, kDtioAdmission);
+
+namespace dtio {
+
+AdmissionControl::AdmissionControl() {
+  auto *config = DTIO_CONF;
+  client_limit_ = config->client_inflight_limit_;
+  node_limit_ = config->node_inflight_limit_;
+}
+
+bool AdmissionControl::TryAcquire(size_t size) {
+  std::unique_lock<std::mutex> guard(lock_);
+  Reap();
+  RefreshNode(guard, false);
+  if (!Fits(size)) {
+    return false;
+  }
+  inflight_ += size;
+  node_inflight_ += size;
+  return true;
+}
+
+void AdmissionControl::Acquire(size_t size) {
+  auto backoff = std::chrono::microseconds(50);
+  for (bool force = false;; force = true) {
+    {
+      std::unique_lock<std::mutex> guard(lock_);
+      Reap();
+      RefreshNode(guard, force);
+      if (Fits(size)) {
+        inflight_ += size;
+        node_inflight_ += size;
+        return;
+      }
+    }
+    std::this_thread::sleep_for(backoff);
+    backoff = std::min<std::chrono::microseconds>(
+        backoff * 2, std::chrono::milliseconds(kRefreshMs));
+  }
+}
+
+void AdmissionControl::Release(size_t size) {
+  std::lock_guard<std::mutex> guard(lock_);
+  inflight_ -= size;
+  node_inflight_ -= std::min(node_inflight_, size);
+}
+
+void AdmissionControl::Track(const void *key, chi::Task *task, size_t size) {
+  std::lock_guard<std::mutex> guard(lock_);
+  tracked_[key] = Tracked{task, size};
+}
+
+void AdmissionControl::Untrack(const void *key) {
+  std::lock_guard<std::mutex> guard(lock_);
+  auto it = tracked_.find(key);
+  if (it == tracked_.end()) {
+    return;
+  }
+  inflight_ -= it->second.size_;
+  node_inflight_ -= std::min(node_inflight_, it->second.size_);
+  tracked_.erase(it);
+}
+
+bool AdmissionControl::Fits(size_t size) {
+  bool client_fits =
+      !client_limit_ || !inflight_ || inflight_ + size <= client_limit_;
+  bool node_fits =
+      !node_limit_ || !node_inflight_ || node_inflight_ + size <= node_limit_;
+  return client_fits && node_fits;
+}
+
+void AdmissionControl::Reap() {
+  for (auto it = tracked_.begin(); it != tracked_.end();) {
+    if (it->second.task_->IsComplete()) {
+      inflight_ -= it->second.size_;
+      node_inflight_ -= std::min(node_inflight_, it->second.size_);
+      it = tracked_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void AdmissionControl::RefreshNode(std::unique_lock<std::mutex> &guard,
+                                   bool force) {
+  if (!node_limit_) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - node_time_ < std::chrono::milliseconds(kRefreshMs)) {
+    return;
+  }
+  // Other threads skip the refresh while this one waits on the runtime
+  node_time_ = now;
+  guard.unlock();
+  auto &dtio_mod = DTIO_CONF->dtio_mod_;
+  size_t node_bytes =
+      dtio_mod
+          .Inflight(HSHM_MCTX, chi::DomainQuery::GetLocalHash(0),
+                    dtio_mod.io_opts_.client_)
+          .node_bytes_;
+  guard.lock();
+  node_inflight_ = node_bytes;
+}
+
+AdmissionScope::AdmissionScope(size_t size) : size_(size) {
+  DTIO_ADMISSION->Acquire(size_);
+}
+
+AdmissionScope::~AdmissionScope() { DTIO_ADMISSION->Release(size_); }
+
+}  // namespace dtio
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2024 Gnosis Research Center <grc@iit.edu>,
+ * Keith Bateman <kbateman@hawk.iit.edu>, Neeraj Rajesh
+ * <nrajesh@hawk.iit.edu> Hariharan Devarajan
+ * <hdevarajan@hawk.iit.edu>, Anthony Kougkas <akougkas@iit.edu>,
+ * Xian-He Sun <sun@iit.edu>
+ *
+ * This file is part of DTIO
+ *
+ * DTIO is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "dtio/dtio_async.h"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <thread>
+
+#include "dtio/admission.h"
+#include "dtio/client_metadata_manager.h"
+#include "dtio/config_manager.h"
+
+/** An outstanding asynchronous operation */
+struct dtio_io_handle {
+  hipc::FullPtr<chi::dtiomod::WriteTask> write_task_;
+  hipc::FullPtr<chi::dtiomod::ReadTask> read_task_;
+  hipc::FullPtr<char> data_;
+  void *read_buf_ = nullptr;
+  ssize_t ret_ = 0;
+  bool done_ = false;
+};
+
+namespace dtio {
+
+/** A handle for an operation that already finished */
+static dtio_io_handle_t *CompletedHandle(ssize_t ret) {
+  auto *handle = new dtio_io_handle();
+  handle->ret_ = ret;
+  handle->done_ = true;
+  return handle;
+}
+
+static ssize_t Finish(dtio_io_handle_t *handle);
+
+/** Submit a write of @size bytes at the current offset of @file_info */
+static dtio_io_handle_t *SubmitWrite(FileInfo *file_info, const void *buf,
+                                     size_t size) {
+  if (size == 0) {
+    return CompletedHandle(0);
+  }
+
+  // Buffered writes must not be overtaken, and prefetched data goes stale
+  const IoPolicy &policy = file_info->policy;
+  file_info->FlushWrites();
+  file_info->readahead.Invalidate();
+
+  // A write split over several containers completes inline
+  // Sizes count the write from its submission, as the runtime may hold it
+  file_info->Wrote(file_info->current_offset + size);
+  auto &dtio_mod = DTIO_CONF->dtio_mod_;
+  chi::string path(file_info->absolute_path);
+  if (dtio_mod.SplitIo(file_info->current_offset, size).size() > 1) {
+    AdmissionScope admit(size);
+    hipc::FullPtr<char> data = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+    memcpy(data.ptr_, buf, size);
+    ssize_t ret =
+        dtio_mod.Write(HSHM_MCTX, data.shm_, size, file_info->current_offset,
+                       path, policy.backend, policy.opts);
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, data);
+    return CompletedHandle(ret);
+  }
+
+  // Past the in-flight limit the write waits for room and completes inline
+  bool async = DTIO_ADMISSION->TryAcquire(size);
+  if (!async) {
+    DTIO_ADMISSION->Acquire(size);
+  }
+  auto *handle = new dtio_io_handle();
+  handle->data_ = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+  memcpy(handle->data_.ptr_, buf, size);
+  handle->write_task_ = dtio_mod.AsyncWrite(
+      HSHM_MCTX,
+      dtio_mod.ScheduleIo(HSHM_MCTX, path, file_info->current_offset, size,
+                          Operation::kWrite),
+      handle->data_.shm_, size, file_info->current_offset, path,
+      policy.backend,
+      policy.opts.WithDeadline(DTIO_CONF->deadline_background_us_));
+  DTIO_ADMISSION->Track(handle, handle->write_task_.ptr_, size);
+  if (!async) {
+    return CompletedHandle(Finish(handle));
+  }
+  return handle;
+}
+
+/** Submit a read of @size bytes at the current offset of @file_info */
+static dtio_io_handle_t *SubmitRead(FileInfo *file_info, void *buf,
+                                    size_t size) {
+  if (size == 0) {
+    return CompletedHandle(0);
+  }
+
+  // Buffered writes to this range must reach the file first
+  const IoPolicy &policy = file_info->policy;
+  if (file_info->write_buffer.Overlaps(file_info->current_offset, size)) {
+    file_info->FlushWrites();
+  }
+
+  // A read split over several containers completes inline
+  auto &dtio_mod = DTIO_CONF->dtio_mod_;
+  chi::string path(file_info->absolute_path);
+  if (dtio_mod.SplitIo(file_info->current_offset, size).size() > 1) {
+    AdmissionScope admit(size);
+    hipc::FullPtr<char> data = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+    ssize_t ret =
+        dtio_mod.Read(HSHM_MCTX, data.shm_, size, file_info->current_offset,
+                      path, policy.backend, policy.opts);
+    if (ret > 0) {
+      memcpy(buf, data.ptr_, ret);
+    }
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, data);
+    return CompletedHandle(ret);
+  }
+
+  bool async = DTIO_ADMISSION->TryAcquire(size);
+  if (!async) {
+    DTIO_ADMISSION->Acquire(size);
+  }
+  auto *handle = new dtio_io_handle();
+  handle->read_buf_ = buf;
+  handle->data_ = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+  handle->read_task_ = dtio_mod.AsyncRead(
+      HSHM_MCTX,
+      dtio_mod.ScheduleIo(HSHM_MCTX, path, file_info->current_offset, size,
+                          Operation::kRead),
+      handle->data_.shm_, size, file_info->current_offset, path,
+      policy.backend,
+      policy.opts.WithDeadline(DTIO_CONF->deadline_background_us_));
+  DTIO_ADMISSION->Track(handle, handle->read_task_.ptr_, size);
+  if (!async) {
+    return CompletedHandle(Finish(handle));
+  }
+  return handle;
+}
+
+/** Whether @handle can be completed without blocking */
+static bool IsReady(dtio_io_handle_t *handle) {
+  if (handle->done_) {
+    return true;
+  }
+  if (!handle->write_task_.IsNull()) {
+    return handle->write_task_->IsComplete();
+  }
+  return handle->read_task_->IsComplete();
+}
+
+/** Wait for @handle, release it, and return its result */
+static ssize_t Finish(dtio_io_handle_t *handle) {
+  if (!handle->done_) {
+    // Stop tracking the task before it is freed, so it is never sampled
+    // after it is gone
+    if (!handle->write_task_.IsNull()) {
+      handle->write_task_->Wait();
+    } else {
+      handle->read_task_->Wait();
+    }
+    DTIO_ADMISSION->Untrack(handle);
+    if (!handle->write_task_.IsNull()) {
+      handle->ret_ = handle->write_task_->ret_;
+      CHI_CLIENT->DelTask(HSHM_MCTX, handle->write_task_);
+    } else {
+      handle->ret_ = handle->read_task_->ret_;
+      if (handle->ret_ > 0) {
+        memcpy(handle->read_buf_, handle->data_.ptr_, handle->ret_);
+      }
+      CHI_CLIENT->DelTask(HSHM_MCTX, handle->read_task_);
+    }
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, handle->data_);
+  }
+  ssize_t ret = handle->ret_;
+  delete handle;
+  return ret;
+}
+
+}  // namespace dtio
+
+extern "C" {
+
+dtio_io_handle_t *dtio_fwrite_async(const void *ptr, size_t size, size_t count,
+                                    FILE *stream) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->GetStdioFileInfo(stream);
+  if (!file_info) {
+    return dtio::CompletedHandle(fwrite(ptr, size, count, stream) * size);
+  }
+  if (file_info->packed.Active()) {
+    // A packed file is held in this process, so its I/O completes inline
+    return dtio::CompletedHandle(fwrite(ptr, size, count, stream) * size);
+  }
+  size_t total_size = size * count;
+  auto *handle = dtio::SubmitWrite(file_info, ptr, total_size);
+  client_meta->UpdateStdioOffset(stream,
+                                 file_info->current_offset + total_size);
+  return handle;
+}
+
+dtio_io_handle_t *dtio_fread_async(void *ptr, size_t size, size_t count,
+                                   FILE *stream) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->GetStdioFileInfo(stream);
+  if (!file_info) {
+    return dtio::CompletedHandle(fread(ptr, size, count, stream) * size);
+  }
+  if (file_info->packed.Active()) {
+    // A packed file is held in this process, so its I/O completes inline
+    return dtio::CompletedHandle(fread(ptr, size, count, stream) * size);
+  }
+  size_t total_size = size * count;
+  auto *handle = dtio::SubmitRead(file_info, ptr, total_size);
+  client_meta->UpdateStdioOffset(stream,
+                                 file_info->current_offset + total_size);
+  return handle;
+}
+
+dtio_io_handle_t *dtio_write_async(int fd, const void *buf, size_t count) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (!file_info) {
+    return dtio::CompletedHandle(write(fd, buf, count));
+  }
+  if (file_info->packed.Active()) {
+    // A packed file is held in this process, so its I/O completes inline
+    return dtio::CompletedHandle(write(fd, buf, count));
+  }
+  auto *handle = dtio::SubmitWrite(file_info, buf, count);
+  client_meta->UpdatePosixOffset(fd, file_info->current_offset + count);
+  return handle;
+}
+
+dtio_io_handle_t *dtio_read_async(int fd, void *buf, size_t count) {
+  auto *client_meta = DTIO_CLIENT_META;
+  auto *file_info = client_meta->GetPosixFileInfo(fd);
+  if (!file_info) {
+    return dtio::CompletedHandle(read(fd, buf, count));
+  }
+  if (file_info->packed.Active()) {
+    // A packed file is held in this process, so its I/O completes inline
+    return dtio::CompletedHandle(read(fd, buf, count));
+  }
+  auto *handle = dtio::SubmitRead(file_info, buf, count);
+  client_meta->UpdatePosixOffset(fd, file_info->current_offset + count);
+  return handle;
+}
+
+ssize_t dtio_wait(dtio_io_handle_t *handle) { return dtio::Finish(handle); }
+
+int dtio_test(dtio_io_handle_t *handle, ssize_t *bytes) {
+  if (!dtio::IsReady(handle)) {
+    return 0;
+  }
+  ssize_t ret = dtio::Finish(handle);
+  if (bytes) {
+    *bytes = ret;
+  }
+  return 1;
+}
+
+ssize_t dtio_wait_any(dtio_io_handle_t **handles, size_t count,
+                      ssize_t *bytes) {
+  while (true) {
+    bool pending = false;
+    for (size_t i = 0; i < count; ++i) {
+      if (handles[i] == nullptr) {
+        continue;
+      }
+      pending = true;
+      if (dtio_test(handles[i], bytes)) {
+        handles[i] = nullptr;
+        return i;
+      }
+    }
+    if (!pending) {
+      return -1;
+    }
+    std::this_thread::yield();
+  }
+}
+
+ssize_t dtio_wait_all(dtio_io_handle_t **handles, size_t count) {
+  ssize_t total = 0;
+  bool failed = false;
+  for (size_t i = 0; i < count; ++i) {
+    if (handles[i] == nullptr) {
+      continue;
+    }
+    ssize_t ret = dtio::Finish(handles[i]);
+    handles[i] = nullptr;
+    if (ret < 0) {
+      failed = true;
+    } else {
+      total += ret;
+    }
+  }
+  return failed ? -1 : total;
+}
+
+}  // extern C
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2024 Gnosis Research Center <grc@iit.edu>,
+ * Keith Bateman <kbateman@hawk.iit.edu>, Neeraj Rajesh
+ * <nrajesh@hawk.iit.edu> Hariharan Devarajan
+ * <hdevarajan@hawk.iit.edu>, Anthony Kougkas <akougkas@iit.edu>,
+ * Xian-He Sun <sun@iit.edu>
+ *
+ * This file is part of DTIO
+ *
+ * DTIO is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "dtio/io_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "dtio/config_manager.h"
+
+namespace dtio {
+
+void WriteBuffer::Append(off_t off, const void *data, size_t size,
+                         size_t capacity) {
+  if (capacity_ == 0) {
+    data_ = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, capacity);
+    capacity_ = capacity;
+  }
+  if (Empty()) {
+    offset_ = off;
+  }
+  memcpy(data_.ptr_ + size_, data, size);
+  size_ += size;
+}
+
+ssize_t WriteBuffer::Flush(const std::string &path, const IoPolicy &policy) {
+  if (Empty()) {
+    return 0;
+  }
+  ssize_t ret = DTIO_CONF->dtio_mod_.Write(HSHM_MCTX, data_.shm_, size_,
+                                           offset_, chi::string(path),
+                                           policy.backend, policy.opts);
+  size_t size = size_;
+  size_ = 0;
+  if (ret != static_cast<ssize_t>(size)) {
+    errno = EIO;
+    return -1;
+  }
+  return ret;
+}
+
+void WriteBuffer::Release() {
+  if (capacity_ == 0) {
+    return;
+  }
+  CHI_CLIENT->FreeBuffer(HSHM_MCTX, data_);
+  capacity_ = 0;
+  size_ = 0;
+}
+
+ssize_t ReadaheadBuffer::Read(const std::string &path, const IoPolicy &policy,
+                              off_t off, void *buf, size_t size,
+                              const FetchHook &before_fetch) {
+  bool sequential = off == expected_;
+  expected_ = off + static_cast<off_t>(size);
+  if (!sequential) {
+    // Random access: stop prefetching until a sequential run is seen again
+    window_ = 0;
+    Drop(next_);
+  }
+
+  char *dst = static_cast<char *>(buf);
+  size_t done = 0;
+  while (done < size) {
+    off_t pos = off + static_cast<off_t>(done);
+    if (!cur_.Contains(pos)) {
+      if (next_.Contains(pos)) {
+        Complete(next_);
+        std::swap(cur_, next_);
+      } else if (sequential) {
+        // Miss: fetch the window and the one after it together
+        window_ = std::max(window_, policy.readahead_min);
+        size_t size_now = std::max(window_, size - done);
+        window_ = std::min(window_ * 2, policy.readahead_max);
+        FetchAhead(path, policy, pos, size_now, window_, before_fetch);
+      } else {
+        return -1;
+      }
+      if (!cur_.Contains(pos)) {
+        break;  // EOF
+      }
+    }
+    size_t skip = pos - cur_.offset_;
+    size_t count = std::min(size - done, cur_.size_ - skip);
+    memcpy(dst + done, cur_.data_.ptr_ + skip, count);
+    done += count;
+  }
+
+  // Keep one window in flight ahead of the reader
+  if (sequential && !next_.pending_ && cur_.size_ > 0 &&
+      cur_.size_ == cur_.length_) {
+    window_ = std::min(window_ * 2, policy.readahead_max);
+    Fetch(next_, path, policy, cur_.offset_ + cur_.size_, window_, true,
+          before_fetch);
+  }
+  return done;
+}
+
+void ReadaheadBuffer::Invalidate() {
+  Drop(cur_);
+  Drop(next_);
+  window_ = 0;
+}
+
+void ReadaheadBuffer::Release() {
+  Invalidate();
+  Free(cur_);
+  Free(next_);
+}
+
+void ReadaheadBuffer::Fetch(Window &win, const std::string &path,
+                            const IoPolicy &policy, off_t off, size_t size,
+                            bool async, const FetchHook &before_fetch) {
+  Prepare(win, off, size, before_fetch);
+  Issue(win,
+        DTIO_CONF->dtio_mod_.ScheduleIo(HSHM_MCTX, chi::string(path),
+                                        win.offset_, win.length_,
+                                        Operation::kRead),
+        path, policy, async);
+  if (!async) {
+    Complete(win);
+  }
+}
+
+void ReadaheadBuffer::FetchAhead(const std::string &path,
+                                 const IoPolicy &policy, off_t off,
+                                 size_t size, size_t next_size,
+                                 const FetchHook &before_fetch) {
+  Prepare(cur_, off, size, before_fetch);
+  Prepare(next_, cur_.offset_ + cur_.length_, next_size, before_fetch);
+  std::vector<chi::DomainQuery> doms = DTIO_CONF->dtio_mod_.ScheduleIo(
+      HSHM_MCTX, std::vector<size_t>{cur_.length_, next_.length_},
+      chi::string(path),
+      std::vector<size_t>{static_cast<size_t>(cur_.offset_),
+                          static_cast<size_t>(next_.offset_)},
+      Operation::kRead);
+  Issue(cur_, doms[0], path, policy, false);
+  Issue(next_, doms[1], path, policy, true);
+  Complete(cur_);
+}
+
+void ReadaheadBuffer::Prepare(Window &win, off_t off, size_t size,
+                              const FetchHook &before_fetch) {
+  Drop(win);
+  // A window must not span containers when data is held in their tiers
+  size = DTIO_CONF->dtio_mod_.SplitIo(off, size)[0].size_;
+  before_fetch(off, size);
+  if (win.capacity_ < size) {
+    Free(win);
+    win.data_ = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+    win.capacity_ = size;
+  }
+  win.offset_ = off;
+  win.length_ = size;
+}
+
+void ReadaheadBuffer::Issue(Window &win, const chi::DomainQuery &dom,
+                            const std::string &path, const IoPolicy &policy,
+                            bool async) {
+  // Prefetches run behind the app; a fetch it waits on is urgent
+  chi::dtiomod::IoOpts opts = policy.opts;
+  if (async) {
+    opts = opts.WithDeadline(DTIO_CONF->deadline_background_us_);
+  }
+  chi::string filename(path);
+  win.task_ = DTIO_CONF->dtio_mod_.AsyncRead(
+      HSHM_MCTX, dom, win.data_.shm_, win.length_, win.offset_, filename,
+      policy.backend, opts);
+  win.pending_ = true;
+}
+
+void ReadaheadBuffer::Complete(Window &win) {
+  if (!win.pending_) {
+    return;
+  }
+  win.task_->Wait();
+  win.size_ = win.task_->ret_ > 0 ? win.task_->ret_ : 0;
+  CHI_CLIENT->DelTask(HSHM_MCTX, win.task_);
+  win.pending_ = false;
+}
+
+void ReadaheadBuffer::Drop(Window &win) {
+  Complete(win);
+  win.size_ = 0;
+}
+
+void ReadaheadBuffer::Free(Window &win) {
+  if (win.capacity_ == 0) {
+    return;
+  }
+  CHI_CLIENT->FreeBuffer(HSHM_MCTX, win.data_);
+  win.capacity_ = 0;
+}
+
+int PackedFile::Open(const std::string &path, int flags, mode_t mode) {
+  auto *config = DTIO_CONF;
+  chi::string filename(path);
+  chi::dtiomod::PackInfo info;
+
+  // The lookup brings the file along, unless it outgrew the threshold since
+  size_t capacity = config->pack_threshold_;
+  ssize_t ret;
+  for (;;) {
+    hipc::FullPtr<char> shm_buf =
+        CHI_CLIENT->AllocateBuffer(HSHM_MCTX, capacity);
+    ret = config->dtio_mod_.PackGet(HSHM_MCTX, filename, shm_buf.shm_,
+                                    capacity, info);
+    if (ret > 0) {
+      data_.assign(shm_buf.ptr_, ret);
+    }
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+    if (ret < 0 || !info.found_ || info.size_ <= capacity) {
+      break;
+    }
+    capacity = info.size_;
+  }
+  if (ret < 0) {
+    errno = EIO;
+    return -1;
+  }
+
+  bool writable = flags & (O_WRONLY | O_RDWR);
+  if (info.found_) {
+    if ((flags & O_CREAT) && (flags & O_EXCL)) {
+      errno = EEXIST;
+      return -1;
+    }
+    mode_ = info.mode_;
+    if ((flags & O_TRUNC) && writable) {
+      data_.clear();
+      dirty_ = true;
+    }
+  } else {
+    // Files that are not packed may be on the PFS. Only new ones are packed.
+    if (!(flags & O_CREAT) || access(path.c_str(), F_OK) == 0) {
+      return 0;
+    }
+    data_.clear();
+    mode_ = mode & 07777;
+    dirty_ = true;
+  }
+  active_ = true;
+  return 1;
+}
+
+ssize_t PackedFile::Read(off_t off, void *buf, size_t size) const {
+  if (off < 0 || static_cast<size_t>(off) >= data_.size()) {
+    return 0;
+  }
+  size_t count = std::min(size, data_.size() - off);
+  memcpy(buf, data_.data() + off, count);
+  return count;
+}
+
+bool PackedFile::Write(off_t off, const void *buf, size_t size) {
+  size_t end = off + size;
+  if (end > DTIO_CONF->pack_threshold_) {
+    return false;
+  }
+  if (end > data_.size()) {
+    data_.resize(end, '\0');
+  }
+  memcpy(&data_[off], buf, size);
+  dirty_ = true;
+  return true;
+}
+
+int PackedFile::Store(const std::string &path) {
+  if (!active_ || !dirty_) {
+    return 0;
+  }
+  hipc::FullPtr<char> shm_buf = CHI_CLIENT->AllocateBuffer(
+      HSHM_MCTX, std::max<size_t>(data_.size(), 1));
+  memcpy(shm_buf.ptr_, data_.data(), data_.size());
+  ssize_t ret = DTIO_CONF->dtio_mod_.PackPut(
+      HSHM_MCTX, chi::string(path), shm_buf.shm_, data_.size(), mode_);
+  CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+  if (ret != static_cast<ssize_t>(data_.size())) {
+    errno = EIO;
+    return -1;
+  }
+  dirty_ = false;
+  return 0;
+}
+
+ssize_t PackedFile::Spill(const std::string &path, const IoPolicy &policy) {
+  auto *config = DTIO_CONF;
+  ssize_t ret = 0;
+  if (!data_.empty()) {
+    hipc::FullPtr<char> shm_buf =
+        CHI_CLIENT->AllocateBuffer(HSHM_MCTX, data_.size());
+    memcpy(shm_buf.ptr_, data_.data(), data_.size());
+    ret = config->dtio_mod_.Write(HSHM_MCTX, shm_buf.shm_, data_.size(), 0,
+                                  chi::string(path), policy.backend,
+                                  policy.opts);
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, shm_buf);
+    if (ret != static_cast<ssize_t>(data_.size())) {
+      errno = EIO;
+      return -1;
+    }
+  }
+  config->dtio_mod_.PackRemove(HSHM_MCTX, chi::string(path));
+  data_ = std::string();
+  active_ = false;
+  dirty_ = false;
+  return ret;
+}
+
+bool PackedFile::Stat(const std::string &path,
+                      chi::dtiomod::PackInfo &info) {
+  DTIO_CONF->dtio_mod_.PackGet(HSHM_MCTX, chi::string(path),
+                               hipc::Pointer::GetNull(), 0, info);
+  return info.found_;
+}
+
+bool PackedFile::Remove(const std::string &path) {
+  return DTIO_CONF->dtio_mod_.PackRemove(HSHM_MCTX, chi::string(path));
+}
+
+}  // namespace dtio
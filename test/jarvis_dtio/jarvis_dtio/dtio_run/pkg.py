@@ -45,6 +45,71 @@ class DtioRun(Application):
                     }
                 ]
             },
+            {
+                'name': 'memory_paths',
+                'msg': 'Included paths whose files are kept in runtime '
+                       'memory instead of on the PFS',
+                'type': list,
+                'default': [],
+                'class': 'paths',
+                'rank': 1,
+                'args': [
+                    {
+                        'name': 'path',
+                        'msg': 'A string path kept in memory',
+                        'type': str,
+                    }
+                ]
+            },
+            {
+                'name': 'policy_paths',
+                'msg': 'Included paths with an I/O policy of their own. '
+                       'Empty fields keep the global settings',
+                'type': list,
+                'default': [],
+                'class': 'paths',
+                'rank': 1,
+                'args': [
+                    {
+                        'name': 'path',
+                        'msg': 'A string path the policy applies to',
+                        'type': str,
+                    },
+                    {
+                        'name': 'sync',
+                        'msg': 'true writes straight to the PFS, false '
+                               'writes behind',
+                        'type': str,
+                    },
+                    {
+                        'name': 'aggregation',
+                        'msg': 'Write-combining buffer size (e.g., 1m)',
+                        'type': str,
+                    },
+                    {
+                        'name': 'readahead_max',
+                        'msg': 'Maximum readahead window (e.g., 8m)',
+                        'type': str,
+                    },
+                    {
+                        'name': 'tier',
+                        'msg': 'Fastest tier data is held on: memory, '
+                               'cache or pfs',
+                        'type': str,
+                    },
+                    {
+                        'name': 'cacheable',
+                        'msg': 'Whether hot blocks may be copied up: true '
+                               'or false',
+                        'type': str,
+                    },
+                    {
+                        'name': 'backend',
+                        'msg': 'Runtime I/O client: posix or stdio',
+                        'type': str,
+                    },
+                ]
+            },
             {
                 'name': 'exclude_paths',
                 'msg': 'Paths to exclude from DTIO interception',
@@ -60,6 +125,202 @@ class DtioRun(Application):
                     }
                 ]
             },
+            {
+                'name': 'write_buffer_size',
+                'msg': 'Per-fd write-combining buffer size (e.g., 4m). '
+                       '0 disables write combining',
+                'type': str,
+                'default': '0',
+            },
+            {
+                'name': 'readahead_max',
+                'msg': 'Maximum per-fd readahead window (e.g., 8m). '
+                       '0 disables readahead',
+                'type': str,
+                'default': '8m',
+            },
+            {
+                'name': 'stdio_buffer_size',
+                'msg': 'Per-FILE* stdio buffer size (e.g., 1m). '
+                       '0 disables stdio buffering',
+                'type': str,
+                'default': '1m',
+            },
+            {
+                'name': 'scheduler',
+                'msg': 'Task placement policy: dp, greedy, round_robin, '
+                       'random, or default',
+                'type': str,
+                'default': 'default',
+            },
+            {
+                'name': 'stats_period_ms',
+                'msg': 'How often each container reports its load (ms)',
+                'type': int,
+                'default': 100,
+            },
+            {
+                'name': 'buffer_capacity',
+                'msg': 'Buffering capacity reported by each container '
+                       '(e.g., 1g)',
+                'type': str,
+                'default': '1g',
+            },
+            {
+                'name': 'stripe_size',
+                'msg': 'Granularity at which written data is homed on '
+                       'containers (e.g., 1m)',
+                'type': str,
+                'default': '1m',
+            },
+            {
+                'name': 'qos_classes',
+                'msg': 'I/O classes sharing the runtime',
+                'type': list,
+                'default': [],
+                'args': [
+                    {
+                        'name': 'name',
+                        'msg': 'The name of the class',
+                        'type': str,
+                    },
+                    {
+                        'name': 'weight',
+                        'msg': 'Share of bandwidth relative to other classes',
+                        'type': int,
+                    },
+                    {
+                        'name': 'bytes_per_sec',
+                        'msg': 'Byte rate limit (e.g., 1g). 0 is unlimited',
+                        'type': str,
+                    },
+                    {
+                        'name': 'ops_per_sec',
+                        'msg': 'Operation rate limit. 0 is unlimited',
+                        'type': int,
+                    },
+                ]
+            },
+            {
+                'name': 'qos_class',
+                'msg': 'The QoS class of this application',
+                'type': str,
+                'default': '',
+            },
+            {
+                'name': 'deadline_blocking_us',
+                'msg': 'Deadline of I/O the application blocks on (us)',
+                'type': int,
+                'default': 1000,
+            },
+            {
+                'name': 'deadline_background_us',
+                'msg': 'Deadline of prefetch and async I/O (us)',
+                'type': int,
+                'default': 100000,
+            },
+            {
+                'name': 'elevator_window',
+                'msg': 'Queued tasks per file sorted by offset before '
+                       'dispatch. 0 disables the elevator',
+                'type': int,
+                'default': 0,
+            },
+            {
+                'name': 'lanes',
+                'msg': 'Most lanes each runtime container spreads I/O over',
+                'type': int,
+                'default': 1,
+            },
+            {
+                'name': 'min_lanes',
+                'msg': 'Lanes each runtime container keeps active when idle',
+                'type': int,
+                'default': 1,
+            },
+            {
+                'name': 'tier_buffers_capacity',
+                'msg': 'Memory each runtime container holds written data in '
+                       'ahead of the PFS (e.g., 1g). 0 disables the tier',
+                'type': str,
+                'default': '0',
+            },
+            {
+                'name': 'tier_cache_dir',
+                'msg': 'Node-local directory (e.g., on an SSD) holding '
+                       'written data ahead of the PFS',
+                'type': str,
+                'default': '',
+            },
+            {
+                'name': 'tier_cache_capacity',
+                'msg': 'Bytes of tier_cache_dir to use (e.g., 100g). '
+                       '0 disables the tier',
+                'type': str,
+                'default': '0',
+            },
+            {
+                'name': 'drain_rate',
+                'msg': 'Bytes per second drained from the tiers to the PFS '
+                       '(e.g., 500m). 0 does not pace draining',
+                'type': str,
+                'default': '0',
+            },
+            {
+                'name': 'tier_policy',
+                'msg': 'Which read-hot blocks are copied up onto the tiers: '
+                       'lru, arc, lfu, or none',
+                'type': str,
+                'default': 'none',
+            },
+            {
+                'name': 'chunk_size',
+                'msg': 'Store files in chunks of this size spread over every '
+                       'runtime (e.g., 4m). 0 keeps each file whole',
+                'type': str,
+                'default': '0',
+            },
+            {
+                'name': 'log_structured',
+                'msg': 'Append each node\'s writes to a log of its own, '
+                       'compacted into the file once its writers close it',
+                'type': bool,
+                'default': False,
+            },
+            {
+                'name': 'pack_threshold',
+                'msg': 'Pack new files into shared pack files until they '
+                       'outgrow this size (e.g., 1m). 0 disables packing',
+                'type': str,
+                'default': '0',
+            },
+            {
+                'name': 'pack_dir',
+                'msg': 'Directory on the PFS holding the pack files',
+                'type': str,
+                'default': '',
+            },
+            {
+                'name': 'memory_capacity',
+                'msg': 'Runtime memory per node for files under memory '
+                       'paths (e.g., 16g). 0 disables it',
+                'type': str,
+                'default': '0',
+            },
+            {
+                'name': 'client_inflight_limit',
+                'msg': 'Shm buffer bytes one client may have in flight '
+                       '(e.g., 512m). 0 is unlimited',
+                'type': str,
+                'default': '512m',
+            },
+            {
+                'name': 'node_inflight_limit',
+                'msg': 'I/O bytes the runtime on a node may have in flight '
+                       '(e.g., 4g). 0 is unlimited',
+                'type': str,
+                'default': '0',
+            },
         ]
 
     def _configure(self, **kwargs):
@@ -71,14 +332,59 @@ class DtioRun(Application):
         :return: None
         """
         # Use lists directly from config
-        include_paths = self.config['include_paths']
+        include_paths = self.config['include_paths'] + [
+            {'path': path, 'memory': True}
+            for path in self.config['memory_paths']
+        ]
+        policy_keys = ['path', 'sync', 'aggregation', 'readahead_max', 'tier',
+                       'cacheable', 'backend']
+        include_paths += [
+            {key: val for key, val in zip(policy_keys, policy) if val}
+            for policy in self.config['policy_paths']
+        ]
         exclude_paths = self.config['exclude_paths']
 
         # Create the DTIO configuration dictionary
         dtio_config = {
             'include': include_paths,
-            'exclude': exclude_paths
+            'exclude': exclude_paths,
+            'write_buffer_size': self.config['write_buffer_size'],
+            'readahead_max': self.config['readahead_max'],
+            'stdio_buffer_size': self.config['stdio_buffer_size'],
+            'scheduler': self.config['scheduler'],
+            'stats_period_ms': self.config['stats_period_ms'],
+            'buffer_capacity': self.config['buffer_capacity'],
+            'stripe_size': self.config['stripe_size'],
+            'deadline_blocking_us': self.config['deadline_blocking_us'],
+            'deadline_background_us': self.config['deadline_background_us'],
+            'elevator_window': self.config['elevator_window'],
+            'lanes': self.config['lanes'],
+            'min_lanes': self.config['min_lanes'],
+            'tier_buffers_capacity': self.config['tier_buffers_capacity'],
+            'tier_cache_dir': self.config['tier_cache_dir'],
+            'tier_cache_capacity': self.config['tier_cache_capacity'],
+            'drain_rate': self.config['drain_rate'],
+            'tier_policy': self.config['tier_policy'],
+            'chunk_size': self.config['chunk_size'],
+            'log_structured': self.config['log_structured'],
+            'pack_threshold': self.config['pack_threshold'],
+            'pack_dir': self.config['pack_dir'],
+            'memory_capacity': self.config['memory_capacity'],
+            'client_inflight_limit': self.config['client_inflight_limit'],
+            'node_inflight_limit': self.config['node_inflight_limit'],
         }
+        if self.config['qos_classes']:
+            dtio_config['qos_classes'] = [
+                {
+                    'name': qos[0],
+                    'weight': qos[1],
+                    'bytes_per_sec': qos[2],
+                    'ops_per_sec': qos[3],
+                }
+                for qos in self.config['qos_classes']
+            ]
+        if self.config['qos_class']:
+            dtio_config['qos_class'] = self.config['qos_class']
 
         # Save DTIO configuration
         dtio_config_yaml = f'{self.shared_dir}/dtio_config.yaml'